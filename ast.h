@@ -1,12 +1,913 @@
 #pragma once
 
 #include "common.h"
+#include "memory.h"
+#include "lexer.h"
 
-struct AST_Node
+// NOTE(soimn): The AST is stored as parallel arrays indexed by Node_Index. Every node has a kind, the index of its
+//              main token in the token array and two 32 bit data slots, lhs and rhs. Nodes with more than two
+//              children, or with a variable number of them, keep the children in the extra_data array and store
+//              the index of an extra_data record in a data slot. The layout of each kind is listed next to it:
+//
+//              lhs, rhs         child nodes, NODE_NONE when an optional child is absent
+//              [lhs..rhs)       the children are extra_data[lhs] up to, but not including, extra_data[rhs]
+//              -> Type          the slot is the extra_data index of a Type record
+//
+//              Node 0 is always the translation unit, which is never a child, so NODE_NONE can share its index.
+//              The main token of a declaration is its name.
+
+typedef U32 Node_Index;
+
+#define NODE_NONE 0
+
+enum AST_NODE_KIND
+{
+    ASTNode_Error,             // The main token is where the error was found
+    ASTNode_TranslationUnit,   // [lhs..rhs) declarations
+    
+    /// Declarations
+    ASTNode_StructDecl,        // -
+    ASTNode_StructDef,         // [lhs..rhs) members. The main token is the keyword when unnamed.
+    ASTNode_UnionDecl,         // -
+    ASTNode_UnionDef,          // [lhs..rhs) members. The main token is the keyword when unnamed.
+    ASTNode_EnumDef,           // lhs type or NODE_NONE, rhs -> AST_Range of enumerators
+    ASTNode_Typedef,           // lhs type
+    ASTNode_FunctionDecl,      // lhs -> AST_Function_Prototype
+    ASTNode_FunctionDef,       // lhs -> AST_Function_Prototype, rhs body, a LazyBlock until it is parsed
+    ASTNode_VarDecl,           // lhs type, rhs -> AST_Variable_List. The main token is the first of the type.
+    
+    ASTNode_Tag,               // [lhs..rhs) arguments. The main token is the name.
+    ASTNode_Member,            // lhs type
+    ASTNode_Enumerator,        // lhs value or NODE_NONE
+    ASTNode_Parameter,         // lhs type
+    ASTNode_VariadicParameter, // -
+    ASTNode_Variable,          // lhs initializer or NODE_NONE
+    
+    /// Types
+    ASTNode_TypeName,          // -
+    ASTNode_PointerType,       // lhs pointee
+    
+    /// Statements
+    ASTNode_Block,             // [lhs..rhs) statements
+    ASTNode_LazyBlock,         // lhs index of the token after the body. The main token is the '{'.
+    ASTNode_If,                // lhs condition, rhs -> AST_Branches, the else branch may be NODE_NONE
+    ASTNode_While,             // lhs condition, rhs body
+    ASTNode_DoWhile,           // lhs body, rhs condition
+    ASTNode_For,               // lhs -> AST_For_Clauses, rhs body
+    ASTNode_Return,            // lhs expression or NODE_NONE
+    ASTNode_Break,             // -
+    ASTNode_Continue,          // -
+    ASTNode_ExpressionStatement, // lhs expression
+    ASTNode_Empty,             // -, a ; or an omitted part of a for statement
+    
+    /// Expressions
+    ASTNode_Binary,            // lhs, rhs. The main token is the operator, assignments included.
+    ASTNode_Ternary,           // lhs condition, rhs -> AST_Branches
+    ASTNode_Unary,             // lhs operand. The main token is the prefix operator.
+    ASTNode_Postfix,           // lhs operand. The main token is ++ or --.
+    ASTNode_Call,              // lhs callee, rhs -> AST_Range of arguments
+    ASTNode_Subscript,         // lhs array, rhs index
+    ASTNode_MemberAccess,      // lhs operand. The main token is the member name.
+    ASTNode_Identifier,        // -
+    ASTNode_IntLiteral,        // -
+    ASTNode_FloatLiteral,      // -
+    ASTNode_StringLiteral,     // -
+    ASTNode_CharLiteral,       // -
+    
+    AST_NODE_KIND_COUNT
+};
+
+struct AST_Node_Data
+{
+    U32 lhs;
+    U32 rhs;
+};
+
+/// Extra data records
+struct AST_Range
+{
+    U32 start;
+    U32 end;
+};
+
+struct AST_Function_Prototype
+{
+    Node_Index return_type;
+    U32 parameters_start;
+    U32 parameters_end;
+    U32 tags_start;
+    U32 tags_end;
+};
+
+struct AST_Variable_List
+{
+    U32 variables_start;
+    U32 variables_end;
+    U32 tags_start;
+    U32 tags_end;
+};
+
+struct AST_Branches
+{
+    Node_Index then_branch;
+    Node_Index else_branch;
+};
+
+struct AST_For_Clauses
+{
+    Node_Index init;
+    Node_Index condition;
+    Node_Index step;
+};
+
+// NOTE(soimn): The syntax tree owns the token array of the file, since nodes refer to their main token by index.
+//              A tree loaded from the AST cache has its node arrays in a read only file mapping, which it owns
+//              instead, and cannot be added to.
+struct Syntax_Tree
+{
+    Dynamic_Array<Token> tokens;
+    
+    Dynamic_Array<Enum8(AST_NODE_KIND)> kinds;
+    Dynamic_Array<U32> main_tokens;
+    Dynamic_Array<AST_Node_Data> data;
+    
+    Dynamic_Array<U32> extra_data;
+    
+    void* mapping;
+};
+
+// NOTE(soimn): Bounds on the number of nodes and extra data words per token, used to size the reservations. Most
+//              nodes consume at least one token, the exceptions being error nodes and the empty clauses of for
+//              statements, and every node is referenced at most once from extra data besides the fixed records.
+#define SYNTAX_TREE_NODES_PER_TOKEN 4
+#define SYNTAX_TREE_EXTRA_PER_NODE 4
+
+// NOTE(soimn): A tree without a token array of its own, which is used as scratch storage by parsers that build
+//              parts of a tree to be copied into the final one with AppendNodes
+inline Syntax_Tree
+SyntaxTreeStorage(UMM max_node_count)
+{
+    Syntax_Tree result = {};
+    
+    UMM max_extra_count = max_node_count * SYNTAX_TREE_EXTRA_PER_NODE;
+    
+    result.kinds       = DynamicArray<Enum8(AST_NODE_KIND)>(max_node_count * sizeof(Enum8(AST_NODE_KIND)));
+    result.main_tokens = DynamicArray<U32>(max_node_count * sizeof(U32));
+    result.data        = DynamicArray<AST_Node_Data>(max_node_count * sizeof(AST_Node_Data));
+    result.extra_data  = DynamicArray<U32>(max_extra_count * sizeof(U32));
+    
+    return result;
+}
+
+inline Syntax_Tree
+SyntaxTree(Dynamic_Array<Token> tokens)
+{
+    Syntax_Tree result = SyntaxTreeStorage((tokens.count + 1) * SYNTAX_TREE_NODES_PER_TOKEN);
+    result.tokens = tokens;
+    
+    return result;
+}
+
+inline void
+FreeSyntaxTree(Syntax_Tree* tree)
+{
+    FreeArray(&tree->tokens);
+    
+    if (tree->mapping)
+    {
+        UnmapFile(tree->mapping);
+    }
+    
+    else
+    {
+        FreeArray(&tree->kinds);
+        FreeArray(&tree->main_tokens);
+        FreeArray(&tree->data);
+        FreeArray(&tree->extra_data);
+    }
+    
+    *tree = {};
+}
+
+inline Node_Index
+PushNode(Syntax_Tree* tree, Enum8(AST_NODE_KIND) kind, U32 main_token, U32 lhs = NODE_NONE, U32 rhs = NODE_NONE)
+{
+    Node_Index result = (Node_Index)tree->kinds.count;
+    
+    *PushElement(&tree->kinds)       = kind;
+    *PushElement(&tree->main_tokens) = main_token;
+    *PushElement(&tree->data)        = {lhs, rhs};
+    
+    return result;
+}
+
+inline U32
+NodeCount(Syntax_Tree* tree)
+{
+    return (U32)tree->kinds.count;
+}
+
+inline Enum8(AST_NODE_KIND)
+NodeKind(Syntax_Tree* tree, Node_Index node)
+{
+    return tree->kinds.data[node];
+}
+
+inline AST_Node_Data*
+NodeData(Syntax_Tree* tree, Node_Index node)
+{
+    return &tree->data.data[node];
+}
+
+inline Token*
+NodeToken(Syntax_Tree* tree, Node_Index node)
+{
+    return &tree->tokens.data[tree->main_tokens.data[node]];
+}
+
+// NOTE(soimn): Extra data records are copied in and out word by word, since extra_data is only U32 aligned
+template<typename T>
+inline U32
+PushExtraData(Syntax_Tree* tree, T record)
+{
+    static_assert(sizeof(T) % sizeof(U32) == 0 && alignof(T) <= alignof(U32), "Extra data records must be made of U32s");
+    
+    U32 result = (U32)tree->extra_data.count;
+    
+    Copy(&record, PushElements(&tree->extra_data, sizeof(T) / sizeof(U32)), sizeof(T));
+    
+    return result;
+}
+
+template<typename T>
+inline T
+ExtraData(Syntax_Tree* tree, U32 index)
+{
+    T result;
+    
+    Copy(tree->extra_data.data + index, &result, sizeof(T));
+    
+    return result;
+}
+
+// NOTE(soimn): Returns the children of a node whose data slots are a [lhs..rhs) range
+inline AST_Range
+NodeChildren(Syntax_Tree* tree, Node_Index node)
+{
+    AST_Node_Data* data = NodeData(tree, node);
+    
+    return {data->lhs, data->rhs};
+}
+
+// NOTE(soimn): Returns the tags of a declaration, or an empty range for kinds that cannot be tagged
+inline AST_Range
+NodeTags(Syntax_Tree* tree, Node_Index node)
+{
+    AST_Range result = {};
+    
+    Enum8(AST_NODE_KIND) kind = NodeKind(tree, node);
+    
+    if (kind == ASTNode_FunctionDecl || kind == ASTNode_FunctionDef)
+    {
+        AST_Function_Prototype prototype = ExtraData<AST_Function_Prototype>(tree, NodeData(tree, node)->lhs);
+        result = {prototype.tags_start, prototype.tags_end};
+    }
+    
+    else if (kind == ASTNode_VarDecl)
+    {
+        AST_Variable_List list = ExtraData<AST_Variable_List>(tree, NodeData(tree, node)->rhs);
+        result = {list.tags_start, list.tags_end};
+    }
+    
+    return result;
+}
+
+inline AST_Range
+NodeVariables(Syntax_Tree* tree, Node_Index node)
+{
+    Assert(NodeKind(tree, node) == ASTNode_VarDecl);
+    
+    AST_Variable_List list = ExtraData<AST_Variable_List>(tree, NodeData(tree, node)->rhs);
+    
+    return {list.variables_start, list.variables_end};
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): How the data slots of every kind are interpreted, for code that has to handle every kind the same
+//              way, like copying nodes between trees. This has to be kept in sync with AST_NODE_KIND.
+enum AST_SLOT_KIND
 {
-    File_ID file;
-    U32 line;
-    U32 column;
+    ASTSlot_None,
+    ASTSlot_Node,              // Node index or NODE_NONE
+    ASTSlot_ListStart,         // Start of a [lhs..rhs) list of nodes
+    ASTSlot_ListEnd,
+    ASTSlot_Range,             // Extra data index of an AST_Range of nodes
+    ASTSlot_FunctionPrototype, // Extra data index of an AST_Function_Prototype
+    ASTSlot_VariableList,      // Extra data index of an AST_Variable_List
+    ASTSlot_Branches,          // Extra data index of an AST_Branches
+    ASTSlot_ForClauses,        // Extra data index of an AST_For_Clauses
+    ASTSlot_Token,             // Token index
+};
+
+struct AST_Node_Layout
+{
+    Enum8(AST_SLOT_KIND) lhs;
+    Enum8(AST_SLOT_KIND) rhs;
+};
+
+struct AST_Node_Layout_Table
+{
+    AST_Node_Layout layouts[AST_NODE_KIND_COUNT];
+};
+
+constexpr AST_Node_Layout_Table
+BuildASTNodeLayouts()
+{
+    AST_Node_Layout_Table table = {};
+    
+    Enum8(AST_NODE_KIND) lists[] = {ASTNode_TranslationUnit, ASTNode_StructDef, ASTNode_UnionDef, ASTNode_Block,
+                                    ASTNode_Tag};
+    
+    for (Enum8(AST_NODE_KIND) kind : lists)
+    {
+        table.layouts[kind] = {ASTSlot_ListStart, ASTSlot_ListEnd};
+    }
+    
+    Enum8(AST_NODE_KIND) single_child[] = {ASTNode_Typedef, ASTNode_Member, ASTNode_Enumerator, ASTNode_Parameter,
+                                           ASTNode_Variable, ASTNode_PointerType, ASTNode_Return,
+                                           ASTNode_ExpressionStatement, ASTNode_Unary, ASTNode_Postfix,
+                                           ASTNode_MemberAccess};
+    
+    for (Enum8(AST_NODE_KIND) kind : single_child)
+    {
+        table.layouts[kind] = {ASTSlot_Node, ASTSlot_None};
+    }
+    
+    Enum8(AST_NODE_KIND) two_children[] = {ASTNode_While, ASTNode_DoWhile, ASTNode_Binary, ASTNode_Subscript};
+    
+    for (Enum8(AST_NODE_KIND) kind : two_children)
+    {
+        table.layouts[kind] = {ASTSlot_Node, ASTSlot_Node};
+    }
+    
+    table.layouts[ASTNode_EnumDef]      = {ASTSlot_Node, ASTSlot_Range};
+    table.layouts[ASTNode_VarDecl]      = {ASTSlot_Node, ASTSlot_VariableList};
+    table.layouts[ASTNode_Call]         = {ASTSlot_Node, ASTSlot_Range};
+    table.layouts[ASTNode_FunctionDecl] = {ASTSlot_FunctionPrototype, ASTSlot_None};
+    table.layouts[ASTNode_FunctionDef]  = {ASTSlot_FunctionPrototype, ASTSlot_Node};
+    table.layouts[ASTNode_If]           = {ASTSlot_Node, ASTSlot_Branches};
+    table.layouts[ASTNode_Ternary]      = {ASTSlot_Node, ASTSlot_Branches};
+    table.layouts[ASTNode_For]          = {ASTSlot_ForClauses, ASTSlot_Node};
+    table.layouts[ASTNode_LazyBlock]    = {ASTSlot_Token, ASTSlot_None};
+    
+    return table;
+}
+
+global constexpr AST_Node_Layout_Table ASTNodeLayouts = BuildASTNodeLayouts();
+
+// NOTE(soimn): Maps indices in the source runs of AppendNodes to indices in the destination tree
+struct AST_Relocation
+{
+    U32 node_start;
+    U32 node_base;
+    U32 extra_start;
+    U32 extra_base;
+};
+
+inline Node_Index
+RelocateNode(AST_Relocation relocation, Node_Index node)
+{
+    return (node != NODE_NONE ? node - relocation.node_start + relocation.node_base : NODE_NONE);
+}
+
+inline U32
+RelocateExtra(AST_Relocation relocation, U32 index)
+{
+    return index - relocation.extra_start + relocation.extra_base;
+}
+
+inline void
+RelocateNodeList(Syntax_Tree* tree, AST_Relocation relocation, U32 start, U32 end)
+{
+    for (U32 i = start; i < end; ++i)
+    {
+        tree->extra_data.data[i] = RelocateNode(relocation, tree->extra_data.data[i]);
+    }
+}
+
+// NOTE(soimn): Copies the nodes [node_start..node_end) of another tree, and the extra data [extra_start..extra_end)
+//              they use, to the end of the tree. The nodes may only refer to nodes and extra data within those runs,
+//              and main token indices are copied as is, so both trees have to share a token array.
+inline AST_Relocation
+AppendNodes(Syntax_Tree* tree, Syntax_Tree* source, U32 node_start, U32 node_end, U32 extra_start, U32 extra_end)
+{
+    AST_Relocation result = {node_start, (U32)tree->kinds.count, extra_start, (U32)tree->extra_data.count};
+    
+    U32 node_count  = node_end - node_start;
+    U32 extra_count = extra_end - extra_start;
+    
+    if (node_count != 0)
+    {
+        CopyArray(source->kinds.data + node_start,       PushElements(&tree->kinds, node_count),       node_count);
+        CopyArray(source->main_tokens.data + node_start, PushElements(&tree->main_tokens, node_count), node_count);
+        CopyArray(source->data.data + node_start,        PushElements(&tree->data, node_count),        node_count);
+    }
+    
+    if (extra_count != 0)
+    {
+        CopyArray(source->extra_data.data + extra_start, PushElements(&tree->extra_data, extra_count), extra_count);
+    }
+    
+    for (U32 node = result.node_base; node < result.node_base + node_count; ++node)
+    {
+        AST_Node_Layout layout = ASTNodeLayouts.layouts[tree->kinds.data[node]];
+        AST_Node_Data* data    = &tree->data.data[node];
+        
+        U32* slots[2]                 = {&data->lhs, &data->rhs};
+        Enum8(AST_SLOT_KIND) kinds[2] = {layout.lhs, layout.rhs};
+        
+        for (U32 i = 0; i < 2; ++i)
+        {
+            U32* slot = slots[i];
+            
+            switch (kinds[i])
+            {
+                case ASTSlot_None:  break;
+                case ASTSlot_Token: break;
+                
+                case ASTSlot_Node:
+                {
+                    *slot = RelocateNode(result, *slot);
+                } break;
+                
+                case ASTSlot_ListStart:
+                {
+                    data->lhs = RelocateExtra(result, data->lhs);
+                    data->rhs = RelocateExtra(result, data->rhs);
+                    
+                    RelocateNodeList(tree, result, data->lhs, data->rhs);
+                } break;
+                
+                // NOTE(soimn): Handled together with the start
+                case ASTSlot_ListEnd: break;
+                
+                case ASTSlot_Range:
+                {
+                    *slot = RelocateExtra(result, *slot);
+                    
+                    AST_Range range = ExtraData<AST_Range>(tree, *slot);
+                    range.start = RelocateExtra(result, range.start);
+                    range.end   = RelocateExtra(result, range.end);
+                    
+                    Copy(&range, tree->extra_data.data + *slot, sizeof(range));
+                    RelocateNodeList(tree, result, range.start, range.end);
+                } break;
+                
+                case ASTSlot_FunctionPrototype:
+                {
+                    *slot = RelocateExtra(result, *slot);
+                    
+                    AST_Function_Prototype prototype = ExtraData<AST_Function_Prototype>(tree, *slot);
+                    prototype.return_type      = RelocateNode(result, prototype.return_type);
+                    prototype.parameters_start = RelocateExtra(result, prototype.parameters_start);
+                    prototype.parameters_end   = RelocateExtra(result, prototype.parameters_end);
+                    prototype.tags_start       = RelocateExtra(result, prototype.tags_start);
+                    prototype.tags_end         = RelocateExtra(result, prototype.tags_end);
+                    
+                    Copy(&prototype, tree->extra_data.data + *slot, sizeof(prototype));
+                    RelocateNodeList(tree, result, prototype.parameters_start, prototype.parameters_end);
+                    RelocateNodeList(tree, result, prototype.tags_start, prototype.tags_end);
+                } break;
+                
+                case ASTSlot_VariableList:
+                {
+                    *slot = RelocateExtra(result, *slot);
+                    
+                    AST_Variable_List list = ExtraData<AST_Variable_List>(tree, *slot);
+                    list.variables_start = RelocateExtra(result, list.variables_start);
+                    list.variables_end   = RelocateExtra(result, list.variables_end);
+                    list.tags_start      = RelocateExtra(result, list.tags_start);
+                    list.tags_end        = RelocateExtra(result, list.tags_end);
+                    
+                    Copy(&list, tree->extra_data.data + *slot, sizeof(list));
+                    RelocateNodeList(tree, result, list.variables_start, list.variables_end);
+                    RelocateNodeList(tree, result, list.tags_start, list.tags_end);
+                } break;
+                
+                case ASTSlot_Branches:
+                {
+                    *slot = RelocateExtra(result, *slot);
+                    
+                    AST_Branches branches = ExtraData<AST_Branches>(tree, *slot);
+                    branches.then_branch = RelocateNode(result, branches.then_branch);
+                    branches.else_branch = RelocateNode(result, branches.else_branch);
+                    
+                    Copy(&branches, tree->extra_data.data + *slot, sizeof(branches));
+                } break;
+                
+                case ASTSlot_ForClauses:
+                {
+                    *slot = RelocateExtra(result, *slot);
+                    
+                    AST_For_Clauses clauses = ExtraData<AST_For_Clauses>(tree, *slot);
+                    clauses.init      = RelocateNode(result, clauses.init);
+                    clauses.condition = RelocateNode(result, clauses.condition);
+                    clauses.step      = RelocateNode(result, clauses.step);
+                    
+                    Copy(&clauses, tree->extra_data.data + *slot, sizeof(clauses));
+                } break;
+                
+                INVALID_DEFAULT_CASE;
+            }
+        }
+    }
+    
+    return result;
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): Pushes the children of a node in source order, NODE_NONE children left out. The tags of a
+//              declaration come before everything in its data slots, so they are pushed first.
+inline void
+PushNodeChildren(Syntax_Tree* tree, Node_Index node, Dynamic_Array<Node_Index>* children)
+{
+    AST_Node_Layout layout = ASTNodeLayouts.layouts[NodeKind(tree, node)];
+    AST_Node_Data data     = *NodeData(tree, node);
+    
+    AST_Range tags = NodeTags(tree, node);
+    
+    for (U32 i = tags.start; i < tags.end; ++i)
+    {
+        *PushElement(children) = tree->extra_data.data[i];
+    }
+    
+    U32 slots[2]                  = {data.lhs, data.rhs};
+    Enum8(AST_SLOT_KIND) kinds[2] = {layout.lhs, layout.rhs};
+    
+    for (U32 i = 0; i < 2; ++i)
+    {
+        Node_Index nodes[3] = {};
+        U32 list_start      = 0;
+        U32 list_end        = 0;
+        
+        switch (kinds[i])
+        {
+            case ASTSlot_None:
+            case ASTSlot_ListEnd:
+            case ASTSlot_Token:
+                break;
+            
+            case ASTSlot_Node:
+            {
+                nodes[0] = slots[i];
+            } break;
+            
+            case ASTSlot_ListStart:
+            {
+                list_start = data.lhs;
+                list_end   = data.rhs;
+            } break;
+            
+            case ASTSlot_Range:
+            {
+                AST_Range range = ExtraData<AST_Range>(tree, slots[i]);
+                list_start = range.start;
+                list_end   = range.end;
+            } break;
+            
+            case ASTSlot_FunctionPrototype:
+            {
+                AST_Function_Prototype prototype = ExtraData<AST_Function_Prototype>(tree, slots[i]);
+                nodes[0]   = prototype.return_type;
+                list_start = prototype.parameters_start;
+                list_end   = prototype.parameters_end;
+            } break;
+            
+            case ASTSlot_VariableList:
+            {
+                AST_Variable_List list = ExtraData<AST_Variable_List>(tree, slots[i]);
+                list_start = list.variables_start;
+                list_end   = list.variables_end;
+            } break;
+            
+            case ASTSlot_Branches:
+            {
+                AST_Branches branches = ExtraData<AST_Branches>(tree, slots[i]);
+                nodes[0] = branches.then_branch;
+                nodes[1] = branches.else_branch;
+            } break;
+            
+            case ASTSlot_ForClauses:
+            {
+                AST_For_Clauses clauses = ExtraData<AST_For_Clauses>(tree, slots[i]);
+                nodes[0] = clauses.init;
+                nodes[1] = clauses.condition;
+                nodes[2] = clauses.step;
+            } break;
+            
+            INVALID_DEFAULT_CASE;
+        }
+        
+        for (U32 j = 0; j < ARRAY_COUNT(nodes); ++j)
+        {
+            if (nodes[j] != NODE_NONE) *PushElement(children) = nodes[j];
+        }
+        
+        for (U32 j = list_start; j < list_end; ++j)
+        {
+            *PushElement(children) = tree->extra_data.data[j];
+        }
+    }
+}
+
+// NOTE(soimn): A flattened view of the nodes reachable from the translation unit, for passes that visit every node
+//              and would otherwise chase child indices recursively through the whole tree. The nodes are listed in
+//              pre-order and in post-order, and each is visited with a linear scan over one array.
+//
+//              subtree_sizes is indexed by pre-order position and counts the node itself, so the subtree of the
+//              node at position i is [i..i + subtree_sizes[i]) in pre-order, and skipping it is a matter of
+//              continuing at the end of that range. In post-order a subtree ends with its root instead.
+//
+//              The nodes are also grouped by kind, in post-order within each group, so a pass that only cares about
+//              one kind, like folding constant binary expressions, loops over just those nodes and still sees the
+//              children of a node before the node itself.
+struct AST_Traversal
+{
+    U32 node_count;
+    
+    Node_Index* pre_order;
+    U32* subtree_sizes;
+    Node_Index* post_order;
+    
+    U32 kind_offsets[AST_NODE_KIND_COUNT + 1];
+    Node_Index* by_kind;
+};
+
+inline AST_Traversal
+FlattenSyntaxTree(Syntax_Tree* tree, Memory_Arena* arena)
+{
+    AST_Traversal result = {};
+    
+    U32 max_count = NodeCount(tree);
+    
+    result.pre_order     = PushArray(arena, Node_Index, MAX(max_count, 1));
+    result.subtree_sizes = PushArray(arena, U32, MAX(max_count, 1));
+    result.post_order    = PushArray(arena, Node_Index, MAX(max_count, 1));
+    result.by_kind       = PushArray(arena, Node_Index, MAX(max_count, 1));
+    
+    // NOTE(soimn): The walk is iterative, since expressions and statements can nest deeper than the call stack
+    //              allows. The parent and depth of every pre-order position are kept for computing the sizes and
+    //              post-order positions afterwards.
+    struct Walk_Entry
+    {
+        Node_Index node;
+        U32 parent;
+        U32 depth;
+    };
+    
+    Dynamic_Array<Walk_Entry> stack    = DynamicArray<Walk_Entry>((max_count + 1) * sizeof(Walk_Entry));
+    Dynamic_Array<Node_Index> children = DynamicArray<Node_Index>((max_count + 1) * sizeof(Node_Index));
+    Dynamic_Array<U32> parents         = DynamicArray<U32>((max_count + 1) * sizeof(U32));
+    Dynamic_Array<U32> depths          = DynamicArray<U32>((max_count + 1) * sizeof(U32));
+    
+    if (max_count != 0) *PushElement(&stack) = {NODE_NONE, U32_MAX, 0};
+    
+    while (stack.count != 0)
+    {
+        Walk_Entry entry = stack.data[stack.count - 1];
+        PopElements(&stack, 1);
+        
+        U32 position = result.node_count++;
+        
+        result.pre_order[position]     = entry.node;
+        result.subtree_sizes[position] = 1;
+        *PushElement(&parents)         = entry.parent;
+        *PushElement(&depths)          = entry.depth;
+        
+        // NOTE(soimn): Children are pushed last to first, so the first child is visited next
+        ResetArray(&children);
+        PushNodeChildren(tree, entry.node, &children);
+        
+        for (UMM i = children.count; i > 0; --i)
+        {
+            *PushElement(&stack) = {children.data[i - 1], position, entry.depth + 1};
+        }
+    }
+    
+    // NOTE(soimn): Children come after their parent in pre-order, so a reverse scan has every subtree complete
+    //              before it is added to its parent
+    for (U32 i = result.node_count; i > 1; --i)
+    {
+        result.subtree_sizes[parents.data[i - 1]] += result.subtree_sizes[i - 1];
+    }
+    
+    // NOTE(soimn): The nodes before a node in post-order are the ones before it in pre-order, minus its ancestors,
+    //              plus its descendants
+    for (U32 i = 0; i < result.node_count; ++i)
+    {
+        result.post_order[i - depths.data[i] + result.subtree_sizes[i] - 1] = result.pre_order[i];
+    }
+    
+    for (U32 i = 0; i < result.node_count; ++i)
+    {
+        result.kind_offsets[NodeKind(tree, result.post_order[i]) + 1] += 1;
+    }
+    
+    for (U32 kind = 0; kind < AST_NODE_KIND_COUNT; ++kind)
+    {
+        result.kind_offsets[kind + 1] += result.kind_offsets[kind];
+    }
+    
+    U32 kind_ends[AST_NODE_KIND_COUNT];
+    CopyArray(result.kind_offsets, kind_ends, AST_NODE_KIND_COUNT);
+    
+    for (U32 i = 0; i < result.node_count; ++i)
+    {
+        Node_Index node = result.post_order[i];
+        result.by_kind[kind_ends[NodeKind(tree, node)]++] = node;
+    }
+    
+    FreeArray(&stack);
+    FreeArray(&children);
+    FreeArray(&parents);
+    FreeArray(&depths);
+    
+    return result;
+}
+
+// NOTE(soimn): Returns the pre-order position after the subtree of the node at the position
+inline U32
+SkipSubtree(AST_Traversal* traversal, U32 position)
+{
+    return position + traversal->subtree_sizes[position];
+}
+
+// NOTE(soimn): Returns the range of by_kind that holds the nodes of the kind
+inline AST_Range
+NodesOfKind(AST_Traversal* traversal, Enum8(AST_NODE_KIND) kind)
+{
+    return {traversal->kind_offsets[kind], traversal->kind_offsets[kind + 1]};
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+inline AST_Range
+CopyNodeList(Syntax_Tree* tree, Syntax_Tree* source, U32 start, U32 end, Node_Index* remap)
+{
+    AST_Range result = {(U32)tree->extra_data.count, (U32)tree->extra_data.count + (end - start)};
+    
+    U32* elements = (end != start ? PushElements(&tree->extra_data, end - start) : 0);
+    
+    for (U32 i = start; i < end; ++i)
+    {
+        elements[i - start] = remap[source->extra_data.data[i]];
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Copies a node whose children have already been copied, rebuilding its extra data records
+inline Node_Index
+CopyNode(Syntax_Tree* tree, Syntax_Tree* source, Node_Index node, U32 token_shift, Node_Index* remap)
+{
+    Enum8(AST_NODE_KIND) kind = NodeKind(source, node);
+    AST_Node_Layout layout    = ASTNodeLayouts.layouts[kind];
+    AST_Node_Data data        = *NodeData(source, node);
+    
+    U32* slots[2]                 = {&data.lhs, &data.rhs};
+    Enum8(AST_SLOT_KIND) kinds[2] = {layout.lhs, layout.rhs};
+    
+    for (U32 i = 0; i < 2; ++i)
+    {
+        U32* slot = slots[i];
+        
+        switch (kinds[i])
+        {
+            case ASTSlot_None: break;
+            
+            case ASTSlot_Node:
+            {
+                *slot = remap[*slot];
+            } break;
+            
+            case ASTSlot_Token:
+            {
+                *slot += token_shift;
+            } break;
+            
+            case ASTSlot_ListStart:
+            {
+                AST_Range list = CopyNodeList(tree, source, data.lhs, data.rhs, remap);
+                
+                data.lhs = list.start;
+                data.rhs = list.end;
+            } break;
+            
+            // NOTE(soimn): Handled together with the start
+            case ASTSlot_ListEnd: break;
+            
+            case ASTSlot_Range:
+            {
+                AST_Range range = ExtraData<AST_Range>(source, *slot);
+                
+                *slot = PushExtraData(tree, CopyNodeList(tree, source, range.start, range.end, remap));
+            } break;
+            
+            case ASTSlot_FunctionPrototype:
+            {
+                AST_Function_Prototype prototype = ExtraData<AST_Function_Prototype>(source, *slot);
+                AST_Range parameters             = CopyNodeList(tree, source, prototype.parameters_start, prototype.parameters_end, remap);
+                AST_Range tags                   = CopyNodeList(tree, source, prototype.tags_start, prototype.tags_end, remap);
+                
+                *slot = PushExtraData(tree, AST_Function_Prototype{remap[prototype.return_type], parameters.start, parameters.end,
+                                                                   tags.start, tags.end});
+            } break;
+            
+            case ASTSlot_VariableList:
+            {
+                AST_Variable_List list = ExtraData<AST_Variable_List>(source, *slot);
+                AST_Range variables    = CopyNodeList(tree, source, list.variables_start, list.variables_end, remap);
+                AST_Range tags         = CopyNodeList(tree, source, list.tags_start, list.tags_end, remap);
+                
+                *slot = PushExtraData(tree, AST_Variable_List{variables.start, variables.end, tags.start, tags.end});
+            } break;
+            
+            case ASTSlot_Branches:
+            {
+                AST_Branches branches = ExtraData<AST_Branches>(source, *slot);
+                
+                *slot = PushExtraData(tree, AST_Branches{remap[branches.then_branch], remap[branches.else_branch]});
+            } break;
+            
+            case ASTSlot_ForClauses:
+            {
+                AST_For_Clauses clauses = ExtraData<AST_For_Clauses>(source, *slot);
+                
+                *slot = PushExtraData(tree, AST_For_Clauses{remap[clauses.init], remap[clauses.condition], remap[clauses.step]});
+            } break;
+            
+            INVALID_DEFAULT_CASE;
+        }
+    }
+    
+    return PushNode(tree, kind, source->main_tokens.data[node] + token_shift, data.lhs, data.rhs);
+}
+
+#define AST_SUBTREE_EXPANDED 0x80000000
+
+// NOTE(soimn): Copies the subtree of a node in another tree to the end of the tree, and returns the copy of the
+//              node. Unlike AppendNodes this works on any subtree, since the extra data records are rebuilt rather
+//              than copied, and the token indices of the nodes are shifted by token_shift, for trees whose token
+//              arrays hold the same tokens at different positions. The shift wraps around, so it can be negative.
+//
+//              The nodes are copied in post-order, the same order the parser pushes them in, with an explicit
+//              stack in which the top bit of an entry marks a node whose children have been pushed. remap has room
+//              for every node of the source tree, and maps the nodes that were copied to their copies, with
+//              remap[NODE_NONE] = NODE_NONE.
+inline Node_Index
+CopySubtree(Syntax_Tree* tree, Syntax_Tree* source, Node_Index root, U32 token_shift, Node_Index* remap, Dynamic_Array<Node_Index>* stack)
+{
+    remap[NODE_NONE] = NODE_NONE;
+    
+    UMM base = stack->count;
+    *PushElement(stack) = root;
+    
+    while (stack->count > base)
+    {
+        Node_Index entry = stack->data[stack->count - 1];
+        
+        if (!(entry & AST_SUBTREE_EXPANDED))
+        {
+            stack->data[stack->count - 1] = entry | AST_SUBTREE_EXPANDED;
+            
+            // NOTE(soimn): Children are reversed in place, so the first child is copied first
+            UMM first = stack->count;
+            PushNodeChildren(source, entry, stack);
+            
+            for (UMM i = first, j = stack->count - 1; i < j; ++i, --j)
+            {
+                Node_Index temp = stack->data[i];
+                stack->data[i]  = stack->data[j];
+                stack->data[j]  = temp;
+            }
+        }
+        
+        else
+        {
+            PopElements(stack, 1);
+            
+            Node_Index node = entry & ~AST_SUBTREE_EXPANDED;
+            remap[node]     = CopyNode(tree, source, node, token_shift, remap);
+        }
+    }
     
-    // ...
-};
\ No newline at end of file
+    return remap[root];
+}
@@ -0,0 +1,313 @@
+#pragma once
+
+#include "common.h"
+#include "memory.h"
+#include "string.h"
+#include "hash_map.h"
+#include "diagnostics.h"
+#include "lexer.h"
+#include "ast.h"
+
+inline bool
+WriteEntireFile(const char* path, void* data, UMM size);
+
+// NOTE(soimn): The AST cache stores the tokens and syntax tree of a file in a position independent binary format,
+//              so files that have not changed since the last compilation skip lexing and parsing. Everything in the
+//              file is referred to by offset or index, and the node arrays of the tree are used in place from a read
+//              only mapping of the cache file. Only the tokens are rebuilt on load, since the strings of tokens are
+//              stream intervals, which hold a pointer. The cache is tied to the source by a hash and the size of
+//              its contents, and to the compiler by the format version and the number of node kinds and token
+//              types.
+//
+//              Layout, with every section aligned to 8 bytes:
+//              AST_Cache_Header
+//              AST_Cache_Token  tokens[token_count]
+//              U8               kinds[node_count]
+//              U32              main_tokens[node_count]
+//              AST_Node_Data    data[node_count]
+//              U32              extra_data[extra_count]
+//              U8               strings[string_size], preceded by room for a Bucket_Array_Block header
+//
+//              The strings of all tokens are interned into the string table, so every identifier is stored once.
+//              Token locations are stored without a file ID, which is filled in on load.
+
+// NOTE(soimn): Has to be bumped when the layout of the cache, a node kind or an extra data record changes
+#define AST_CACHE_VERSION 2
+#define AST_CACHE_MAGIC 0x43414E47 // GNAC
+
+struct AST_Cache_Header
+{
+    U32 magic;
+    U32 version;
+    U32 node_kind_count;
+    U32 token_type_count;
+    
+    U64 content_hash;
+    U64 content_size;
+    
+    U32 token_count;
+    U32 node_count;
+    U32 extra_count;
+    U32 string_size;
+    
+    U64 tokens_offset;
+    U64 kinds_offset;
+    U64 main_tokens_offset;
+    U64 data_offset;
+    U64 extra_offset;
+    U64 strings_offset;
+    U64 file_size;
+};
+
+// NOTE(soimn): The payload is the string of the token as offset | size << 32 in the string table, or the first 8
+//              bytes of the token value for tokens without a string
+struct AST_Cache_Token
+{
+    U32 type;
+    U32 padding;
+    U64 location;
+    U64 payload;
+};
+
+inline U64
+ContentHash(String contents)
+{
+    return HashString(contents);
+}
+
+inline U64
+AlignCacheOffset(U64 offset)
+{
+    return offset + (8 - offset % 8) % 8;
+}
+
+// NOTE(soimn): Lays out the sections after the header and fills in their offsets and the file size
+inline void
+LayoutASTCache(AST_Cache_Header* header)
+{
+    U64 offset = sizeof(AST_Cache_Header);
+    
+    header->tokens_offset      = offset;
+    offset = AlignCacheOffset(offset + (U64)header->token_count * sizeof(AST_Cache_Token));
+    
+    header->kinds_offset       = offset;
+    offset = AlignCacheOffset(offset + (U64)header->node_count * sizeof(Enum8(AST_NODE_KIND)));
+    
+    header->main_tokens_offset = offset;
+    offset = AlignCacheOffset(offset + (U64)header->node_count * sizeof(U32));
+    
+    header->data_offset        = offset;
+    offset = AlignCacheOffset(offset + (U64)header->node_count * sizeof(AST_Node_Data));
+    
+    header->extra_offset       = offset;
+    offset = AlignCacheOffset(offset + (U64)header->extra_count * sizeof(U32));
+    
+    header->strings_offset     = AlignCacheOffset(offset + sizeof(Bucket_Array_Block));
+    header->file_size          = header->strings_offset + header->string_size;
+}
+
+// NOTE(soimn): Writes the cache of a tree. Trees with unparsed function bodies are not cached, since a tree loaded
+//              from the cache cannot be added to. Returns false when nothing was written.
+inline bool
+WriteASTCache(const char* path, Syntax_Tree* tree, U64 content_hash, U64 content_size, Memory_Arena* scratch)
+{
+    bool result = false;
+    
+    bool is_complete = true;
+    for (UMM i = 0; i < tree->kinds.count; ++i)
+    {
+        if (tree->kinds.data[i] == ASTNode_LazyBlock)
+        {
+            is_complete = false;
+            break;
+        }
+    }
+    
+    if (is_complete)
+    {
+        AST_Cache_Header header = {};
+        header.magic            = AST_CACHE_MAGIC;
+        header.version          = AST_CACHE_VERSION;
+        header.node_kind_count  = AST_NODE_KIND_COUNT;
+        header.token_type_count = LEXER_TOKEN_TYPE_COUNT;
+        header.content_hash     = content_hash;
+        header.content_size     = content_size;
+        header.token_count      = (U32)tree->tokens.count;
+        header.node_count       = NodeCount(tree);
+        header.extra_count      = (U32)tree->extra_data.count;
+        
+        AST_Cache_Token* tokens = PushArray(scratch, AST_Cache_Token, MAX(header.token_count, 1));
+        String* strings         = PushArray(scratch, String, MAX(header.token_count, 1));
+        U32 string_count        = 0;
+        
+        Hash_Map<String, U32> string_offsets = HashMap<String, U32>(scratch);
+        
+        for (U32 i = 0; i < header.token_count; ++i)
+        {
+            Token* token = &tree->tokens.data[i];
+            
+            tokens[i] = {};
+            tokens[i].type     = token->type;
+            tokens[i].location = token->location & ((1ULL << (SOURCE_LOCATION_LINE_BITS + SOURCE_LOCATION_COLUMN_BITS)) - 1);
+            
+            if (TokenHasString(token->type))
+            {
+                if (token->string.size != 0)
+                {
+                    String string = Linearize(token->string, scratch);
+                    U32* offset   = Lookup(&string_offsets, string);
+                    
+                    if (!offset)
+                    {
+                        offset = Insert(&string_offsets, string, header.string_size);
+                        
+                        strings[string_count++] = string;
+                        header.string_size     += (U32)string.size;
+                    }
+                    
+                    tokens[i].payload = (U64)*offset | (U64)string.size << 32;
+                }
+            }
+            
+            else
+            {
+                Copy(&token->num_u64, &tokens[i].payload, sizeof(U64));
+            }
+        }
+        
+        LayoutASTCache(&header);
+        
+        U8* file = (U8*)PushSize(scratch, header.file_size, 8);
+        ZeroSize(file, header.file_size);
+        
+        Copy(&header, file, sizeof(header));
+        
+        struct { U64 offset; void* data; UMM size; } sections[] = {
+            {header.tokens_offset,      tokens,                 header.token_count * sizeof(AST_Cache_Token)},
+            {header.kinds_offset,       tree->kinds.data,       header.node_count * sizeof(Enum8(AST_NODE_KIND))},
+            {header.main_tokens_offset, tree->main_tokens.data, header.node_count * sizeof(U32)},
+            {header.data_offset,        tree->data.data,        header.node_count * sizeof(AST_Node_Data)},
+            {header.extra_offset,       tree->extra_data.data,  header.extra_count * sizeof(U32)},
+        };
+        
+        for (UMM i = 0; i < ARRAY_COUNT(sections); ++i)
+        {
+            if (sections[i].size != 0) Copy(sections[i].data, file + sections[i].offset, sections[i].size);
+        }
+        
+        U8* string_table = file + header.strings_offset;
+        for (U32 i = 0; i < string_count; ++i)
+        {
+            Copy(strings[i].data, string_table, strings[i].size);
+            string_table += strings[i].size;
+        }
+        
+        result = WriteEntireFile(path, file, header.file_size);
+    }
+    
+    return result;
+}
+
+template<typename T>
+inline Dynamic_Array<T>
+MappedArray(U8* view, U64 offset, UMM count)
+{
+    Dynamic_Array<T> result = {};
+    result.data            = (T*)(view + offset);
+    result.count           = count;
+    result.committed_count = count;
+    result.reserved_count  = count;
+    
+    return result;
+}
+
+// NOTE(soimn): Loads the cached tree of a file, if the cache exists and matches both the contents of the file and
+//              this version of the compiler. The tree keeps the cache file mapped until it is freed.
+inline bool
+LoadASTCache(const char* path, File_ID file, U64 content_hash, U64 content_size, Syntax_Tree* tree)
+{
+    bool result = false;
+    
+    UMM size = 0;
+    U8* view = (U8*)MapFile(path, &size);
+    
+    AST_Cache_Header header = {};
+    if (view && size >= sizeof(AST_Cache_Header)) Copy(view, &header, sizeof(header));
+    
+    bool is_valid = (header.magic            == AST_CACHE_MAGIC       &&
+                     header.version          == AST_CACHE_VERSION     &&
+                     header.node_kind_count  == AST_NODE_KIND_COUNT   &&
+                     header.token_type_count == LEXER_TOKEN_TYPE_COUNT &&
+                     header.content_hash     == content_hash          &&
+                     header.content_size     == content_size          &&
+                     header.token_count      != 0);
+    
+    if (is_valid)
+    {
+        // NOTE(soimn): The offsets are recomputed rather than trusted, which also checks that they fit in the file
+        AST_Cache_Header layout = header;
+        LayoutASTCache(&layout);
+        
+        is_valid = (MemoryEquals(&layout, &header, sizeof(header)) && header.file_size == size);
+    }
+    
+    if (is_valid)
+    {
+        AST_Cache_Token* cached_tokens = (AST_Cache_Token*)(view + header.tokens_offset);
+        
+        String_Stream_Interval string = {};
+        string.first_block = (Bucket_Array_Block*)(view + header.strings_offset) - 1;
+        string.block_size  = MAX(header.string_size, 1);
+        
+        U64 file_bits = (U64)file << (SOURCE_LOCATION_LINE_BITS + SOURCE_LOCATION_COLUMN_BITS);
+        
+        Dynamic_Array<Token> tokens = DynamicArray<Token>(header.token_count * sizeof(Token));
+        Token* token                = PushElements(&tokens, header.token_count);
+        
+        for (U32 i = 0; i < header.token_count && is_valid; ++i, ++token)
+        {
+            AST_Cache_Token* cached = &cached_tokens[i];
+            
+            *token = {};
+            token->type     = cached->type;
+            token->location = cached->location | file_bits;
+            
+            if (TokenHasString(token->type))
+            {
+                string.index = (U32)cached->payload;
+                string.size  = (U32)(cached->payload >> 32);
+                
+                is_valid = (string.index + string.size <= header.string_size);
+                
+                if (string.size != 0) token->string = string;
+            }
+            
+            else
+            {
+                Copy(&cached->payload, &token->num_u64, sizeof(U64));
+            }
+        }
+        
+        if (is_valid)
+        {
+            *tree = {};
+            tree->tokens      = tokens;
+            tree->kinds       = MappedArray<Enum8(AST_NODE_KIND)>(view, header.kinds_offset, header.node_count);
+            tree->main_tokens = MappedArray<U32>(view, header.main_tokens_offset, header.node_count);
+            tree->data        = MappedArray<AST_Node_Data>(view, header.data_offset, header.node_count);
+            tree->extra_data  = MappedArray<U32>(view, header.extra_offset, header.extra_count);
+            tree->mapping     = view;
+            
+            result = true;
+        }
+        
+        else
+        {
+            FreeArray(&tokens);
+        }
+    }
+    
+    if (view && !result) UnmapFile(view);
+    
+    return result;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "common.h"
+
+#include <intrin.h>
+#include <emmintrin.h>
+
+// NOTE(soimn): Thin wrappers around the interlocked intrinsics. All of them are full barriers on x64.
+
+inline U32
+AtomicAdd(volatile U32* value, U32 addend)
+{
+    return (U32)_InterlockedExchangeAdd((volatile long*)value, (long)addend);
+}
+
+inline U64
+AtomicAdd(volatile U64* value, U64 addend)
+{
+    return (U64)_InterlockedExchangeAdd64((volatile long long*)value, (long long)addend);
+}
+
+inline U32
+AtomicCompareExchange(volatile U32* value, U32 new_value, U32 expected)
+{
+    return (U32)_InterlockedCompareExchange((volatile long*)value, (long)new_value, (long)expected);
+}
+
+inline U64
+AtomicCompareExchange(volatile U64* value, U64 new_value, U64 expected)
+{
+    return (U64)_InterlockedCompareExchange64((volatile long long*)value, (long long)new_value, (long long)expected);
+}
+
+inline I64
+AtomicCompareExchange(volatile I64* value, I64 new_value, I64 expected)
+{
+    return (I64)_InterlockedCompareExchange64((volatile long long*)value, (long long)new_value, (long long)expected);
+}
+
+inline U32
+AtomicExchange(volatile U32* value, U32 new_value)
+{
+    return (U32)_InterlockedExchange((volatile long*)value, (long)new_value);
+}
+
+// NOTE(soimn): x64 may move a load ahead of an earlier store to a different address, which this prevents. Every
+//              other reordering is already ruled out by the hardware, and only has to be kept from the compiler.
+inline void
+MemoryFence()
+{
+    _mm_mfence();
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): Test and test-and-set lock. Meant for short critical sections, like pushing to a shared array,
+//              where sleeping on a kernel object would cost more than the work being protected.
+struct Spin_Lock
+{
+    volatile U32 is_locked;
+};
+
+inline void
+LockSpinLock(Spin_Lock* lock)
+{
+    for (;;)
+    {
+        if (!lock->is_locked && AtomicExchange(&lock->is_locked, 1) == 0)
+        {
+            break;
+        }
+        
+        _mm_pause();
+    }
+}
+
+inline void
+UnlockSpinLock(Spin_Lock* lock)
+{
+    _ReadWriteBarrier();
+    lock->is_locked = 0;
+}
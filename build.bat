@@ -1,10 +1,20 @@
 @echo off
 set "ignored_errors= /wd4710 /wd4820 /wd4100 /wd4201 /wd5045"
-set "common_compiler_flags= /diagnostics:column /MT /Gm- /FC /Wall %ignored_errors% /Od /Oi /std:c++17 /nologo /GR- /MP /Zo /Zf /Z7 /DEBUG"
+set "common_compiler_flags= /diagnostics:column /MT /Gm- /FC /Wall %ignored_errors% /Oi /std:c++17 /nologo /GR- /MP /Zo /Zf /Z7 /DEBUG"
 set "libs= user32.lib kernel32.lib"
 
+REM NOTE(soimn): "build.bat tests" builds the test and benchmark driver instead of the compiler, with optimizations,
+REM              as its benchmarks are meaningless in a debug build
+set "source_file=gnom.cpp"
+set "optimization_flags= /Od"
+
+if "%1"=="tests" (
+    set "source_file=gnom_tests.cpp"
+    set "optimization_flags= /O2"
+)
+
 pushd D:\Gnom\build
 
-cl %common_compiler_flags% -ID:\WindowsSDK\ -ID:\msvc_build_tools\VC\Tools\MSVC\14.22.27905\include .\..\gnom.cpp /link /INCREMENTAL:NO /LIBPATH:D:\WindowsSDK %libs% /opt:ref
+cl %common_compiler_flags% %optimization_flags% -ID:\WindowsSDK\ -ID:\msvc_build_tools\VC\Tools\MSVC\14.22.27905\include .\..\%source_file% /link /INCREMENTAL:NO /LIBPATH:D:\WindowsSDK %libs% /opt:ref
 
 popd
\ No newline at end of file
@@ -0,0 +1,853 @@
+#pragma once
+
+#include "common.h"
+#include "atomics.h"
+#include "memory.h"
+#include "string.h"
+#include "hash_map.h"
+#include "diagnostics.h"
+#include "jobs.h"
+#include "ast.h"
+#include "parser.h"
+#include "module.h"
+#include "symbols.h"
+
+// NOTE(soimn): Top level declarations may refer to each other regardless of the order they are declared in, so
+//              they are checked in dependency order, which is found while checking rather than up front. Every top
+//              level declaration is a job, and every variable of a variable declaration a job of its own. A job
+//              collects the names it refers to that are declared at the top level, and then goes through them in
+//              order. When it reaches one that is not yet resolved, it suspends on that job and is submitted to the
+//              job system again once it is. A job is resolved when it has gone through all of its references.
+//
+//              Only references that need the referred to declaration to be resolved are followed. Function bodies
+//              are checked on their own later, and a type behind a pointer does not need to be complete, so
+//              neither is followed, which is what lets a struct refer to itself through a pointer.
+//
+//              When no job is running and none is ready, every remaining job waits on another, and the chain of
+//              waits from any of them ends in a cycle. The cycles are reported and broken by letting the jobs in
+//              them skip references to each other, after which checking continues, so jobs that only depend on a
+//              cycle are still resolved.
+//
+//              Every job is first run from a ParallelFor on the job system, and resumed jobs are submitted to the
+//              worker that resolved the job they waited on. Resumed jobs are counted by a job counter, so once the
+//              ParallelFor is done, waiting on the counter waits until no job is running and none is ready. The
+//              waiters of a job are a linked list through the waiting jobs, guarded by a lock in the job, so a job
+//              cannot suspend on another while it is being resolved.
+//
+//              The order jobs were resolved in is kept, which is a dependency order of the declarations, with the
+//              cycles broken.
+
+#define CHECK_JOB_NONE U32_MAX
+
+// NOTE(soimn): Jobs are run in batches of this many by the ParallelFor, as a single job is only a few references
+#define CHECK_JOBS_PER_BATCH 64
+
+enum CHECK_JOB_STATE
+{
+    CheckJob_Ready,
+    CheckJob_Suspended,
+    CheckJob_Resolved,
+};
+
+// NOTE(soimn): A name referring to a top level declaration, and the job of that declaration
+struct Check_Reference
+{
+    Node_Index node;
+    U32 target;
+};
+
+struct Check_Job
+{
+    Source_File* file;
+    Node_Index declaration;
+    
+    // NOTE(soimn): The variable for a job of a variable declaration, and the declaration itself for the others
+    Node_Index entity;
+    Atom name;
+    
+    Check_Reference* references;
+    U32 reference_count;
+    U32 cursor;
+    bool has_references;
+    bool is_cyclic;
+    
+    Spin_Lock lock;
+    volatile U32 state;
+    U32 waiting_on;
+    U32 first_waiter;
+    U32 next_waiter;
+    
+    U32 visit;
+};
+
+struct Checker
+{
+    Memory_Arena arena;
+    
+    Check_Job* jobs;
+    U32 job_count;
+    
+    // NOTE(soimn): The jobs in the order they were resolved in
+    U32* order;
+    U32 resolved_count;
+    
+    Memory_Arena worker_arenas[JOB_SYSTEM_MAX_WORKERS];
+    U32 worker_count;
+};
+
+struct Check_Worker
+{
+    bool is_checking;
+    
+    Dynamic_Array<Node_Index> stack;
+    Dynamic_Array<Check_Reference> references;
+};
+
+struct Check_Batch
+{
+    Checker* checker;
+    Atom_Table* atoms;
+    Atom_Cache* atom_caches;
+    Diagnostics_Engine* diagnostics;
+    Check_Worker* workers;
+    
+    Hash_Map<Atom, U32> declarations;
+    
+    Job_Counter counter;
+    volatile U32 resolved_count;
+    U32 max_node_count;
+};
+
+inline Source_Location
+JobLocation(Check_Job* job)
+{
+    return NodeToken(&job->file->tree, job->entity)->location;
+}
+
+// NOTE(soimn): Returns ATOM_NONE for the keyword of an unnamed struct, union or enum
+inline Atom
+NodeName(Atom_Cache* atoms, Syntax_Tree* tree, Node_Index node, Memory_Arena* scratch)
+{
+    Atom result = ATOM_NONE;
+    
+    Token* token = NodeToken(tree, node);
+    
+    if (token->type == Token_Identifier)
+    {
+        result = Intern(atoms, Linearize(token->string, scratch));
+    }
+    
+    return result;
+}
+
+inline void
+CheckJob(Job_Worker* worker, void* data, UMM start, UMM end);
+
+inline void
+CollectReferences(Job_Worker* worker, Check_Batch* batch, Check_Job* job)
+{
+    Check_Worker* check_worker = &batch->workers[worker->index];
+    Syntax_Tree* tree          = &job->file->tree;
+    
+    if (!check_worker->is_checking)
+    {
+        check_worker->stack       = DynamicArray<Node_Index>(MAX(batch->max_node_count, 1) * sizeof(Node_Index));
+        check_worker->references  = DynamicArray<Check_Reference>(MAX(batch->max_node_count, 1) * sizeof(Check_Reference));
+        check_worker->is_checking = true;
+    }
+    
+    Dynamic_Array<Node_Index>* stack           = &check_worker->stack;
+    Dynamic_Array<Check_Reference>* references = &check_worker->references;
+    ResetArray(stack);
+    ResetArray(references);
+    
+    Enum8(AST_NODE_KIND) kind = NodeKind(tree, job->declaration);
+    AST_Node_Data data        = *NodeData(tree, job->declaration);
+    
+    // NOTE(soimn): The arguments of tags can refer to other declarations, just like the type can
+    AST_Range tags = NodeTags(tree, job->declaration);
+    
+    for (U32 i = tags.start; i < tags.end; ++i)
+    {
+        *PushElement(stack) = tree->extra_data.data[i];
+    }
+    
+    if (kind == ASTNode_VarDecl)
+    {
+        Node_Index initializer = NodeData(tree, job->entity)->lhs;
+        
+        if (initializer != NODE_NONE) *PushElement(stack) = initializer;
+        *PushElement(stack) = data.lhs;
+    }
+    
+    else if (kind == ASTNode_FunctionDecl || kind == ASTNode_FunctionDef)
+    {
+        AST_Function_Prototype prototype = ExtraData<AST_Function_Prototype>(tree, data.lhs);
+        
+        for (U32 i = prototype.parameters_start; i < prototype.parameters_end; ++i)
+        {
+            *PushElement(stack) = tree->extra_data.data[i];
+        }
+        
+        if (prototype.return_type != NODE_NONE) *PushElement(stack) = prototype.return_type;
+    }
+    
+    else
+    {
+        *PushElement(stack) = job->declaration;
+    }
+    
+    while (stack->count != 0)
+    {
+        Node_Index node = stack->data[stack->count - 1];
+        PopElements(stack, 1);
+        
+        switch (NodeKind(tree, node))
+        {
+            case ASTNode_PointerType:
+                break;
+            
+            case ASTNode_TypeName:
+            case ASTNode_Identifier:
+            {
+                Atom name   = NodeName(&batch->atom_caches[worker->index], tree, node, &worker->scratch);
+                U32* target = Lookup(&batch->declarations, name);
+                
+                if (target) *PushElement(references) = {node, *target};
+            } break;
+            
+            default:
+            {
+                PushNodeChildren(tree, node, stack);
+            } break;
+        }
+    }
+    
+    job->reference_count = (U32)references->count;
+    job->references      = PushArray(&batch->checker->worker_arenas[worker->index], Check_Reference, MAX(job->reference_count, 1));
+    job->has_references  = true;
+    
+    if (job->reference_count != 0)
+    {
+        CopyArray(references->data, job->references, job->reference_count);
+    }
+    
+    ResetArena(&worker->scratch);
+}
+
+// NOTE(soimn): Suspends the job on the target, unless the target is already resolved. Returns whether it was.
+inline bool
+WaitForJob(Check_Batch* batch, U32 index, U32 target)
+{
+    Check_Job* job        = &batch->checker->jobs[index];
+    Check_Job* target_job = &batch->checker->jobs[target];
+    
+    bool result = (target_job->state == CheckJob_Resolved);
+    
+    if (!result)
+    {
+        LockSpinLock(&target_job->lock);
+        
+        result = (target_job->state == CheckJob_Resolved);
+        
+        if (!result)
+        {
+            job->state       = CheckJob_Suspended;
+            job->waiting_on  = target;
+            job->next_waiter = target_job->first_waiter;
+            
+            target_job->first_waiter = index;
+        }
+        
+        UnlockSpinLock(&target_job->lock);
+    }
+    
+    return result;
+}
+
+inline void
+RunCheckJob(Job_Worker* worker, Check_Batch* batch, U32 index)
+{
+    Checker* checker = batch->checker;
+    Check_Job* job   = &checker->jobs[index];
+    
+    if (!job->has_references) CollectReferences(worker, batch, job);
+    
+    bool is_suspended = false;
+    
+    for (; job->cursor < job->reference_count; ++job->cursor)
+    {
+        U32 target = job->references[job->cursor].target;
+        
+        if (target == index)
+        {
+            // NOTE(soimn): The enumerators of an enum are part of the same job, and may refer to each other
+            if (NodeKind(&job->file->tree, job->declaration) != ASTNode_EnumDef && !job->is_cyclic)
+            {
+                Diagnose(batch->diagnostics, Error, JobLocation(job), CyclicDependency, AtomString(batch->atoms, job->name));
+                job->is_cyclic = true;
+            }
+        }
+        
+        else if (job->is_cyclic && checker->jobs[target].is_cyclic)
+        {
+            // NOTE(soimn): A reference within a reported cycle, which is what breaks the cycle
+        }
+        
+        else
+        {
+            is_suspended = !WaitForJob(batch, index, target);
+            
+            // NOTE(soimn): The reference is followed again when the job is resumed
+            if (is_suspended) break;
+        }
+    }
+    
+    if (!is_suspended)
+    {
+        LockSpinLock(&job->lock);
+        
+        job->state = CheckJob_Resolved;
+        
+        U32 waiter = job->first_waiter;
+        job->first_waiter = CHECK_JOB_NONE;
+        
+        UnlockSpinLock(&job->lock);
+        
+        checker->order[AtomicAdd(&batch->resolved_count, 1)] = index;
+        
+        while (waiter != CHECK_JOB_NONE)
+        {
+            Check_Job* waiting_job = &checker->jobs[waiter];
+            U32 next_waiter        = waiting_job->next_waiter;
+            
+            waiting_job->state = CheckJob_Ready;
+            SubmitJob(worker, CheckJob, batch, &batch->counter, waiter, waiter + 1);
+            
+            waiter = next_waiter;
+        }
+    }
+}
+
+inline void
+CheckJob(Job_Worker* worker, void* data, UMM start, UMM end)
+{
+    Check_Batch* batch = (Check_Batch*)data;
+    
+    for (UMM i = start; i < end; ++i)
+    {
+        RunCheckJob(worker, batch, (U32)i);
+    }
+}
+
+// NOTE(soimn): Reports the cycles in the waits of the suspended jobs, and resumes the jobs in them. This is only
+//              called when no job is running and none is ready.
+inline void
+BreakDependencyCycles(Job_Worker* worker, Check_Batch* batch)
+{
+    Checker* checker = batch->checker;
+    
+    for (U32 i = 0; i < checker->job_count; ++i) checker->jobs[i].visit = CHECK_JOB_NONE;
+    
+    for (U32 i = 0; i < checker->job_count; ++i)
+    {
+        U32 current = i;
+        
+        while (checker->jobs[current].state == CheckJob_Suspended && checker->jobs[current].visit == CHECK_JOB_NONE)
+        {
+            checker->jobs[current].visit = i;
+            current = checker->jobs[current].waiting_on;
+        }
+        
+        // NOTE(soimn): The walk from i ran into itself, rather than into a job visited by an earlier walk
+        if (checker->jobs[current].state == CheckJob_Suspended && checker->jobs[current].visit == i)
+        {
+            U32 member = current;
+            
+            do
+            {
+                Check_Job* job    = &checker->jobs[member];
+                Check_Job* target = &checker->jobs[job->waiting_on];
+                
+                Diagnose(batch->diagnostics, Error, JobLocation(job), CyclicDependencyThrough,
+                         AtomString(batch->atoms, job->name), AtomString(batch->atoms, target->name));
+                
+                // NOTE(soimn): The job is unlinked from the waiters of its target, since it is resumed now rather
+                //              than when the target is resolved
+                U32* link = &target->first_waiter;
+                while (*link != member) link = &checker->jobs[*link].next_waiter;
+                *link = job->next_waiter;
+                
+                job->is_cyclic = true;
+                
+                member = job->waiting_on;
+            } while (member != current);
+            
+            do
+            {
+                Check_Job* job = &checker->jobs[member];
+                
+                job->state = CheckJob_Ready;
+                SubmitJob(worker, CheckJob, batch, &batch->counter, member, member + 1);
+                
+                member = job->waiting_on;
+            } while (member != current);
+        }
+    }
+}
+
+// NOTE(soimn): Definitions take the name over from forward declarations, and otherwise the first declaration of
+//              a name keeps it
+inline void
+DeclareJob(Check_Batch* batch, Atom name, U32 index)
+{
+    if (name != ATOM_NONE)
+    {
+        Check_Job* jobs = batch->checker->jobs;
+        U32* existing   = Lookup(&batch->declarations, name);
+        
+        if (!existing)
+        {
+            Insert(&batch->declarations, name, index);
+        }
+        
+        else
+        {
+            Check_Job* job = &jobs[*existing];
+            
+            Enum8(AST_NODE_KIND) kind = NodeKind(&job->file->tree, job->declaration);
+            
+            if (kind == ASTNode_StructDecl || kind == ASTNode_UnionDecl || kind == ASTNode_FunctionDecl)
+            {
+                *existing = index;
+            }
+        }
+    }
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): Function bodies are checked once every top level declaration is resolved, and the bodies that were
+//              left unparsed by lazy_function_bodies are parsed when they are checked. Parsing a lazy body appends to
+//              the tree of its file, so the bodies are checked one file per job, and a tree is only touched by the
+//              worker that checks its file.
+//
+//              Names in a body are looked up from the innermost scope outward in the symbol table of the worker,
+//              which holds the parameters and locals of the function being checked, and then among the top level
+//              declarations of the module. Type names are not looked up, since the builtin types are not declared
+//              anywhere.
+
+enum CHECK_BODY_ACTION
+{
+    CheckBody_Visit,
+    CheckBody_Declare,  // Declares a variable, once its initializer has been visited
+    CheckBody_PopScope, // Closes the scope of a block or for statement, once its children have been visited
+};
+
+struct Check_Body_Entry
+{
+    Node_Index node;
+    Enum8(CHECK_BODY_ACTION) action;
+};
+
+struct Body_Worker
+{
+    bool is_checking;
+    
+    Parser parser;
+    Symbol_Table symbols;
+    
+    Dynamic_Array<Check_Body_Entry> stack;
+    Dynamic_Array<Node_Index> children;
+};
+
+struct Body_Batch
+{
+    Module* module;
+    Atom_Cache* atom_caches;
+    Diagnostics_Engine* diagnostics;
+    Hash_Map<Atom, U32>* declarations;
+    Body_Worker* workers;
+    
+    UMM max_node_count;
+};
+
+// NOTE(soimn): Pushes the children of the node, so they are visited in source order
+inline void
+PushBodyChildren(Body_Worker* body_worker, Syntax_Tree* tree, Node_Index node)
+{
+    Dynamic_Array<Node_Index>* children = &body_worker->children;
+    ResetArray(children);
+    
+    PushNodeChildren(tree, node, children);
+    
+    for (UMM i = children->count; i > 0; --i)
+    {
+        *PushElement(&body_worker->stack) = {children->data[i - 1], CheckBody_Visit};
+    }
+}
+
+inline void
+CheckFunctionBody(Job_Worker* worker, Body_Batch* batch, Body_Worker* body_worker, Syntax_Tree* tree, Node_Index function)
+{
+    Symbol_Table* symbols                  = &body_worker->symbols;
+    Dynamic_Array<Check_Body_Entry>* stack = &body_worker->stack;
+    Atom_Cache* atoms                      = &batch->atom_caches[worker->index];
+    
+    bool is_lazy    = (NodeKind(tree, NodeData(tree, function)->rhs) == ASTNode_LazyBlock);
+    Node_Index body = ParseFunctionBody(&body_worker->parser, function);
+    
+    // NOTE(soimn): Names are not looked up in a body with syntax errors, which would mostly report errors caused by
+    //              them. Bodies that were parsed with the rest of the file are only checked when it had no errors.
+    if (!is_lazy || body_worker->parser.error_count == 0)
+    {
+        AST_Function_Prototype prototype = ExtraData<AST_Function_Prototype>(tree, NodeData(tree, function)->lhs);
+        
+        ResetSymbolTable(symbols);
+        PushScope(symbols);
+        
+        for (U32 i = prototype.parameters_start; i < prototype.parameters_end; ++i)
+        {
+            Node_Index parameter = tree->extra_data.data[i];
+            
+            if (NodeKind(tree, parameter) == ASTNode_Parameter)
+            {
+                DeclareSymbol(symbols, {NodeName(atoms, tree, parameter, &worker->scratch), parameter, Symbol_Parameter});
+            }
+        }
+        
+        ResetArray(stack);
+        *PushElement(stack) = {body, CheckBody_Visit};
+        
+        while (stack->count != 0)
+        {
+            Check_Body_Entry entry = stack->data[stack->count - 1];
+            PopElements(stack, 1);
+            
+            Node_Index node = entry.node;
+            
+            if (entry.action == CheckBody_PopScope)
+            {
+                PopScope(symbols);
+            }
+            
+            else if (entry.action == CheckBody_Declare)
+            {
+                DeclareSymbol(symbols, {NodeName(atoms, tree, node, &worker->scratch), node, Symbol_Variable});
+            }
+            
+            else switch (NodeKind(tree, node))
+            {
+                case ASTNode_TypeName:
+                case ASTNode_PointerType:
+                    break;
+                
+                case ASTNode_Block:
+                case ASTNode_For:
+                {
+                    PushScope(symbols);
+                    
+                    *PushElement(stack) = {node, CheckBody_PopScope};
+                    PushBodyChildren(body_worker, tree, node);
+                } break;
+                
+                case ASTNode_Variable:
+                {
+                    *PushElement(stack) = {node, CheckBody_Declare};
+                    PushBodyChildren(body_worker, tree, node);
+                } break;
+                
+                case ASTNode_Identifier:
+                {
+                    Atom name = NodeName(atoms, tree, node, &worker->scratch);
+                    
+                    if (LookupSymbol(symbols, name) == SYMBOL_NONE && !Lookup(batch->declarations, name))
+                    {
+                        Diagnose(batch->diagnostics, Error, NodeToken(tree, node)->location, UndeclaredName, AtomString(atoms->table, name));
+                    }
+                } break;
+                
+                default:
+                {
+                    PushBodyChildren(body_worker, tree, node);
+                } break;
+            }
+        }
+        
+        PopScope(symbols);
+    }
+}
+
+inline void
+CheckBodiesJob(Job_Worker* worker, void* data, UMM start, UMM end)
+{
+    Body_Batch* batch        = (Body_Batch*)data;
+    Body_Worker* body_worker = &batch->workers[worker->index];
+    
+    if (!body_worker->is_checking)
+    {
+        body_worker->parser      = ParserState(0, batch->diagnostics, PARSER_DEFAULT_MAX_ERRORS);
+        body_worker->symbols     = SymbolTable();
+        body_worker->stack       = DynamicArray<Check_Body_Entry>(MAX(batch->max_node_count, 1) * sizeof(Check_Body_Entry));
+        body_worker->children    = DynamicArray<Node_Index>(MAX(batch->max_node_count, 1) * sizeof(Node_Index));
+        body_worker->is_checking = true;
+    }
+    
+    for (UMM i = start; i < end; ++i)
+    {
+        Source_File* file = &batch->module->files[i];
+        Syntax_Tree* tree = &file->tree;
+        
+        if (!file->is_loaded) continue;
+        
+        body_worker->parser.tree = tree;
+        
+        AST_Range declarations = NodeChildren(tree, 0);
+        
+        for (U32 j = declarations.start; j < declarations.end; ++j)
+        {
+            Node_Index declaration = tree->extra_data.data[j];
+            
+            if (NodeKind(tree, declaration) == ASTNode_FunctionDef)
+            {
+                CheckFunctionBody(worker, batch, body_worker, tree, declaration);
+            }
+        }
+        
+        ResetArena(&worker->scratch);
+    }
+}
+
+// NOTE(soimn): Checks the function bodies of every parsed file in the module, against the top level declarations
+//              found by CheckModule
+inline void
+CheckFunctionBodies(Job_Worker* worker, Module* module, Atom_Cache* atom_caches, Diagnostics_Engine* diagnostics,
+                    Hash_Map<Atom, U32>* declarations)
+{
+    Body_Worker workers[JOB_SYSTEM_MAX_WORKERS];
+    
+    for (U32 i = 0; i < worker->system->worker_count; ++i)
+    {
+        workers[i] = {};
+    }
+    
+    Body_Batch batch = {};
+    batch.module       = module;
+    batch.atom_caches  = atom_caches;
+    batch.diagnostics  = diagnostics;
+    batch.declarations = declarations;
+    batch.workers      = workers;
+    
+    // NOTE(soimn): Parsing the lazy bodies adds nodes to the trees, so the bound is taken from the tokens
+    for (U32 i = 0; i < module->file_count; ++i)
+    {
+        batch.max_node_count = MAX(batch.max_node_count, (module->files[i].tree.tokens.count + 1) * SYNTAX_TREE_NODES_PER_TOKEN);
+    }
+    
+    ParallelFor(worker, module->file_count, 1, CheckBodiesJob, &batch);
+    
+    for (U32 i = 0; i < worker->system->worker_count; ++i)
+    {
+        if (workers[i].is_checking)
+        {
+            FreeParserState(&workers[i].parser);
+            FreeSymbolTable(&workers[i].symbols);
+            FreeArray(&workers[i].stack);
+            FreeArray(&workers[i].children);
+        }
+    }
+}
+
+// NOTE(soimn): Resolves the top level declarations of every parsed file in the module, and then checks the function
+//              bodies, on the job system of the worker, which has to be the worker of the calling thread
+inline Checker
+CheckModule(Job_Worker* worker, Module* module, Atom_Table* atoms, Diagnostics_Engine* diagnostics)
+{
+    Checker checker = {};
+    
+    Memory_Arena scratch = {};
+    
+    // NOTE(soimn): Every worker interns through a cache of its own, see Atom_Cache
+    Atom_Cache atom_caches[JOB_SYSTEM_MAX_WORKERS];
+    
+    for (U32 i = 0; i < worker->system->worker_count; ++i)
+    {
+        atom_caches[i] = AtomCache(atoms);
+    }
+    
+    Atom_Cache* atom_cache = &atom_caches[worker->index];
+    
+    Check_Batch batch = {};
+    batch.checker      = &checker;
+    batch.atoms        = atoms;
+    batch.atom_caches  = atom_caches;
+    batch.diagnostics  = diagnostics;
+    batch.declarations = HashMap<Atom, U32>(&scratch);
+    
+    for (U32 i = 0; i < module->file_count; ++i)
+    {
+        Source_File* file = &module->files[i];
+        
+        if (file->is_loaded)
+        {
+            AST_Range declarations = NodeChildren(&file->tree, 0);
+            
+            for (U32 j = declarations.start; j < declarations.end; ++j)
+            {
+                Node_Index declaration    = file->tree.extra_data.data[j];
+                Enum8(AST_NODE_KIND) kind = NodeKind(&file->tree, declaration);
+                
+                if (kind == ASTNode_VarDecl)
+                {
+                    AST_Range variables = NodeVariables(&file->tree, declaration);
+                    checker.job_count  += variables.end - variables.start;
+                }
+                
+                else if (kind != ASTNode_Error)
+                {
+                    checker.job_count += 1;
+                }
+            }
+            
+            batch.max_node_count = MAX(batch.max_node_count, NodeCount(&file->tree));
+        }
+    }
+    
+    checker.jobs  = PushArray(&checker.arena, Check_Job, MAX(checker.job_count, 1));
+    checker.order = PushArray(&checker.arena, U32, MAX(checker.job_count, 1));
+    
+    U32 job_count = 0;
+    
+    for (U32 i = 0; i < module->file_count; ++i)
+    {
+        Source_File* file = &module->files[i];
+        Syntax_Tree* tree = &file->tree;
+        
+        if (!file->is_loaded) continue;
+        
+        AST_Range declarations = NodeChildren(tree, 0);
+        
+        for (U32 j = declarations.start; j < declarations.end; ++j)
+        {
+            Node_Index declaration    = tree->extra_data.data[j];
+            Enum8(AST_NODE_KIND) kind = NodeKind(tree, declaration);
+            
+            AST_Range entities = {declaration, declaration + 1};
+            bool is_list       = false;
+            
+            if (kind == ASTNode_VarDecl)
+            {
+                entities = NodeVariables(tree, declaration);
+                is_list  = true;
+            }
+            
+            else if (kind == ASTNode_Error)
+            {
+                entities = {};
+            }
+            
+            for (U32 k = entities.start; k < entities.end; ++k)
+            {
+                U32 index      = job_count++;
+                Check_Job* job = &checker.jobs[index];
+                
+                *job = {};
+                job->file         = file;
+                job->declaration  = declaration;
+                job->entity       = (is_list ? tree->extra_data.data[k] : declaration);
+                job->name         = NodeName(atom_cache, tree, job->entity, &scratch);
+                job->state        = CheckJob_Ready;
+                job->waiting_on   = CHECK_JOB_NONE;
+                job->first_waiter = CHECK_JOB_NONE;
+                job->next_waiter  = CHECK_JOB_NONE;
+                
+                DeclareJob(&batch, job->name, index);
+                
+                // NOTE(soimn): The enumerators of an enum, and the struct, union or enum defined in a typedef, are
+                //              declared at the top level as well, and resolved along with it
+                if (kind == ASTNode_EnumDef)
+                {
+                    AST_Range enumerators = ExtraData<AST_Range>(tree, NodeData(tree, declaration)->rhs);
+                    
+                    for (U32 l = enumerators.start; l < enumerators.end; ++l)
+                    {
+                        Node_Index enumerator = tree->extra_data.data[l];
+                        
+                        if (NodeKind(tree, enumerator) == ASTNode_Enumerator)
+                        {
+                            DeclareJob(&batch, NodeName(atom_cache, tree, enumerator, &scratch), index);
+                        }
+                    }
+                }
+                
+                else if (kind == ASTNode_Typedef)
+                {
+                    Node_Index type = NodeData(tree, declaration)->lhs;
+                    Enum8(AST_NODE_KIND) type_kind = NodeKind(tree, type);
+                    
+                    if (type_kind == ASTNode_StructDef || type_kind == ASTNode_UnionDef || type_kind == ASTNode_EnumDef)
+                    {
+                        DeclareJob(&batch, NodeName(atom_cache, tree, type, &scratch), index);
+                    }
+                }
+            }
+        }
+    }
+    
+    checker.worker_count = worker->system->worker_count;
+    
+    Check_Worker workers[JOB_SYSTEM_MAX_WORKERS];
+    
+    for (U32 i = 0; i < checker.worker_count; ++i)
+    {
+        workers[i] = {};
+    }
+    
+    batch.workers = workers;
+    
+    ParallelFor(worker, checker.job_count, CHECK_JOBS_PER_BATCH, CheckJob, &batch);
+    WaitForCounter(worker, &batch.counter);
+    
+    while (batch.resolved_count != checker.job_count)
+    {
+        BreakDependencyCycles(worker, &batch);
+        WaitForCounter(worker, &batch.counter);
+    }
+    
+    for (U32 i = 0; i < checker.worker_count; ++i)
+    {
+        if (workers[i].is_checking)
+        {
+            FreeArray(&workers[i].stack);
+            FreeArray(&workers[i].references);
+        }
+    }
+    
+    checker.resolved_count = batch.resolved_count;
+    
+    CheckFunctionBodies(worker, module, atom_caches, diagnostics, &batch.declarations);
+    
+    for (U32 i = 0; i < worker->system->worker_count; ++i)
+    {
+        FreeAtomCache(&atom_caches[i]);
+    }
+    
+    ClearArena(&scratch);
+    
+    return checker;
+}
+
+inline void
+FreeChecker(Checker* checker)
+{
+    for (U32 i = 0; i < checker->worker_count; ++i)
+    {
+        ClearArena(&checker->worker_arenas[i]);
+    }
+    
+    ClearArena(&checker->arena);
+    
+    *checker = {};
+}
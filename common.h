@@ -64,25 +64,53 @@
 /// ERROR HANDLING FUNCTIIONALITY
 /// 
 
-[[noreturn]]
-inline void
-AssertionFailed(const char* file, const char* function, U32 line, const char* condition_string, String message, ...);
-[[noreturn]]
+struct String_Stream;
+
+// NOTE(soimn): The format string of Print is parsed at compile time, and the arguments are checked against 
+//              the specifiers with static_assert. The local holder struct is what carries the string literal 
+//              into the template, so the format is required to be a string literal.
+template<typename Format_Holder, typename... Args>
+inline UMM
+PrintFormat(String_Stream* stream, const Args&... args);
+
+#define Print(stream, format, ...)                                          \
+([&]() -> UMM                                                               \
+{                                                                           \
+    struct Format_Holder                                                    \
+    {                                                                       \
+        static constexpr const char* Format() { return format; }            \
+        static constexpr UMM Length() { return sizeof(format) - 1; }        \
+    };                                                                      \
+                                                                            \
+    return PrintFormat<Format_Holder>(stream, ##__VA_ARGS__);               \
+}())
+
 inline void
-AssertionFailed(const char* file, const char* function, U32 line, const char* condition_string, const char* message, ...);
+BeginAssertionFailure(const char* file, const char* function, U32 line, const char* condition_string);
 
 [[noreturn]]
 inline void
-AssertionFailed(const char* file, const char* fucntion, U32 line, const char* condition_string);
+AssertionFailed();
 
 inline void
-Report(Enum8(REPORT_SEVERITY) severity, String message, ...);
+BeginReport(Enum8(REPORT_SEVERITY) severity);
 
 inline void
-Report(Enum8(REPORT_SEVERITY) severity, const char* message, ...);
+EndReport(Enum8(REPORT_SEVERITY) severity);
+
+#define Report(severity, format, ...) (BeginReport(severity), Print(ErrorStream, format, ##__VA_ARGS__), EndReport(severity))
 
+// NOTE(soimn): MSVC's traditional preprocessor passes a forwarded __VA_ARGS__ on to the next macro as a single
+//              argument, commas and all. Wrapping the call in PREPROCESSOR_EXPAND rescans it once the arguments are
+//              substituted, which splits them again.
+#define PREPROCESSOR_EXPAND(x) x
+
+// NOTE(soimn): The message is an optional format string literal followed by its arguments. Prefixing it with 
+//              an empty literal turns a missing message into an empty format string. The message and its arguments
+//              arrive as one __VA_ARGS__, so the Print is expanded with PREPROCESSOR_EXPAND, or the arguments would
+//              end up in the format string.
 #ifndef DISABLE_ASSERT
-#define Assert(condition, ...) ((condition) ? 1 : AssertionFailed(__FILE__, __FUNCTION__, __LINE__, #condition, ##__VA_ARGS__), 0)
+#define Assert(condition, ...) ((condition) ? 1 : (BeginAssertionFailure(__FILE__, __FUNCTION__, __LINE__, #condition), PREPROCESSOR_EXPAND(Print(ErrorStream, "" __VA_ARGS__)), AssertionFailed(), 0))
 #else
 #define Assert(condition, ...) (condition)
 #endif
@@ -90,5 +118,11 @@ Report(Enum8(REPORT_SEVERITY) severity, const char* message, ...);
 inline void
 Flush(struct String_Stream* stream);
 
+inline void*
+OpenOutputFile(const char* path);
+
+inline void
+CloseOutputFile(void* handle);
+
 global struct String_Stream* PrintStream;
 global struct String_Stream* ErrorStream;
\ No newline at end of file
@@ -0,0 +1,375 @@
+#pragma once
+
+#include "common.h"
+#include "error_handling.h"
+#include "memory.h"
+#include "string.h"
+#include "hash_map.h"
+#include "atomics.h"
+
+// NOTE(soimn): Deferred diagnostics. Reporting a diagnostic only records its severity, location, message ID and
+//              raw arguments, and nothing is formatted until the diagnostics are emitted. Emission sorts the
+//              recorded diagnostics by location, drops duplicates and cascaded errors, and caps the number of
+//              diagnostics shown per file.
+//
+//              String arguments are stored by reference, so the memory they point to has to outlive the next
+//              call to EmitDiagnostics. Source text and string literals both do.
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): A source location is packed into a single U64 as file:line:column, which makes source order the
+//              same as integer order. Lines and columns past the width of their field are clamped.
+typedef U64 Source_Location;
+
+#define SOURCE_LOCATION_FILE_BITS   16
+#define SOURCE_LOCATION_LINE_BITS   28
+#define SOURCE_LOCATION_COLUMN_BITS 20
+
+inline Source_Location
+SourceLocation(File_ID file, U32 line, U32 column)
+{
+    U64 max_line   = (1ULL << SOURCE_LOCATION_LINE_BITS) - 1;
+    U64 max_column = (1ULL << SOURCE_LOCATION_COLUMN_BITS) - 1;
+    
+    Assert(file < (1ULL << SOURCE_LOCATION_FILE_BITS));
+    
+    return ((U64)file << (SOURCE_LOCATION_LINE_BITS + SOURCE_LOCATION_COLUMN_BITS) |
+            MIN((U64)line, max_line) << SOURCE_LOCATION_COLUMN_BITS                 |
+            MIN((U64)column, max_column));
+}
+
+inline File_ID
+LocationFile(Source_Location location)
+{
+    return (File_ID)(location >> (SOURCE_LOCATION_LINE_BITS + SOURCE_LOCATION_COLUMN_BITS));
+}
+
+inline U32
+LocationLine(Source_Location location)
+{
+    return (U32)(location >> SOURCE_LOCATION_COLUMN_BITS) & ((1U << SOURCE_LOCATION_LINE_BITS) - 1);
+}
+
+inline U32
+LocationColumn(Source_Location location)
+{
+    return (U32)location & ((1U << SOURCE_LOCATION_COLUMN_BITS) - 1);
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): Every diagnostic the compiler can report. The format strings use the Print specifiers, and are
+//              parsed at compile time into DiagnosticLayouts.
+#define DIAGNOSTIC_MESSAGE_LIST                                                                                   \
+DIAGNOSTIC_MESSAGE(UnterminatedString,        "Reached end of stream before closing '\"'")                       \
+DIAGNOSTIC_MESSAGE(EmptyCharacter,            "Empty character constant")                                         \
+DIAGNOSTIC_MESSAGE(UnterminatedCharacter,     "Missing terminating ' character")                                  \
+DIAGNOSTIC_MESSAGE(IntegerTooLarge,           "Integer literal is too large to be represented in any integer type") \
+DIAGNOSTIC_MESSAGE(InvalidDigit,              "Invalid digit '%u' in %s constant")                                \
+DIAGNOSTIC_MESSAGE(MissingExponentDigits,     "Floating point number ended in exponent with no digits")           \
+DIAGNOSTIC_MESSAGE(FloatMagnitudeTooLarge,    "Magnitude of floating-point constant too large")                   \
+DIAGNOSTIC_MESSAGE(FloatTooLargeForF32,       "Floating point literal too large to be represented by type 'float'") \
+DIAGNOSTIC_MESSAGE(IncompleteElipsis,         "Expected '...', found '..'")                                       \
+DIAGNOSTIC_MESSAGE(ExpectedToken,             "Expected %s, found %s")                                            \
+DIAGNOSTIC_MESSAGE(ExpectedDeclaration,       "Expected a declaration, found %s")                                 \
+DIAGNOSTIC_MESSAGE(ExpectedTypeName,          "Expected a type name, found %s")                                   \
+DIAGNOSTIC_MESSAGE(UnexpectedTokenAfterKeyword, "Expected a name or '{' after the %s keyword, found %s")          \
+DIAGNOSTIC_MESSAGE(ExpectedExpression,        "Expected an expression, found %s")                                 \
+DIAGNOSTIC_MESSAGE(NestedFunction,            "Functions can only be declared at the top level")                  \
+DIAGNOSTIC_MESSAGE(CannotReadFile,            "Could not read the file")                                          \
+DIAGNOSTIC_MESSAGE(TooManyErrors,             "Too many errors, skipping the rest of this run of declarations")   \
+DIAGNOSTIC_MESSAGE(CyclicDependency,          "'%S' depends on itself")                                           \
+DIAGNOSTIC_MESSAGE(CyclicDependencyThrough,   "'%S' depends on itself through '%S'")                              \
+DIAGNOSTIC_MESSAGE(UndeclaredName,            "'%S' is not declared")                                             \
+
+enum DIAGNOSTIC_MESSAGE
+{
+#define DIAGNOSTIC_MESSAGE(name, format) Diagnostic_##name,
+    DIAGNOSTIC_MESSAGE_LIST
+#undef DIAGNOSTIC_MESSAGE
+    
+    DIAGNOSTIC_MESSAGE_COUNT
+};
+
+global const char* DiagnosticFormats[DIAGNOSTIC_MESSAGE_COUNT] = {
+#define DIAGNOSTIC_MESSAGE(name, format) format,
+    DIAGNOSTIC_MESSAGE_LIST
+#undef DIAGNOSTIC_MESSAGE
+};
+
+global constexpr Format_Layout DiagnosticLayouts[DIAGNOSTIC_MESSAGE_COUNT] = {
+#define DIAGNOSTIC_MESSAGE(name, format) ParseFormat(format, sizeof(format) - 1),
+    DIAGNOSTIC_MESSAGE_LIST
+#undef DIAGNOSTIC_MESSAGE
+};
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+#define DIAGNOSTIC_MAX_ARGUMENTS 3
+#define DIAGNOSTICS_BLOCK_SIZE 256
+#define DIAGNOSTICS_DEFAULT_MAX_PER_FILE 64
+
+// NOTE(soimn): 64 bytes, so recording a diagnostic touches a single cache line
+struct Diagnostic
+{
+    Source_Location location;
+    Enum16(DIAGNOSTIC_MESSAGE) message;
+    Enum8(REPORT_SEVERITY) severity;
+    Format_Argument arguments[DIAGNOSTIC_MAX_ARGUMENTS];
+};
+
+struct Diagnostics_Engine
+{
+    Memory_Arena arena;
+    Spin_Lock lock;
+    
+    Bucket_Array<Diagnostic, DIAGNOSTICS_BLOCK_SIZE> diagnostics;
+    Hash_Map<File_ID, String> file_names;
+    
+    U32 max_per_file;
+    
+    volatile U32 error_count;
+    volatile U32 warning_count;
+};
+
+inline Diagnostics_Engine
+DiagnosticsEngine(U32 max_per_file = DIAGNOSTICS_DEFAULT_MAX_PER_FILE)
+{
+    Diagnostics_Engine result = {};
+    result.max_per_file = max_per_file;
+    
+    return result;
+}
+
+// NOTE(soimn): The engine is initialized on first use instead of in DiagnosticsEngine, since the bucket array
+//              and hash map keep a pointer to the arena, which would dangle when the engine is returned by value
+inline void
+InitDiagnosticsStorage(Diagnostics_Engine* engine)
+{
+    if (!engine->diagnostics.arena)
+    {
+        engine->diagnostics = BucketArray<Diagnostic, DIAGNOSTICS_BLOCK_SIZE>(&engine->arena);
+        engine->file_names  = HashMap<File_ID, String>(&engine->arena);
+    }
+}
+
+inline void
+SetDiagnosticsFileName(Diagnostics_Engine* engine, File_ID file, String name)
+{
+    LockSpinLock(&engine->lock);
+    
+    InitDiagnosticsStorage(engine);
+    Insert(&engine->file_names, file, name);
+    
+    UnlockSpinLock(&engine->lock);
+}
+
+inline void
+PushDiagnostic(Diagnostics_Engine* engine, const Diagnostic* diagnostic)
+{
+    if      (diagnostic->severity == Warning) AtomicAdd(&engine->warning_count, 1);
+    else                                      AtomicAdd(&engine->error_count, 1);
+    
+    LockSpinLock(&engine->lock);
+    
+    InitDiagnosticsStorage(engine);
+    *PushElement(&engine->diagnostics) = *diagnostic;
+    
+    UnlockSpinLock(&engine->lock);
+}
+
+template<Enum16(DIAGNOSTIC_MESSAGE) message, typename... Args>
+inline void
+RecordDiagnostic(Diagnostics_Engine* engine, Enum8(REPORT_SEVERITY) severity, Source_Location location, const Args&... args)
+{
+    static_assert(DiagnosticLayouts[message].error == FormatError_None, "Invalid diagnostic format string");
+    static_assert(DiagnosticLayouts[message].argument_count <= DIAGNOSTIC_MAX_ARGUMENTS, "Diagnostic has too many arguments, increase DIAGNOSTIC_MAX_ARGUMENTS");
+    static_assert(DiagnosticLayouts[message].argument_count == sizeof...(Args), "Number of arguments does not match the diagnostic message");
+    static_assert(FormatArgumentsMatch<Args...>(DiagnosticLayouts[message]), "Argument type does not match its format specifier");
+    
+    Diagnostic diagnostic = {};
+    diagnostic.location   = location;
+    diagnostic.message    = message;
+    diagnostic.severity   = severity;
+    
+    Format_Argument arguments[sizeof...(Args) + 1] = {FormatArgument(args)...};
+    
+    for (U32 i = 0; i < sizeof...(Args); ++i)
+    {
+        diagnostic.arguments[i] = arguments[i];
+    }
+    
+    PushDiagnostic(engine, &diagnostic);
+}
+
+#define Diagnose(engine, severity, location, message, ...) RecordDiagnostic<Diagnostic_##message>(engine, severity, location, ##__VA_ARGS__)
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+inline bool
+DiagnosticPrecedes(const Diagnostic* a, const Diagnostic* b)
+{
+    return (a->location < b->location || (a->location == b->location && a->message < b->message));
+}
+
+// NOTE(soimn): Bottom up merge sort. It is stable, which keeps diagnostics that compare equal in the order they
+//              were reported. Returns whichever of the two buffers holds the sorted result.
+inline Diagnostic*
+SortDiagnostics(Diagnostic* diagnostics, Diagnostic* scratch, UMM count)
+{
+    Diagnostic* source = diagnostics;
+    Diagnostic* dest   = scratch;
+    
+    for (UMM width = 1; width < count; width *= 2)
+    {
+        for (UMM start = 0; start < count; start += 2 * width)
+        {
+            UMM middle = MIN(start + width, count);
+            UMM end    = MIN(start + 2 * width, count);
+            
+            UMM left  = start;
+            UMM right = middle;
+            
+            for (UMM i = start; i < end; ++i)
+            {
+                if (left < middle && (right == end || !DiagnosticPrecedes(&source[right], &source[left])))
+                {
+                    dest[i] = source[left++];
+                }
+                
+                else
+                {
+                    dest[i] = source[right++];
+                }
+            }
+        }
+        
+        Diagnostic* temp = source;
+        source = dest;
+        dest   = temp;
+    }
+    
+    return source;
+}
+
+inline void
+PrintDiagnosticsFileName(Diagnostics_Engine* engine, String_Stream* stream, File_ID file)
+{
+    String* name = Lookup(&engine->file_names, file);
+    
+    if (name) Print(stream, "%S", *name);
+    else      Print(stream, "file %u", file);
+}
+
+inline void
+PrintDiagnostic(Diagnostics_Engine* engine, String_Stream* stream, const Diagnostic* diagnostic)
+{
+    Print(stream, "[%S] ", ReportSeverityName(diagnostic->severity));
+    
+    PrintDiagnosticsFileName(engine, stream, LocationFile(diagnostic->location));
+    
+    // NOTE(soimn): Line 0 marks a diagnostic about the file as a whole
+    if (LocationLine(diagnostic->location) != 0)
+    {
+        Print(stream, ":%u:%u", LocationLine(diagnostic->location), LocationColumn(diagnostic->location));
+    }
+    
+    Print(stream, ": ");
+    
+    const Format_Layout* layout = &DiagnosticLayouts[diagnostic->message];
+    PrintSegments(stream, DiagnosticFormats[diagnostic->message], layout->segments, layout->segment_count, diagnostic->arguments);
+    
+    Append(stream, '\n');
+}
+
+// NOTE(soimn): Formats and emits every diagnostic recorded since the last call, and releases their storage.
+//              Duplicates, and errors at the same location as an earlier error, are treated as cascades and
+//              dropped. The cascade and per file limits apply within a batch.
+//              This must not be called while other threads are still reporting.
+inline void
+EmitDiagnostics(Diagnostics_Engine* engine, String_Stream* stream)
+{
+    InitDiagnosticsStorage(engine);
+    
+    UMM count = engine->diagnostics.num_elements;
+    
+    if (count)
+    {
+        Memory_Arena scratch_arena = {};
+        
+        Diagnostic* diagnostics = (Diagnostic*)PushSize(&scratch_arena, 2 * count * sizeof(Diagnostic), alignof(Diagnostic));
+        
+        UMM index = 0;
+        for (Diagnostic& diagnostic : engine->diagnostics)
+        {
+            diagnostics[index++] = diagnostic;
+        }
+        
+        Diagnostic* sorted = SortDiagnostics(diagnostics, diagnostics + count, count);
+        
+        const Diagnostic* previous   = 0;
+        const Diagnostic* last_error = 0;
+        U32 shown_in_file      = 0;
+        U32 suppressed_in_file = 0;
+        
+        for (UMM i = 0; i <= count; ++i)
+        {
+            const Diagnostic* diagnostic = (i < count ? &sorted[i] : 0);
+            
+            if (previous && (!diagnostic || LocationFile(previous->location) != LocationFile(diagnostic->location)))
+            {
+                if (suppressed_in_file)
+                {
+                    PrintDiagnosticsFileName(engine, stream, LocationFile(previous->location));
+                    Print(stream, ": %u more diagnostics not shown\n", suppressed_in_file);
+                }
+                
+                last_error         = 0;
+                shown_in_file      = 0;
+                suppressed_in_file = 0;
+            }
+            
+            if (diagnostic)
+            {
+                bool is_duplicate = (previous && previous->location == diagnostic->location &&
+                                     previous->message == diagnostic->message);
+                
+                bool is_cascade = (diagnostic->severity != Warning && last_error &&
+                                   last_error->location == diagnostic->location);
+                
+                if (is_duplicate || is_cascade)
+                {
+                    // NOTE(soimn): Cascades are dropped without counting towards the suppressed diagnostics
+                }
+                
+                else if (shown_in_file >= engine->max_per_file)
+                {
+                    ++suppressed_in_file;
+                }
+                
+                else
+                {
+                    PrintDiagnostic(engine, stream, diagnostic);
+                    
+                    ++shown_in_file;
+                    
+                    if (diagnostic->severity != Warning) last_error = diagnostic;
+                }
+                
+                previous = diagnostic;
+            }
+        }
+        
+        ClearArena(&scratch_arena);
+        
+        ResetArray(&engine->diagnostics);
+    }
+}
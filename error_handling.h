@@ -11,45 +11,18 @@ Abort()
     *(volatile int*)0 = 0;
 }
 
-[[noreturn]]
-inline void
-AssertionFailed(const char* file, const char* function, U32 line, const char* condition_string, String message, ...)
-{
-    va_list arg_list;
-    va_start(arg_list, message);
-    Print(ErrorStream, "*********** [ASSERTION FAILED] ***********\n");
-    Print(ErrorStream, "The assertion '%s' failed.\n", condition_string);
-    Print(ErrorStream, "File: %s,\nLine: %u,Function: %s\n\n", file, line, function);
-    Print(ErrorStream, message, arg_list);
-    Flush(ErrorStream);
-    va_end(arg_list);
-    
-    Abort();
-}
-
-[[noreturn]]
 inline void
-AssertionFailed(const char* file, const char* function, U32 line, const char* condition_string, const char* message, ...)
+BeginAssertionFailure(const char* file, const char* function, U32 line, const char* condition_string)
 {
-    va_list arg_list;
-    va_start(arg_list, message);
     Print(ErrorStream, "*********** [ASSERTION FAILED] ***********\n");
     Print(ErrorStream, "The assertion '%s' failed.\n", condition_string);
     Print(ErrorStream, "File: %s,\nLine: %u,\nFunction: %s\n\n", file, line, function);
-    Print(ErrorStream, {(U8*)message, StringLength(message)}, arg_list);
-    Flush(ErrorStream);
-    va_end(arg_list);
-    
-    Abort();
 }
 
 [[noreturn]]
 inline void
-AssertionFailed(const char* file, const char* function, U32 line, const char* condition_string)
+AssertionFailed()
 {
-    Print(ErrorStream, "*********** [ASSERTION FAILED] ***********\n");
-    Print(ErrorStream, "The assertion '%s' failed.\n", condition_string);
-    Print(ErrorStream, "File: %s,\nLine: %u,Function: %s\n", file, line, function);
     Flush(ErrorStream);
     
     Abort();
@@ -62,76 +35,46 @@ enum REPORT_SEVERITY
     Fatal,
 };
 
-inline void
-Report(Enum8(REPORT_SEVERITY) severity, String message, ...)
+inline String
+ReportSeverityName(Enum8(REPORT_SEVERITY) severity)
 {
-    va_list arg_list;
-    va_start(arg_list, message);
-    
-    String severity_string = CONST_STRING("");
+    String result = CONST_STRING("");
     
     switch (severity)
     {
         case Warning:
-        severity_string = CONST_STRING("WARNING");
+        result = CONST_STRING("WARNING");
         break;
         
         case Error:
-        severity_string = CONST_STRING("ERROR");
+        result = CONST_STRING("ERROR");
         break;
         
         case Fatal:
-        severity_string = CONST_STRING("FATAL");
+        result = CONST_STRING("FATAL");
         break;
         
         INVALID_DEFAULT_CASE;
     }
     
-    Print(ErrorStream, "[%S] ", severity_string);
-    Print(ErrorStream, message, arg_list);
-    Append(ErrorStream, '\n');
-    
-    if (severity != Warning)
-    {
-        Flush(ErrorStream);
-    }
-    
-    va_end(arg_list);
+    return result;
 }
 
 inline void
-Report(Enum8(REPORT_SEVERITY) severity, const char* message, ...)
+BeginReport(Enum8(REPORT_SEVERITY) severity)
+{
+    Print(ErrorStream, "[%S] ", ReportSeverityName(severity));
+}
+
+inline void
+EndReport(Enum8(REPORT_SEVERITY) severity)
 {
-    va_list arg_list;
-    va_start(arg_list, message);
-    
-    String severity_string = CONST_STRING("");
-    
-    switch (severity)
-    {
-        case Warning:
-        severity_string = CONST_STRING("WARNING");
-        break;
-        
-        case Error:
-        severity_string = CONST_STRING("ERROR");
-        break;
-        
-        case Fatal:
-        severity_string = CONST_STRING("FATAL");
-        break;
-        
-        INVALID_DEFAULT_CASE;
-    }
-    
-    Print(ErrorStream, "[%S] ", severity_string);
-    Print(ErrorStream, {(U8*)message, StringLength(message)}, arg_list);
     Append(ErrorStream, '\n');
     
-    if (severity != Warning)
+    // NOTE(soimn): Buffered error streams are left to flush on their threshold, except for fatal errors, 
+    //              which may be the last thing reported before the process goes down
+    if (severity == Fatal || (severity == Error && !ErrorStream->flush_threshold))
     {
         Flush(ErrorStream);
     }
-    
-    va_end(arg_list);
 }
\ No newline at end of file
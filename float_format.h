@@ -0,0 +1,763 @@
+#pragma once
+
+#include "common.h"
+#include "memory.h"
+
+// NOTE(soimn): Shortest round trip formatting of F32 and F64. The digits are generated with Grisu3, which 
+//              produces the shortest digit string for the vast majority of values and detects when it cannot 
+//              guarantee that it did. Those values fall back to an exact big integer digit generator in the 
+//              style of Burger and Dybvig, which is slow but always correct.
+//
+//              Both generators produce the digits as an integer and a decimal exponent, such that the value 
+//              is digits * 10^exponent.
+
+// NOTE(soimn): Shortest digit strings are at most 17 digits, Grisu may generate a few more before it bails
+#define FLOAT_FORMAT_DIGIT_BUFFER_SIZE 32
+#define FLOAT_FORMAT_MAX_LENGTH 352
+
+struct Diy_Fp
+{
+    U64 f;
+    I32 e;
+};
+
+inline Diy_Fp
+NormalizeDiyFp(Diy_Fp x)
+{
+    while (!(x.f & 0xFFC0000000000000ULL))
+    {
+        x.f <<= 10;
+        x.e  -= 10;
+    }
+    
+    while (!(x.f & 0x8000000000000000ULL))
+    {
+        x.f <<= 1;
+        x.e  -= 1;
+    }
+    
+    return x;
+}
+
+// NOTE(soimn): Returns the upper 64 bits of the 128 bit product, rounded
+inline Diy_Fp
+MultiplyDiyFp(Diy_Fp x, Diy_Fp y)
+{
+    U64 a = x.f >> 32;
+    U64 b = x.f & 0xFFFFFFFF;
+    U64 c = y.f >> 32;
+    U64 d = y.f & 0xFFFFFFFF;
+    
+    U64 ac = a * c;
+    U64 bc = b * c;
+    U64 ad = a * d;
+    U64 bd = b * d;
+    
+    U64 middle = (bd >> 32) + (ad & 0xFFFFFFFF) + (bc & 0xFFFFFFFF) + (1ULL << 31);
+    
+    Diy_Fp result = {};
+    result.f = ac + (ad >> 32) + (bc >> 32) + (middle >> 32);
+    result.e = x.e + y.e + 64;
+    
+    return result;
+}
+
+inline I32
+CeilF64(F64 value)
+{
+    I32 truncated = (I32)value;
+    
+    return truncated + (value > (F64)truncated);
+}
+
+struct Cached_Power
+{
+    U64 significand;
+    I16 binary_exponent;
+    I16 decimal_exponent;
+};
+
+// NOTE(soimn): Normalized and rounded 64 bit approximations of 10^k, for k = -348, -340, ..., 340
+global const Cached_Power CachedPowers[] = {
+    {0xFA8FD5A0081C0288ULL, -1220, -348},
+    {0xBAAEE17FA23EBF76ULL, -1193, -340},
+    {0x8B16FB203055AC76ULL, -1166, -332},
+    {0xCF42894A5DCE35EAULL, -1140, -324},
+    {0x9A6BB0AA55653B2DULL, -1113, -316},
+    {0xE61ACF033D1A45DFULL, -1087, -308},
+    {0xAB70FE17C79AC6CAULL, -1060, -300},
+    {0xFF77B1FCBEBCDC4FULL, -1034, -292},
+    {0xBE5691EF416BD60CULL, -1007, -284},
+    {0x8DD01FAD907FFC3CULL,  -980, -276},
+    {0xD3515C2831559A83ULL,  -954, -268},
+    {0x9D71AC8FADA6C9B5ULL,  -927, -260},
+    {0xEA9C227723EE8BCBULL,  -901, -252},
+    {0xAECC49914078536DULL,  -874, -244},
+    {0x823C12795DB6CE57ULL,  -847, -236},
+    {0xC21094364DFB5637ULL,  -821, -228},
+    {0x9096EA6F3848984FULL,  -794, -220},
+    {0xD77485CB25823AC7ULL,  -768, -212},
+    {0xA086CFCD97BF97F4ULL,  -741, -204},
+    {0xEF340A98172AACE5ULL,  -715, -196},
+    {0xB23867FB2A35B28EULL,  -688, -188},
+    {0x84C8D4DFD2C63F3BULL,  -661, -180},
+    {0xC5DD44271AD3CDBAULL,  -635, -172},
+    {0x936B9FCEBB25C996ULL,  -608, -164},
+    {0xDBAC6C247D62A584ULL,  -582, -156},
+    {0xA3AB66580D5FDAF6ULL,  -555, -148},
+    {0xF3E2F893DEC3F126ULL,  -529, -140},
+    {0xB5B5ADA8AAFF80B8ULL,  -502, -132},
+    {0x87625F056C7C4A8BULL,  -475, -124},
+    {0xC9BCFF6034C13053ULL,  -449, -116},
+    {0x964E858C91BA2655ULL,  -422, -108},
+    {0xDFF9772470297EBDULL,  -396, -100},
+    {0xA6DFBD9FB8E5B88FULL,  -369,  -92},
+    {0xF8A95FCF88747D94ULL,  -343,  -84},
+    {0xB94470938FA89BCFULL,  -316,  -76},
+    {0x8A08F0F8BF0F156BULL,  -289,  -68},
+    {0xCDB02555653131B6ULL,  -263,  -60},
+    {0x993FE2C6D07B7FACULL,  -236,  -52},
+    {0xE45C10C42A2B3B06ULL,  -210,  -44},
+    {0xAA242499697392D3ULL,  -183,  -36},
+    {0xFD87B5F28300CA0EULL,  -157,  -28},
+    {0xBCE5086492111AEBULL,  -130,  -20},
+    {0x8CBCCC096F5088CCULL,  -103,  -12},
+    {0xD1B71758E219652CULL,   -77,   -4},
+    {0x9C40000000000000ULL,   -50,    4},
+    {0xE8D4A51000000000ULL,   -24,   12},
+    {0xAD78EBC5AC620000ULL,     3,   20},
+    {0x813F3978F8940984ULL,    30,   28},
+    {0xC097CE7BC90715B3ULL,    56,   36},
+    {0x8F7E32CE7BEA5C70ULL,    83,   44},
+    {0xD5D238A4ABE98068ULL,   109,   52},
+    {0x9F4F2726179A2245ULL,   136,   60},
+    {0xED63A231D4C4FB27ULL,   162,   68},
+    {0xB0DE65388CC8ADA8ULL,   189,   76},
+    {0x83C7088E1AAB65DBULL,   216,   84},
+    {0xC45D1DF942711D9AULL,   242,   92},
+    {0x924D692CA61BE758ULL,   269,  100},
+    {0xDA01EE641A708DEAULL,   295,  108},
+    {0xA26DA3999AEF774AULL,   322,  116},
+    {0xF209787BB47D6B85ULL,   348,  124},
+    {0xB454E4A179DD1877ULL,   375,  132},
+    {0x865B86925B9BC5C2ULL,   402,  140},
+    {0xC83553C5C8965D3DULL,   428,  148},
+    {0x952AB45CFA97A0B3ULL,   455,  156},
+    {0xDE469FBD99A05FE3ULL,   481,  164},
+    {0xA59BC234DB398C25ULL,   508,  172},
+    {0xF6C69A72A3989F5CULL,   534,  180},
+    {0xB7DCBF5354E9BECEULL,   561,  188},
+    {0x88FCF317F22241E2ULL,   588,  196},
+    {0xCC20CE9BD35C78A5ULL,   614,  204},
+    {0x98165AF37B2153DFULL,   641,  212},
+    {0xE2A0B5DC971F303AULL,   667,  220},
+    {0xA8D9D1535CE3B396ULL,   694,  228},
+    {0xFB9B7CD9A4A7443CULL,   720,  236},
+    {0xBB764C4CA7A44410ULL,   747,  244},
+    {0x8BAB8EEFB6409C1AULL,   774,  252},
+    {0xD01FEF10A657842CULL,   800,  260},
+    {0x9B10A4E5E9913129ULL,   827,  268},
+    {0xE7109BFBA19C0C9DULL,   853,  276},
+    {0xAC2820D9623BF429ULL,   880,  284},
+    {0x80444B5E7AA7CF85ULL,   907,  292},
+    {0xBF21E44003ACDD2DULL,   933,  300},
+    {0x8E679C2F5E44FF8FULL,   960,  308},
+    {0xD433179D9C8CB841ULL,   986,  316},
+    {0x9E19DB92B4E31BA9ULL,  1013,  324},
+    {0xEB96BF6EBADF77D9ULL,  1039,  332},
+    {0xAF87023B9BF0EE6BULL,  1066,  340}
+};
+
+#define CACHED_POWERS_OFFSET 348
+#define CACHED_POWERS_DECIMAL_DISTANCE 8
+#define GRISU_MIN_TARGET_EXPONENT -60
+#define GRISU_MAX_TARGET_EXPONENT -32
+
+global const U32 SmallPowersOfTen[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+
+// NOTE(soimn): Moves the last digit towards w as long as that stays inside the safe interval, and reports 
+//              whether the result is guaranteed to be the closest shortest representation
+inline bool
+GrisuRoundWeed(char* digits, U32 length, U64 distance_too_high_w, U64 unsafe_interval, U64 rest, U64 ten_kappa, U64 unit)
+{
+    U64 small_distance = distance_too_high_w - unit;
+    U64 big_distance   = distance_too_high_w + unit;
+    
+    while (rest < small_distance && unsafe_interval - rest >= ten_kappa && 
+           (rest + ten_kappa < small_distance || small_distance - rest >= rest + ten_kappa - small_distance))
+    {
+        --digits[length - 1];
+        rest += ten_kappa;
+    }
+    
+    bool result = false;
+    
+    if (!(rest < big_distance && unsafe_interval - rest >= ten_kappa && 
+          (rest + ten_kappa < big_distance || big_distance - rest > rest + ten_kappa - big_distance)))
+    {
+        result = (2 * unit <= rest && rest <= unsafe_interval - 4 * unit);
+    }
+    
+    return result;
+}
+
+inline bool
+GrisuDigitGen(Diy_Fp low, Diy_Fp w, Diy_Fp high, char* digits, U32* length, I32* kappa)
+{
+    Assert(low.e == w.e && w.e == high.e);
+    
+    U64 unit = 1;
+    
+    Diy_Fp too_low  = {low.f - unit, low.e};
+    Diy_Fp too_high = {high.f + unit, high.e};
+    
+    U64 unsafe_interval = too_high.f - too_low.f;
+    
+    U32 one_shift = (U32)-w.e;
+    U64 one       = 1ULL << one_shift;
+    
+    U32 integrals   = (U32)(too_high.f >> one_shift);
+    U64 fractionals = too_high.f & (one - 1);
+    
+    U32 divisor   = 0;
+    I32 exponent  = 0;
+    for (; exponent < (I32)ARRAY_COUNT(SmallPowersOfTen) && SmallPowersOfTen[exponent] <= integrals; ++exponent)
+    {
+        divisor = SmallPowersOfTen[exponent];
+    }
+    
+    *kappa  = exponent;
+    *length = 0;
+    
+    while (*kappa > 0)
+    {
+        digits[(*length)++] = (char)('0' + integrals / divisor);
+        integrals %= divisor;
+        --*kappa;
+        
+        U64 rest = ((U64)integrals << one_shift) + fractionals;
+        
+        if (rest < unsafe_interval)
+        {
+            return GrisuRoundWeed(digits, *length, too_high.f - w.f, unsafe_interval, rest, (U64)divisor << one_shift, unit);
+        }
+        
+        divisor /= 10;
+    }
+    
+    for (;;)
+    {
+        fractionals     *= 10;
+        unit            *= 10;
+        unsafe_interval *= 10;
+        
+        digits[(*length)++] = (char)('0' + (fractionals >> one_shift));
+        fractionals &= one - 1;
+        --*kappa;
+        
+        if (fractionals < unsafe_interval)
+        {
+            return GrisuRoundWeed(digits, *length, (too_high.f - w.f) * unit, unsafe_interval, fractionals, one, unit);
+        }
+    }
+}
+
+// NOTE(soimn): The value is f * 2^e. lower_closer is set when f is an exact power of two above the smallest 
+//              normal exponent, in which case the gap to the next smaller value is half the gap to the next 
+//              larger one.
+inline bool
+FormatShortestGrisu(U64 f, I32 e, bool lower_closer, char* digits, U32* length, I32* exponent)
+{
+    Diy_Fp w       = NormalizeDiyFp({f, e});
+    Diy_Fp m_plus  = NormalizeDiyFp({(f << 1) + 1, e - 1});
+    Diy_Fp m_minus = (lower_closer ? Diy_Fp{(f << 2) - 1, e - 2} : Diy_Fp{(f << 1) - 1, e - 1});
+    
+    m_minus.f <<= m_minus.e - m_plus.e;
+    m_minus.e   = m_plus.e;
+    
+    I32 min_exponent = GRISU_MIN_TARGET_EXPONENT - (w.e + 64);
+    
+    I32 k     = CeilF64((min_exponent + 63) * 0.30102999566398114);
+    U32 index = (U32)((CACHED_POWERS_OFFSET + k - 1) / CACHED_POWERS_DECIMAL_DISTANCE + 1);
+    
+    Cached_Power cached_power = CachedPowers[index];
+    Diy_Fp ten_mk = {cached_power.significand, cached_power.binary_exponent};
+    
+    Assert(min_exponent <= ten_mk.e && ten_mk.e <= GRISU_MAX_TARGET_EXPONENT - (w.e + 64));
+    
+    Diy_Fp scaled_w       = MultiplyDiyFp(w, ten_mk);
+    Diy_Fp scaled_m_minus = MultiplyDiyFp(m_minus, ten_mk);
+    Diy_Fp scaled_m_plus  = MultiplyDiyFp(m_plus, ten_mk);
+    
+    I32 kappa   = 0;
+    bool result = GrisuDigitGen(scaled_m_minus, scaled_w, scaled_m_plus, digits, length, &kappa);
+    
+    *exponent = kappa - cached_power.decimal_exponent;
+    
+    return result;
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): Enough for the scaled remainders of the smallest F64 denormal, which need a bit over 1100 bits
+#define BIG_INT_MAX_LIMBS 40
+
+struct Big_Int
+{
+    U32 limbs[BIG_INT_MAX_LIMBS];
+    U32 count;
+};
+
+inline Big_Int
+BigInt(U64 value)
+{
+    Big_Int result = {};
+    
+    while (value)
+    {
+        result.limbs[result.count++] = (U32)value;
+        value >>= 32;
+    }
+    
+    return result;
+}
+
+inline void
+ShiftLeft(Big_Int* big_int, U32 shift)
+{
+    if (big_int->count)
+    {
+        U32 limb_shift = shift / 32;
+        U32 bit_shift  = shift % 32;
+        
+        Assert(big_int->count + limb_shift + 1 <= BIG_INT_MAX_LIMBS);
+        
+        big_int->limbs[big_int->count + limb_shift] = 0;
+        
+        for (U32 i = big_int->count; i-- > 0; )
+        {
+            U64 shifted = (U64)big_int->limbs[i] << bit_shift;
+            
+            big_int->limbs[i + limb_shift + 1] |= (U32)(shifted >> 32);
+            big_int->limbs[i + limb_shift]      = (U32)shifted;
+        }
+        
+        for (U32 i = 0; i < limb_shift; ++i)
+        {
+            big_int->limbs[i] = 0;
+        }
+        
+        big_int->count += limb_shift + 1;
+        
+        while (big_int->count && !big_int->limbs[big_int->count - 1])
+        {
+            --big_int->count;
+        }
+    }
+}
+
+inline void
+MultiplySmall(Big_Int* big_int, U32 factor)
+{
+    U64 carry = 0;
+    
+    for (U32 i = 0; i < big_int->count; ++i)
+    {
+        U64 product = (U64)big_int->limbs[i] * factor + carry;
+        
+        big_int->limbs[i] = (U32)product;
+        carry             = product >> 32;
+    }
+    
+    if (carry)
+    {
+        Assert(big_int->count < BIG_INT_MAX_LIMBS);
+        big_int->limbs[big_int->count++] = (U32)carry;
+    }
+}
+
+inline void
+MultiplyPowerOfTen(Big_Int* big_int, U32 exponent)
+{
+    for (; exponent >= 9; exponent -= 9)
+    {
+        MultiplySmall(big_int, SmallPowersOfTen[9]);
+    }
+    
+    if (exponent)
+    {
+        MultiplySmall(big_int, SmallPowersOfTen[exponent]);
+    }
+}
+
+inline I32
+Compare(Big_Int* a, Big_Int* b)
+{
+    I32 result = 0;
+    
+    if (a->count != b->count)
+    {
+        result = (a->count < b->count ? -1 : 1);
+    }
+    
+    else
+    {
+        for (U32 i = a->count; i-- > 0; )
+        {
+            if (a->limbs[i] != b->limbs[i])
+            {
+                result = (a->limbs[i] < b->limbs[i] ? -1 : 1);
+                break;
+            }
+        }
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Compares a + b to c
+inline I32
+CompareSum(Big_Int* a, Big_Int* b, Big_Int* c)
+{
+    Big_Int sum = {};
+    
+    U64 carry = 0;
+    for (U32 i = 0; i < MAX(a->count, b->count); ++i)
+    {
+        U64 limb_sum = carry;
+        limb_sum += (i < a->count ? a->limbs[i] : 0);
+        limb_sum += (i < b->count ? b->limbs[i] : 0);
+        
+        sum.limbs[sum.count++] = (U32)limb_sum;
+        carry = limb_sum >> 32;
+    }
+    
+    if (carry)
+    {
+        Assert(sum.count < BIG_INT_MAX_LIMBS);
+        sum.limbs[sum.count++] = (U32)carry;
+    }
+    
+    return Compare(&sum, c);
+}
+
+// NOTE(soimn): a -= b, where a >= b
+inline void
+Subtract(Big_Int* a, Big_Int* b)
+{
+    I64 borrow = 0;
+    
+    for (U32 i = 0; i < a->count; ++i)
+    {
+        I64 difference = (I64)a->limbs[i] - (i < b->count ? b->limbs[i] : 0) - borrow;
+        
+        borrow      = (difference < 0);
+        a->limbs[i] = (U32)(difference + (borrow << 32));
+    }
+    
+    while (a->count && !a->limbs[a->count - 1])
+    {
+        --a->count;
+    }
+}
+
+inline U32
+FormatShortestBigInt(U64 f, I32 e, bool lower_closer, char* digits, I32* exponent)
+{
+    // NOTE(soimn): The value is r / s, and the rounding interval is (r - m_minus, r + m_plus) / s, all scaled 
+    //              by 2 or 4 to keep the half gaps integral. The interval is inclusive for even significands, 
+    //              matching round half to even parsing.
+    bool is_even = !(f & 1);
+    
+    Big_Int r       = BigInt(f);
+    Big_Int s       = BigInt(1);
+    Big_Int m_plus  = BigInt(1);
+    Big_Int m_minus = BigInt(1);
+    
+    U32 extra_shift = (lower_closer ? 2 : 1);
+    
+    if (e >= 0)
+    {
+        ShiftLeft(&r, (U32)e + extra_shift);
+        ShiftLeft(&s, extra_shift);
+        ShiftLeft(&m_plus, (U32)e + extra_shift - 1);
+        ShiftLeft(&m_minus, (U32)e);
+    }
+    
+    else
+    {
+        ShiftLeft(&r, extra_shift);
+        ShiftLeft(&s, (U32)-e + extra_shift);
+        ShiftLeft(&m_plus, extra_shift - 1);
+    }
+    
+    U32 bit_count = 0;
+    for (U64 scan = f; scan; scan >>= 1) ++bit_count;
+    
+    // NOTE(soimn): Estimate of ceil(log10(value)), which is either exact or one too small
+    I32 k = CeilF64((e + (I32)bit_count - 1) * 0.30102999566398114 - 1e-10);
+    
+    if (k >= 0)
+    {
+        MultiplyPowerOfTen(&s, (U32)k);
+    }
+    
+    else
+    {
+        MultiplyPowerOfTen(&r, (U32)-k);
+        MultiplyPowerOfTen(&m_plus, (U32)-k);
+        MultiplyPowerOfTen(&m_minus, (U32)-k);
+    }
+    
+    while (CompareSum(&r, &m_plus, &s) >= (is_even ? 0 : 1))
+    {
+        MultiplySmall(&s, 10);
+        ++k;
+    }
+    
+    U32 length = 0;
+    
+    for (;;)
+    {
+        MultiplySmall(&r, 10);
+        MultiplySmall(&m_plus, 10);
+        MultiplySmall(&m_minus, 10);
+        
+        U32 digit = 0;
+        while (Compare(&r, &s) >= 0)
+        {
+            Subtract(&r, &s);
+            ++digit;
+        }
+        
+        bool is_low  = (Compare(&r, &m_minus) < (is_even ? 1 : 0));
+        bool is_high = (CompareSum(&r, &m_plus, &s) > (is_even ? -1 : 0));
+        
+        if (is_low && is_high)
+        {
+            Big_Int twice_r = r;
+            ShiftLeft(&twice_r, 1);
+            
+            I32 comparison = Compare(&twice_r, &s);
+            digit += (comparison > 0 || (comparison == 0 && (digit & 1)));
+        }
+        
+        else if (is_high)
+        {
+            ++digit;
+        }
+        
+        digits[length++] = (char)('0' + digit);
+        
+        if (is_low || is_high) break;
+    }
+    
+    *exponent = k - (I32)length;
+    
+    return length;
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+inline U32
+FormatShortest(U64 f, I32 e, bool lower_closer, char* digits, I32* exponent)
+{
+    U32 length = 0;
+    
+    if (!FormatShortestGrisu(f, e, lower_closer, digits, &length, exponent))
+    {
+        length = FormatShortestBigInt(f, e, lower_closer, digits, exponent);
+    }
+    
+    return length;
+}
+
+// NOTE(soimn): Lays out the digits either positionally or in scientific notation, and always includes a 
+//              fraction or an exponent, so the result reads back as a floating point literal
+inline U32
+FormatDecimal(char* buffer, bool is_negative, char* digits, U32 length, I32 exponent, bool allow_scientific)
+{
+    U32 result = 0;
+    
+    if (is_negative)
+    {
+        buffer[result++] = '-';
+    }
+    
+    I32 decimal_point = (I32)length + exponent;
+    I32 scientific_exponent = decimal_point - 1;
+    
+    if (allow_scientific && (scientific_exponent < -4 || scientific_exponent > 16))
+    {
+        buffer[result++] = digits[0];
+        
+        if (length > 1)
+        {
+            buffer[result++] = '.';
+            
+            for (U32 i = 1; i < length; ++i)
+            {
+                buffer[result++] = digits[i];
+            }
+        }
+        
+        buffer[result++] = 'e';
+        buffer[result++] = (scientific_exponent < 0 ? '-' : '+');
+        
+        U32 magnitude = (U32)(scientific_exponent < 0 ? -scientific_exponent : scientific_exponent);
+        
+        if (magnitude >= 100)
+        {
+            buffer[result++] = (char)('0' + magnitude / 100);
+        }
+        
+        buffer[result++] = (char)('0' + magnitude / 10 % 10);
+        buffer[result++] = (char)('0' + magnitude % 10);
+    }
+    
+    else if (decimal_point <= 0)
+    {
+        buffer[result++] = '0';
+        buffer[result++] = '.';
+        
+        for (I32 i = 0; i < -decimal_point; ++i)
+        {
+            buffer[result++] = '0';
+        }
+        
+        for (U32 i = 0; i < length; ++i)
+        {
+            buffer[result++] = digits[i];
+        }
+    }
+    
+    else if ((U32)decimal_point >= length)
+    {
+        for (U32 i = 0; i < length; ++i)
+        {
+            buffer[result++] = digits[i];
+        }
+        
+        for (U32 i = length; i < (U32)decimal_point; ++i)
+        {
+            buffer[result++] = '0';
+        }
+        
+        buffer[result++] = '.';
+        buffer[result++] = '0';
+    }
+    
+    else
+    {
+        for (U32 i = 0; i < length; ++i)
+        {
+            if (i == (U32)decimal_point)
+            {
+                buffer[result++] = '.';
+            }
+            
+            buffer[result++] = digits[i];
+        }
+    }
+    
+    return result;
+}
+
+inline U32
+FormatSpecialFloat(char* buffer, bool is_negative, bool is_nan, bool is_zero)
+{
+    String string = {};
+    
+    if (is_nan)          string = CONST_STRING("nan");
+    else if (is_zero)    string = (is_negative ? String CONST_STRING("-0.0") : String CONST_STRING("0.0"));
+    else                 string = (is_negative ? String CONST_STRING("-inf") : String CONST_STRING("inf"));
+    
+    for (UMM i = 0; i < string.size; ++i)
+    {
+        buffer[i] = (char)string.data[i];
+    }
+    
+    return (U32)string.size;
+}
+
+// NOTE(soimn): The buffer must hold at least FLOAT_FORMAT_MAX_LENGTH characters
+inline U32
+FormatF64(char* buffer, F64 value, bool allow_scientific)
+{
+    union
+    {
+        F64 f64;
+        U64 bits;
+    } pun;
+    
+    pun.f64 = value;
+    
+    bool is_negative    = (pun.bits >> 63) != 0;
+    U32 biased_exponent = (U32)(pun.bits >> 52) & 0x7FF;
+    U64 fraction        = pun.bits & ((1ULL << 52) - 1);
+    
+    U32 result = 0;
+    
+    if (biased_exponent == 0x7FF || (biased_exponent == 0 && fraction == 0))
+    {
+        result = FormatSpecialFloat(buffer, is_negative, biased_exponent == 0x7FF && fraction != 0, biased_exponent == 0);
+    }
+    
+    else
+    {
+        U64 f             = (biased_exponent ? fraction | (1ULL << 52) : fraction);
+        I32 e             = (biased_exponent ? (I32)biased_exponent : 1) - 1075;
+        bool lower_closer = (fraction == 0 && biased_exponent > 1);
+        
+        char digits[FLOAT_FORMAT_DIGIT_BUFFER_SIZE];
+        I32 exponent = 0;
+        U32 length   = FormatShortest(f, e, lower_closer, digits, &exponent);
+        
+        result = FormatDecimal(buffer, is_negative, digits, length, exponent, allow_scientific);
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): The buffer must hold at least FLOAT_FORMAT_MAX_LENGTH characters
+inline U32
+FormatF32(char* buffer, F32 value, bool allow_scientific)
+{
+    union
+    {
+        F32 f32;
+        U32 bits;
+    } pun;
+    
+    pun.f32 = value;
+    
+    bool is_negative    = (pun.bits >> 31) != 0;
+    U32 biased_exponent = (pun.bits >> 23) & 0xFF;
+    U32 fraction        = pun.bits & ((1U << 23) - 1);
+    
+    U32 result = 0;
+    
+    if (biased_exponent == 0xFF || (biased_exponent == 0 && fraction == 0))
+    {
+        result = FormatSpecialFloat(buffer, is_negative, biased_exponent == 0xFF && fraction != 0, biased_exponent == 0);
+    }
+    
+    else
+    {
+        U64 f             = (biased_exponent ? fraction | (1U << 23) : fraction);
+        I32 e             = (biased_exponent ? (I32)biased_exponent : 1) - 150;
+        bool lower_closer = (fraction == 0 && biased_exponent > 1);
+        
+        char digits[FLOAT_FORMAT_DIGIT_BUFFER_SIZE];
+        I32 exponent = 0;
+        U32 length   = FormatShortest(f, e, lower_closer, digits, &exponent);
+        
+        result = FormatDecimal(buffer, is_negative, digits, length, exponent, allow_scientific);
+    }
+    
+    return result;
+}
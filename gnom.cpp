@@ -1,80 +1,87 @@
 #include "common.h"
 #include "error_handling.h"
 #include "memory.h"
+#include "hash_map.h"
+#include "diagnostics.h"
+#include "jobs.h"
 #include "lexer.h"
+#include "parser.h"
+#include "ast_cache.h"
+#include "module.h"
+#include "symbols.h"
+#include "checker.h"
 
-#define NOMINMAX
-#define WIN32_LEAN_AND_MEAN
-#include <windows.h>
-#undef WIN32_LEAN_AND_MEAN
-#undef NOMINMAX
-#undef near
-#undef far
+#include "win32_platform.h"
+
+#define OUTPUT_STREAM_FLUSH_THRESHOLD KILOBYTES(16)
 
 global Memory_Arena  OutputStreamArena = {};
 global String_Stream ErrorStreamObject = {};
 global String_Stream PrintStreamObject = {};
 
-inline Memory_Block*
-AllocateMemoryBlock(UMM block_size)
+// NOTE(soimn): Kept out of the stack of main, since it holds the deques of every possible worker
+global Job_System JobSystem = {};
+
+int
+main(int argc, const char** argv)
 {
-    Memory_Block* new_block = 0;
-    
-    UMM total_size = (alignof(Memory_Block) - 1) + sizeof(Memory_Block) + block_size;
-    
-    void* memory = VirtualAlloc(0, total_size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
-    
-    Assert(memory, "Failed to allocate memory block");
+    ErrorStreamObject = OutputStream(&OutputStreamArena, GetStdHandle(STD_ERROR_HANDLE), OUTPUT_STREAM_FLUSH_THRESHOLD);
+    ErrorStream = &ErrorStreamObject;
     
-    new_block = (Memory_Block*) Align(memory, alignof(Memory_Block));
+    PrintStreamObject = OutputStream(&OutputStreamArena, GetStdHandle(STD_OUTPUT_HANDLE), OUTPUT_STREAM_FLUSH_THRESHOLD);
+    PrintStream = &PrintStreamObject;
     
-    *new_block = {};
-    new_block->push_ptr = Align(new_block + 1, 8);
-    new_block->space    = total_size - (new_block->push_ptr - (U8*) new_block);
+    int result = 0;
     
-    return new_block;
-}
-
-inline void
-FreeMemoryBlock(Memory_Block* block)
-{
-    VirtualFree((void*) block, block->space + (block->push_ptr - (U8*) block), MEM_RELEASE | MEM_DECOMMIT);
-}
-
-inline void
-Flush(String_Stream* stream)
-{
-    // NOTE(soimn): This acquires a handle to stderr which is not 
-    //              buffered
-    HANDLE output_handle = GetStdHandle((U32)-12);
+    // NOTE(soimn): Options come before the files
+    bool use_ast_cache = false;
+    int first_file     = 1;
     
-    Bucket_Array* bucket_array = &stream->bucket_array;
-    for (Bucket_Array_Block* scan = bucket_array->first_block; scan; scan = scan->next)
+    for (; first_file < argc && argv[first_file][0] == '-'; ++first_file)
     {
-        void* start = scan + 1;
-        U32 size = (scan == bucket_array->current_block ? bucket_array->current_block->offset : bucket_array->block_size);
+        String option = {(U8*)argv[first_file], StringLength(argv[first_file])};
         
-        if (size)
-        {
-            DWORD chars_written;
-            WriteConsole(output_handle, start, size, &chars_written, 0);
-        }
+        if (StringCompare(option, CONST_STRING("-cache"))) use_ast_cache = true;
+        else                                               break;
     }
     
-    ResetArray(&stream->bucket_array);
-}
-
-int
-main(int argc, const char** argv)
-{
-    ErrorStreamObject.bucket_array = BUCKET_ARRAY(&OutputStreamArena, char, 512);
-    ErrorStream = &ErrorStreamObject;
+    if (first_file >= argc || argv[first_file][0] == '-')
+    {
+        // NOTE(soimn): -cache keeps the syntax tree of every file next to it, and skips parsing unchanged files
+        Print(ErrorStream, "Usage: %s [-cache] file...\n", argv[0]);
+        result = 1;
+    }
     
-    PrintStreamObject.bucket_array = BUCKET_ARRAY(&OutputStreamArena, char, 512);
-    PrintStream = &PrintStreamObject;
+    else
+    {
+        Diagnostics_Engine diagnostics = DiagnosticsEngine();
+        
+        StartJobSystem(&JobSystem);
+        
+        Job_Worker* main_worker = &JobSystem.workers[0];
+        
+        // NOTE(soimn): Function bodies are parsed when the checker gets to them, unless the AST cache is used
+        Module module = ParseFiles(main_worker, argv + first_file, (U32)(argc - first_file), &diagnostics, true, use_ast_cache);
+        
+        Atom_Table atoms = AtomTable();
+        Checker checker  = {};
+        
+        // NOTE(soimn): Declarations are only resolved in trees without syntax errors, as the errors cascade
+        if (diagnostics.error_count == 0) checker = CheckModule(main_worker, &module, &atoms, &diagnostics);
+        
+        result = (diagnostics.error_count != 0);
+        
+        EmitDiagnostics(&diagnostics, ErrorStream);
+        
+        FreeChecker(&checker);
+        FreeAtomTable(&atoms);
+        FreeModule(&module);
+        
+        StopJobSystem(&JobSystem);
+    }
     
-    Print(ErrorStream, "Hello %s!", "World");
+    Flush(PrintStream);
     Flush(ErrorStream);
     
-    return 0;
+    return result;
 }
\ No newline at end of file
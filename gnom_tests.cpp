@@ -0,0 +1,2660 @@
+#include "common.h"
+#include "error_handling.h"
+#include "memory.h"
+#include "hash_map.h"
+#include "diagnostics.h"
+#include "jobs.h"
+#include "lexer.h"
+#include "parser.h"
+#include "ast_cache.h"
+#include "module.h"
+#include "symbols.h"
+#include "checker.h"
+
+#include "win32_platform.h"
+
+// NOTE(soimn): Only used as the reference the formatting functions are checked and timed against
+#include <stdio.h>
+#include <stdlib.h>
+
+// NOTE(soimn): Test and benchmark driver, built by "build.bat tests". Without arguments every test is run, and
+//              with "bench" every benchmark. Either can be followed by a name, to only run the test or benchmark
+//              of that name. The driver exits with 1 when a check of a test failed.
+//
+//              Benchmarks print their timings and are meant to be compared between runs of the same build on the
+//              same machine, which is why the tests target is built with optimizations.
+
+#define OUTPUT_STREAM_FLUSH_THRESHOLD KILOBYTES(16)
+
+// NOTE(soimn): Only the first few failed checks of a test are printed, as tests over random inputs may fail a
+//              check millions of times
+#define TEST_MAX_REPORTED_FAILURES 16
+
+global Memory_Arena  OutputStreamArena = {};
+global String_Stream ErrorStreamObject = {};
+global String_Stream PrintStreamObject = {};
+
+global Job_System JobSystem = {};
+
+struct Test_State
+{
+    const char* name;
+    U32 check_count;
+    U32 failure_count;
+};
+
+global Test_State TestState = {};
+
+// NOTE(soimn): Written by benchmarks, so the work they time is not optimized out
+global volatile U64 BenchmarkSink = 0;
+
+inline bool
+CheckCondition(bool condition, const char* file, U32 line, const char* condition_string)
+{
+    ++TestState.check_count;
+    
+    if (!condition)
+    {
+        if (TestState.failure_count < TEST_MAX_REPORTED_FAILURES)
+        {
+            Print(ErrorStream, "[FAILED] %s: '%s' at %s(%u)\n", TestState.name, condition_string, file, line);
+        }
+        
+        ++TestState.failure_count;
+    }
+    
+    return condition;
+}
+
+// NOTE(soimn): Evaluates to the condition, so a test can print the inputs of a failed check
+#define Check(condition) CheckCondition((condition), __FILE__, __LINE__, #condition)
+
+inline U64
+ReadTimer()
+{
+    LARGE_INTEGER counter = {};
+    QueryPerformanceCounter(&counter);
+    
+    return (U64)counter.QuadPart;
+}
+
+inline F64
+SecondsSince(U64 start)
+{
+    LARGE_INTEGER frequency = {};
+    QueryPerformanceFrequency(&frequency);
+    
+    return (F64)(ReadTimer() - start) / (F64)frequency.QuadPart;
+}
+
+// NOTE(soimn): Rounds a positive timing to 2 decimals, so it prints short
+inline F64
+RoundTiming(F64 value)
+{
+    return (F64)(U64)(value * 100 + 0.5) / 100;
+}
+
+inline void
+ReportBenchmark(const char* name, F64 seconds, U64 operation_count)
+{
+    F64 nanoseconds = seconds * 1e9 / (F64)MAX(operation_count, 1);
+    
+    Print(PrintStream, "    %s: %F ns/op, %U ops in %F ms\n", name, RoundTiming(nanoseconds), operation_count, RoundTiming(seconds * 1e3));
+}
+
+inline void
+ReportThroughput(const char* name, F64 seconds, U64 byte_count)
+{
+    F64 megabytes_per_second = (F64)byte_count / (F64)MEGABYTES(1) / MAX(seconds, 1e-9);
+    
+    Print(PrintStream, "    %s: %F MB/s, %U bytes in %F ms\n", name, RoundTiming(megabytes_per_second), byte_count, RoundTiming(seconds * 1e3));
+}
+
+inline void
+ReportRate(const char* name, F64 seconds, U64 count, const char* unit)
+{
+    F64 millions_per_second = (F64)count / 1e6 / MAX(seconds, 1e-9);
+    
+    Print(PrintStream, "    %s: %F million %s/s, %U %s in %F ms\n", name, RoundTiming(millions_per_second), unit, count, unit, RoundTiming(seconds * 1e3));
+}
+
+// NOTE(soimn): xorshift64*, seeded per test so every run sees the same inputs
+inline U64
+RandomU64(U64* state)
+{
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+inline U32
+RandomU32(U64* state, U32 bound)
+{
+    return (U32)((RandomU64(state) >> 32) % bound);
+}
+
+// NOTE(soimn): Identifier-like names, symbol_0, symbol_1, ..., with the text in the arena
+inline String*
+GenerateNames(Memory_Arena* arena, U32 count, const char* prefix)
+{
+    String* result = PushArray(arena, String, MAX(count, 1));
+    
+    UMM prefix_length = StringLength(prefix);
+    
+    for (U32 i = 0; i < count; ++i)
+    {
+        char digits[24];
+        U32 digit_count = FormatU64(digits, i);
+        
+        result[i].size = prefix_length + digit_count;
+        result[i].data = (U8*)PushSize(arena, result[i].size);
+        
+        Copy((void*)prefix, result[i].data, prefix_length);
+        Copy(digits, result[i].data + prefix_length, digit_count);
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Source text with declaration_count top level declarations, for the parser and checker tests and
+//              benchmarks. Every eighth declaration is a struct, and the rest are tagged globals and functions,
+//              whose bodies have a few statements of every kind. Declarations only refer to the declarations before
+//              them, so the text parses and checks without errors.
+inline void
+GenerateSource(String_Stream* stream, U64* random, U32 declaration_count)
+{
+    U32 last_struct   = 0;
+    U32 last_global   = 0;
+    U32 last_function = 0;
+    
+    Assert(declaration_count >= 3);
+    
+    // NOTE(soimn): One declaration of every kind, for the first of the others to refer to
+    Print(stream, "struct Type_0\n{\n    int a;\n    float* b;\n};\n\nint global_0 = 1;\n\nint function_0(int a, int b);\n\n");
+    
+    for (U32 i = 3; i < declaration_count; ++i)
+    {
+        U32 kind = (i % 8 == 0 ? 0 : 1 + RandomU32(random, 2));
+        
+        if (kind == 0)
+        {
+            Print(stream, "struct Type_%u\n{\n    Type_%u* next;\n    int count;\n    float weights;\n};\n\n", i, last_struct);
+            last_struct = i;
+        }
+        
+        else if (kind == 1)
+        {
+            Print(stream, "@align(16) @section(\"data\") int global_%u = global_%u * %u + (global_%u << 2);\n\n",
+                  i, last_global, RandomU32(random, 1000), last_global);
+            last_global = i;
+        }
+        
+        else
+        {
+            Print(stream, "@inline\nint function_%u(Type_%u* node, int a, int b)\n{\n", i, last_struct);
+            Print(stream, "    int x = a * b + global_%u, y = %u;\n", last_global, RandomU32(random, 100));
+            Print(stream, "    if (x > y && node) x = x - function_%u(a, b);\n    else x = x + a;\n", last_function);
+            Print(stream, "    for (int k = 0; k < 10; k += 1) {\n        x = x + k * node.count;\n    }\n");
+            Print(stream, "    while (x > 100) x = x >> 1;\n    return x ? x : -y;\n}\n\n");
+            last_function = i;
+        }
+    }
+}
+
+inline String_Stream_Interval
+WholeStream(String_Stream* stream)
+{
+    return {stream->bucket_array.first_block, STRING_STREAM_BLOCK_SIZE, 0, stream->bucket_array.num_elements};
+}
+
+// NOTE(soimn): Writes files of generated source to the working directory, and returns their paths. The files are
+//              named after the prefix, and are left for DeleteFiles.
+inline const char**
+GenerateFiles(Memory_Arena* arena, U64* random, U32 file_count, U32 declarations_per_file, const char* prefix)
+{
+    const char** result = PushArray(arena, const char*, MAX(file_count, 1));
+    String* names       = GenerateNames(arena, file_count, prefix);
+    
+    for (U32 i = 0; i < file_count; ++i)
+    {
+        char* path = (char*)PushSize(arena, names[i].size + sizeof(".gn"), 1);
+        Copy(names[i].data, path, names[i].size);
+        Copy((void*)".gn", path + names[i].size, sizeof(".gn"));
+        
+        Memory_Arena scratch = {};
+        String_Stream stream = StringStream(&scratch);
+        GenerateSource(&stream, random, declarations_per_file);
+        
+        String contents = Linearize(WholeStream(&stream), &scratch);
+        
+        bool is_written = WriteEntireFile(path, contents.data, contents.size);
+        Assert(is_written, "Failed to write a generated file");
+        
+        ClearArena(&scratch);
+        
+        result[i] = path;
+    }
+    
+    return result;
+}
+
+inline void
+DeleteFiles(const char** paths, U32 count)
+{
+    for (U32 i = 0; i < count; ++i) DeleteFileA(paths[i]);
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+#define TEST_HASH_MAP_KEY_RANGE 4096
+#define TEST_HASH_MAP_OPERATIONS 200000
+
+// NOTE(soimn): Random inserts, removes and lookups on a small key range, checked against a direct mapped array
+inline void
+TestHashMap()
+{
+    Memory_Arena arena = {};
+    
+    Hash_Map<U32, U32> map = HashMap<U32, U32>(&arena);
+    
+    U32* values  = PushArray(&arena, U32, TEST_HASH_MAP_KEY_RANGE);
+    bool* exists = PushArray(&arena, bool, TEST_HASH_MAP_KEY_RANGE);
+    U32 count    = 0;
+    
+    ZeroArray(values, TEST_HASH_MAP_KEY_RANGE);
+    ZeroArray(exists, TEST_HASH_MAP_KEY_RANGE);
+    
+    U64 random = 0x9E3779B97F4A7C15ULL;
+    
+    for (U32 i = 0; i < TEST_HASH_MAP_OPERATIONS; ++i)
+    {
+        U32 key       = RandomU32(&random, TEST_HASH_MAP_KEY_RANGE);
+        U32 operation = RandomU32(&random, 3);
+        
+        if (operation == 0)
+        {
+            Insert(&map, key, i);
+            
+            count      += !exists[key];
+            values[key] = i;
+            exists[key] = true;
+        }
+        
+        else if (operation == 1)
+        {
+            Check(Remove(&map, key) == exists[key]);
+            
+            count      -= exists[key];
+            exists[key] = false;
+        }
+        
+        else
+        {
+            U32* value = Lookup(&map, key);
+            
+            if (!Check((value != 0) == exists[key] && (!value || *value == values[key])))
+            {
+                Print(ErrorStream, "    key %u, operation %u\n", key, i);
+            }
+        }
+        
+        Check(map.count == count);
+    }
+    
+    // NOTE(soimn): Names as keys, built in bulk and looked up one at a time
+    String* names = GenerateNames(&arena, TEST_HASH_MAP_KEY_RANGE, "symbol_");
+    U32* indices  = PushArray(&arena, U32, TEST_HASH_MAP_KEY_RANGE);
+    
+    for (U32 i = 0; i < TEST_HASH_MAP_KEY_RANGE; ++i) indices[i] = i;
+    
+    Hash_Map<String, U32> name_map = HashMap<String, U32>(&arena);
+    BulkInsert(&name_map, names, indices, TEST_HASH_MAP_KEY_RANGE / 2);
+    
+    for (U32 i = 0; i < TEST_HASH_MAP_KEY_RANGE; ++i)
+    {
+        U32* value = Lookup(&name_map, names[i]);
+        
+        Check(i < TEST_HASH_MAP_KEY_RANGE / 2 ? value && *value == i : !value);
+    }
+    
+    ClearArena(&arena);
+}
+
+#define BENCH_HASH_MAP_SYMBOLS 200000
+#define BENCH_HASH_MAP_LOOKUPS 10000000
+
+// NOTE(soimn): Mirrors symbol resolution: a large global namespace is built once, from names and from atoms, and
+//              then looked up far more often than it is changed. Most lookups hit, the rest are names declared
+//              in a local scope that miss the global one.
+inline void
+BenchHashMap()
+{
+    Memory_Arena arena = {};
+    
+    String* names = GenerateNames(&arena, BENCH_HASH_MAP_SYMBOLS, "symbol_");
+    U32* atoms    = PushArray(&arena, U32, BENCH_HASH_MAP_SYMBOLS);
+    U32* queries  = PushArray(&arena, U32, BENCH_HASH_MAP_LOOKUPS);
+    
+    U64 random = 0x2545F4914F6CDD1DULL;
+    
+    for (U32 i = 0; i < BENCH_HASH_MAP_SYMBOLS; ++i) atoms[i] = i + 1;
+    
+    // NOTE(soimn): One in ten queries is for a name that was never inserted
+    for (U32 i = 0; i < BENCH_HASH_MAP_LOOKUPS; ++i)
+    {
+        U32 index  = RandomU32(&random, BENCH_HASH_MAP_SYMBOLS);
+        queries[i] = (RandomU32(&random, 10) == 0 ? index + BENCH_HASH_MAP_SYMBOLS : index);
+    }
+    
+    Memory_Arena map_arena = {};
+    
+    U64 start = ReadTimer();
+    
+    Hash_Map<String, U32> name_map = HashMap<String, U32>(&map_arena);
+    for (U32 i = 0; i < BENCH_HASH_MAP_SYMBOLS; ++i) Insert(&name_map, names[i], i);
+    
+    ReportBenchmark("insert names", SecondsSince(start), BENCH_HASH_MAP_SYMBOLS);
+    
+    start = ReadTimer();
+    
+    Hash_Map<U32, U32> atom_map = HashMap<U32, U32>(&map_arena);
+    for (U32 i = 0; i < BENCH_HASH_MAP_SYMBOLS; ++i) Insert(&atom_map, atoms[i], i);
+    
+    ReportBenchmark("insert atoms", SecondsSince(start), BENCH_HASH_MAP_SYMBOLS);
+    
+    start = ReadTimer();
+    
+    Hash_Map<U32, U32> bulk_map = HashMap<U32, U32>(&map_arena);
+    BulkInsert(&bulk_map, atoms, atoms, BENCH_HASH_MAP_SYMBOLS);
+    
+    ReportBenchmark("bulk insert atoms", SecondsSince(start), BENCH_HASH_MAP_SYMBOLS);
+    
+    U64 hits = 0;
+    start    = ReadTimer();
+    
+    for (U32 i = 0; i < BENCH_HASH_MAP_LOOKUPS; ++i)
+    {
+        hits += (Lookup(&atom_map, queries[i] + 1) != 0);
+    }
+    
+    ReportBenchmark("lookup atoms", SecondsSince(start), BENCH_HASH_MAP_LOOKUPS);
+    
+    // NOTE(soimn): Names are looked up a tenth as often, as a name is only hashed once when it is interned
+    String missing_name = CONST_STRING("symbol_missing");
+    start               = ReadTimer();
+    
+    for (U32 i = 0; i < BENCH_HASH_MAP_LOOKUPS / 10; ++i)
+    {
+        U32 query = queries[i];
+        hits     += (Lookup(&name_map, (query < BENCH_HASH_MAP_SYMBOLS ? names[query] : missing_name)) != 0);
+    }
+    
+    ReportBenchmark("lookup names", SecondsSince(start), BENCH_HASH_MAP_LOOKUPS / 10);
+    
+    BenchmarkSink = hits;
+    
+    ClearArena(&map_arena);
+    ClearArena(&arena);
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+#define TEST_INTEGER_FORMAT_VALUES 1000000
+
+// NOTE(soimn): Random values of every length, and every power of ten and its neighbours, checked against snprintf
+inline void
+TestIntegerFormat()
+{
+    U64 random = 0xD1B54A32D192ED03ULL;
+    
+    for (U32 i = 0; i < TEST_INTEGER_FORMAT_VALUES + 3 * 20 + 2; ++i)
+    {
+        U64 value = 0;
+        
+        if (i < TEST_INTEGER_FORMAT_VALUES) value = RandomU64(&random) >> RandomU32(&random, 64);
+        else if (i < TEST_INTEGER_FORMAT_VALUES + 3 * 20) value = PowersOfTen[(i - TEST_INTEGER_FORMAT_VALUES) / 3] + (i - TEST_INTEGER_FORMAT_VALUES) % 3 - 1;
+        else value = (i % 2 ? U64_MAX : (U64)I64_MIN);
+        
+        char buffer[24];
+        char expected[32];
+        
+        U32 length          = FormatU64(buffer, value);
+        int expected_length = snprintf(expected, sizeof(expected), "%llu", (unsigned long long)value);
+        
+        Check(length == (U32)expected_length && StringCompare(String{(U8*)buffer, length}, String{(U8*)expected, length}));
+        
+        length          = FormatI64(buffer, (I64)value);
+        expected_length = snprintf(expected, sizeof(expected), "%lld", (long long)value);
+        
+        if (!Check(length == (U32)expected_length && StringCompare(String{(U8*)buffer, length}, String{(U8*)expected, length})))
+        {
+            Print(ErrorStream, "    value %I\n", (I64)value);
+        }
+    }
+}
+
+#define BENCH_INTEGER_FORMAT_VALUES 10000000
+#define BENCH_INTEGER_FORMAT_LINES 1000000
+
+// NOTE(soimn): FormatU64 and FormatI64 against snprintf on values of every length, and a diagnostic-like line
+//              printed to a string stream against the same line printed with snprintf
+inline void
+BenchIntegerFormat()
+{
+    Memory_Arena arena = {};
+    
+    U64* values = PushArray(&arena, U64, BENCH_INTEGER_FORMAT_VALUES);
+    
+    U64 random = 0xD1B54A32D192ED03ULL;
+    
+    for (U32 i = 0; i < BENCH_INTEGER_FORMAT_VALUES; ++i)
+    {
+        values[i] = RandomU64(&random) >> RandomU32(&random, 64);
+    }
+    
+    char buffer[32];
+    U64 total_length = 0;
+    
+    U64 start = ReadTimer();
+    for (U32 i = 0; i < BENCH_INTEGER_FORMAT_VALUES; ++i) total_length += FormatU64(buffer, values[i]);
+    ReportBenchmark("FormatU64", SecondsSince(start), BENCH_INTEGER_FORMAT_VALUES);
+    
+    start = ReadTimer();
+    for (U32 i = 0; i < BENCH_INTEGER_FORMAT_VALUES; ++i) total_length += snprintf(buffer, sizeof(buffer), "%llu", (unsigned long long)values[i]);
+    ReportBenchmark("snprintf %llu", SecondsSince(start), BENCH_INTEGER_FORMAT_VALUES);
+    
+    start = ReadTimer();
+    for (U32 i = 0; i < BENCH_INTEGER_FORMAT_VALUES; ++i) total_length += FormatI64(buffer, (I64)values[i]);
+    ReportBenchmark("FormatI64", SecondsSince(start), BENCH_INTEGER_FORMAT_VALUES);
+    
+    start = ReadTimer();
+    for (U32 i = 0; i < BENCH_INTEGER_FORMAT_VALUES; ++i) total_length += snprintf(buffer, sizeof(buffer), "%lld", (long long)values[i]);
+    ReportBenchmark("snprintf %lld", SecondsSince(start), BENCH_INTEGER_FORMAT_VALUES);
+    
+    // NOTE(soimn): The stream is reset every line, so the timing does not include growing it
+    String_Stream stream = StringStream(&arena);
+    char line[256];
+    
+    start = ReadTimer();
+    
+    for (U32 i = 0; i < BENCH_INTEGER_FORMAT_LINES; ++i)
+    {
+        total_length += Print(&stream, "file_%u.gn(%u:%u): error: expected %s, found %s\n", i & 1023, (U32)values[i] & 0xFFFF, i & 127, "';'", "'}'");
+        ResetArray(&stream.bucket_array);
+    }
+    
+    ReportBenchmark("Print line", SecondsSince(start), BENCH_INTEGER_FORMAT_LINES);
+    
+    start = ReadTimer();
+    
+    for (U32 i = 0; i < BENCH_INTEGER_FORMAT_LINES; ++i)
+    {
+        total_length += snprintf(line, sizeof(line), "file_%u.gn(%u:%u): error: expected %s, found %s\n", i & 1023, (U32)values[i] & 0xFFFF, i & 127, "';'", "'}'");
+    }
+    
+    ReportBenchmark("snprintf line", SecondsSince(start), BENCH_INTEGER_FORMAT_LINES);
+    
+    BenchmarkSink = total_length;
+    
+    ClearArena(&arena);
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+#define TEST_FLOAT_FORMAT_VALUES 2000000
+#define TEST_FLOAT_FORMAT_SHORTEST_STRIDE 16
+#define TEST_FLOAT_FORMAT_GENERATOR_VALUES 200000
+
+// NOTE(soimn): The number of significant digits in the output of FormatF64 or FormatF32, without the leading and
+//              trailing zeros
+inline U32
+SignificantDigitCount(char* string, U32 length)
+{
+    U32 first = 0;
+    U32 last  = 0;
+    U32 count = 0;
+    
+    for (U32 i = 0; i < length && string[i] != 'e'; ++i)
+    {
+        if (string[i] >= '0' && string[i] <= '9')
+        {
+            ++count;
+            
+            if (string[i] != '0')
+            {
+                if (first == 0) first = count;
+                last = count;
+            }
+        }
+    }
+    
+    return (first == 0 ? 1 : last - first + 1);
+}
+
+// NOTE(soimn): Random bit patterns are formatted in both notations and parsed back with strtod and strtof, which
+//              has to give back the same bits. Every few values the digit count is checked against the shortest
+//              %.*e that round trips, and Grisu3 is checked against the big integer generator whenever it does
+//              not bail out.
+inline void
+TestFloatFormat()
+{
+    U64 random = 0x8CB92BA72F3D8DD7ULL;
+    
+    char buffer[FLOAT_FORMAT_MAX_LENGTH + 1];
+    char reference[64];
+    
+    for (U32 i = 0; i < TEST_FLOAT_FORMAT_VALUES; ++i)
+    {
+        union { F64 f64; U64 bits; } value;
+        union { F64 f64; U64 bits; } parsed;
+        
+        value.bits = RandomU64(&random);
+        
+        bool is_nan = ((value.bits >> 52) & 0x7FF) == 0x7FF && (value.bits & ((1ULL << 52) - 1)) != 0;
+        
+        for (U32 allow_scientific = 0; allow_scientific < 2; ++allow_scientific)
+        {
+            U32 length     = FormatF64(buffer, value.f64, allow_scientific != 0);
+            buffer[length] = 0;
+            parsed.f64     = strtod(buffer, 0);
+            
+            if (!Check(is_nan ? parsed.f64 != parsed.f64 : parsed.bits == value.bits))
+            {
+                Print(ErrorStream, "    F64 bits %U formatted as %s\n", value.bits, (const char*)buffer);
+            }
+            
+            if (allow_scientific && !is_nan && i % TEST_FLOAT_FORMAT_SHORTEST_STRIDE == 0)
+            {
+                int precision = 1;
+                
+                for (; precision < 17; ++precision)
+                {
+                    snprintf(reference, sizeof(reference), "%.*e", precision - 1, value.f64);
+                    
+                    parsed.f64 = strtod(reference, 0);
+                    if (parsed.bits == value.bits) break;
+                }
+                
+                if (!Check(SignificantDigitCount(buffer, length) <= (U32)precision))
+                {
+                    Print(ErrorStream, "    %s is longer than %s\n", (const char*)buffer, (const char*)reference);
+                }
+            }
+        }
+        
+        union { F32 f32; U32 bits; } value32;
+        union { F32 f32; U32 bits; } parsed32;
+        
+        value32.bits = (U32)RandomU64(&random);
+        
+        bool is_nan32 = ((value32.bits >> 23) & 0xFF) == 0xFF && (value32.bits & ((1U << 23) - 1)) != 0;
+        
+        for (U32 allow_scientific = 0; allow_scientific < 2; ++allow_scientific)
+        {
+            U32 length     = FormatF32(buffer, value32.f32, allow_scientific != 0);
+            buffer[length] = 0;
+            parsed32.f32   = strtof(buffer, 0);
+            
+            if (!Check(is_nan32 ? parsed32.f32 != parsed32.f32 : parsed32.bits == value32.bits))
+            {
+                Print(ErrorStream, "    F32 bits %u formatted as %s\n", value32.bits, (const char*)buffer);
+            }
+        }
+    }
+    
+    for (U32 i = 0; i < TEST_FLOAT_FORMAT_GENERATOR_VALUES; ++i)
+    {
+        // NOTE(soimn): Finite and non zero
+        U64 bits = RandomU64(&random) & 0x7FEFFFFFFFFFFFFFULL;
+        bits     = MAX(bits, 1);
+        
+        U64 fraction        = bits & ((1ULL << 52) - 1);
+        U32 biased_exponent = (U32)(bits >> 52);
+        
+        U64 f             = (biased_exponent ? fraction | (1ULL << 52) : fraction);
+        I32 e             = (biased_exponent ? (I32)biased_exponent : 1) - 1075;
+        bool lower_closer = (fraction == 0 && biased_exponent > 1);
+        
+        char digits[FLOAT_FORMAT_DIGIT_BUFFER_SIZE];
+        char grisu_digits[FLOAT_FORMAT_DIGIT_BUFFER_SIZE];
+        I32 exponent       = 0;
+        I32 grisu_exponent = 0;
+        U32 grisu_length   = 0;
+        
+        U32 length = FormatShortestBigInt(f, e, lower_closer, digits, &exponent);
+        
+        if (FormatShortestGrisu(f, e, lower_closer, grisu_digits, &grisu_length, &grisu_exponent))
+        {
+            Check(length == grisu_length && exponent == grisu_exponent &&
+                  StringCompare(String{(U8*)digits, length}, String{(U8*)grisu_digits, length}));
+        }
+    }
+}
+
+#define BENCH_FLOAT_FORMAT_VALUES 2000000
+
+// NOTE(soimn): Random finite bit patterns, which are mostly huge or tiny, and short decimal literals, which are
+//              what dumps of source constants mostly print, against snprintf with enough digits to round trip
+inline void
+BenchFloatFormat()
+{
+    Memory_Arena arena = {};
+    
+    F64* values   = PushArray(&arena, F64, BENCH_FLOAT_FORMAT_VALUES);
+    F64* literals = PushArray(&arena, F64, BENCH_FLOAT_FORMAT_VALUES);
+    
+    U64 random = 0x8CB92BA72F3D8DD7ULL;
+    
+    for (U32 i = 0; i < BENCH_FLOAT_FORMAT_VALUES; ++i)
+    {
+        union { F64 f64; U64 bits; } value;
+        value.bits = RandomU64(&random) & 0x7FEFFFFFFFFFFFFFULL;
+        
+        values[i]   = value.f64;
+        literals[i] = (F64)RandomU32(&random, 1000000) / 1000;
+    }
+    
+    char buffer[FLOAT_FORMAT_MAX_LENGTH];
+    U64 total_length = 0;
+    
+    U64 start = ReadTimer();
+    for (U32 i = 0; i < BENCH_FLOAT_FORMAT_VALUES; ++i) total_length += FormatF64(buffer, values[i], true);
+    ReportBenchmark("FormatF64 random bits", SecondsSince(start), BENCH_FLOAT_FORMAT_VALUES);
+    
+    start = ReadTimer();
+    for (U32 i = 0; i < BENCH_FLOAT_FORMAT_VALUES; ++i) total_length += snprintf(buffer, sizeof(buffer), "%.17g", values[i]);
+    ReportBenchmark("snprintf %.17g random bits", SecondsSince(start), BENCH_FLOAT_FORMAT_VALUES);
+    
+    start = ReadTimer();
+    for (U32 i = 0; i < BENCH_FLOAT_FORMAT_VALUES; ++i) total_length += FormatF64(buffer, literals[i], false);
+    ReportBenchmark("FormatF64 literals", SecondsSince(start), BENCH_FLOAT_FORMAT_VALUES);
+    
+    start = ReadTimer();
+    for (U32 i = 0; i < BENCH_FLOAT_FORMAT_VALUES; ++i) total_length += snprintf(buffer, sizeof(buffer), "%.17g", literals[i]);
+    ReportBenchmark("snprintf %.17g literals", SecondsSince(start), BENCH_FLOAT_FORMAT_VALUES);
+    
+    start = ReadTimer();
+    for (U32 i = 0; i < BENCH_FLOAT_FORMAT_VALUES; ++i) total_length += FormatF32(buffer, (F32)literals[i], false);
+    ReportBenchmark("FormatF32 literals", SecondsSince(start), BENCH_FLOAT_FORMAT_VALUES);
+    
+    BenchmarkSink = total_length;
+    
+    ClearArena(&arena);
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): Byte at a time versions of the string primitives, which the SIMD versions are checked against
+inline UMM
+ScalarStringLength(const char* cstring)
+{
+    UMM result = 0;
+    while (cstring[result]) ++result;
+    
+    return result;
+}
+
+inline bool
+ScalarMemoryEquals(U8* a, U8* b, UMM size)
+{
+    bool result = true;
+    for (UMM i = 0; i < size && result; ++i) result = (a[i] == b[i]);
+    
+    return result;
+}
+
+inline UMM
+ScalarFindFirstByte(String string, U8 byte)
+{
+    UMM result = 0;
+    while (result < string.size && string.data[result] != byte) ++result;
+    
+    return result;
+}
+
+inline UMM
+ScalarFindFirstOf(String string, String set)
+{
+    UMM result = 0;
+    while (result < string.size && ScalarFindFirstByte(set, string.data[result]) == set.size) ++result;
+    
+    return result;
+}
+
+#define TEST_STRING_ITERATIONS 200000
+#define TEST_STRING_MAX_LENGTH 300
+#define TEST_STRING_PAGE_SIZE KILOBYTES(4)
+
+// NOTE(soimn): Checks every primitive on a string whose last byte is the last byte before an inaccessible page, and
+//              one whose first byte is the first byte after one, for every length up to a few SIMD widths. A read
+//              past either end of the string faults.
+inline void
+TestStringPageBoundaries()
+{
+    U8* pages = (U8*)VirtualAlloc(0, 3 * TEST_STRING_PAGE_SIZE, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    Assert(pages, "Failed to allocate pages");
+    
+    DWORD old_protection = 0;
+    VirtualProtect(pages, TEST_STRING_PAGE_SIZE, PAGE_NOACCESS, &old_protection);
+    VirtualProtect(pages + 2 * TEST_STRING_PAGE_SIZE, TEST_STRING_PAGE_SIZE, PAGE_NOACCESS, &old_protection);
+    
+    U8* page_start = pages + TEST_STRING_PAGE_SIZE;
+    U8* page_end   = pages + 2 * TEST_STRING_PAGE_SIZE;
+    
+    for (UMM i = 0; i < TEST_STRING_PAGE_SIZE; ++i) page_start[i] = 'a';
+    
+    String set = CONST_STRING("xyz;");
+    
+    for (UMM length = 0; length <= 64; ++length)
+    {
+        // NOTE(soimn): The terminator is the last byte of the page
+        page_end[-1] = 0;
+        Check(StringLength((char*)page_end - 1 - length) == length);
+        page_end[-1] = 'a';
+        
+        String tail = {page_end - length, length};
+        String head = {page_start, length};
+        
+        Check(FindFirstByte(tail, 'x') == length);
+        Check(FindFirstByte(head, 'x') == length);
+        Check(FindFirstOf(tail, set) == length);
+        Check(FindFirstOf(head, set) == length);
+        Check(StringCompare(tail, head));
+        Check(StringHasPrefix(tail, head));
+        
+        if (length != 0)
+        {
+            // NOTE(soimn): A match on the last byte
+            page_end[-1] = ';';
+            Check(FindFirstByte(tail, ';') == length - 1);
+            Check(FindFirstOf(tail, set) == length - 1);
+            Check(!StringCompare(tail, head));
+            page_end[-1] = 'a';
+        }
+    }
+    
+    for (UMM length = 0; length <= 64; ++length)
+    {
+        // NOTE(soimn): The string is the first bytes of the page
+        page_start[length] = 0;
+        Check(StringLength((char*)page_start) == length);
+        page_start[length] = 'a';
+    }
+    
+    VirtualFree(pages, 0, MEM_RELEASE);
+}
+
+// NOTE(soimn): Random strings over a small alphabet, so matches land anywhere, at every alignment
+inline void
+TestStringPrimitives()
+{
+    U8 buffer[TEST_STRING_MAX_LENGTH + 32];
+    U8 other[TEST_STRING_MAX_LENGTH + 32];
+    
+    U64 random = 0x5851F42D4C957F2DULL;
+    
+    String sets[] = {CONST_STRING(""), CONST_STRING("d"), CONST_STRING("\"\\\n"), CONST_STRING("abcdefgh"), CONST_STRING("abcdefghi;")};
+    
+    for (U32 i = 0; i < TEST_STRING_ITERATIONS; ++i)
+    {
+        UMM offset    = RandomU32(&random, 16);
+        UMM length    = RandomU32(&random, TEST_STRING_MAX_LENGTH);
+        U32 alphabet  = 1 + RandomU32(&random, 40);
+        
+        for (UMM j = 0; j < length; ++j)
+        {
+            buffer[offset + j] = (U8)('a' + RandomU32(&random, alphabet));
+        }
+        
+        buffer[offset + length] = 0;
+        
+        String string = {buffer + offset, length};
+        
+        Check(StringLength((char*)string.data) == length);
+        
+        U8 byte = (U8)('a' + RandomU32(&random, alphabet + 1));
+        
+        if (!Check(FindFirstByte(string, byte) == ScalarFindFirstByte(string, byte)))
+        {
+            Print(ErrorStream, "    FindFirstByte of %u in %S\n", (U32)byte, string);
+        }
+        
+        String set = sets[RandomU32(&random, ARRAY_COUNT(sets))];
+        
+        if (!Check(FindFirstOf(string, set) == ScalarFindFirstOf(string, set)))
+        {
+            Print(ErrorStream, "    FindFirstOf %S in %S\n", set, string);
+        }
+        
+        // NOTE(soimn): A copy, which differs in a random byte half of the time
+        UMM other_offset = RandomU32(&random, 16);
+        Copy(string.data, other + other_offset, MAX(length, 1));
+        
+        if (length != 0 && RandomU32(&random, 2)) other[other_offset + RandomU32(&random, (U32)length)] ^= 1;
+        
+        String copy   = {other + other_offset, length};
+        String prefix = {other + other_offset, RandomU32(&random, (U32)length + 1)};
+        
+        Check(StringCompare(string, copy) == ScalarMemoryEquals(string.data, copy.data, length));
+        Check(StringHasPrefix(string, prefix) == ScalarMemoryEquals(string.data, prefix.data, prefix.size));
+    }
+}
+
+inline void
+TestStrings()
+{
+    TestStringPrimitives();
+    TestStringPageBoundaries();
+}
+
+#define BENCH_STRING_TEXT_SIZE MEGABYTES(16)
+#define BENCH_STRING_NAMES 1000000
+
+// NOTE(soimn): The primitives against their scalar versions, on short names, which is what symbol comparisons and
+//              reports see, and on long text with sparse matches, which is what scanning source text sees
+inline void
+BenchStrings()
+{
+    Memory_Arena arena = {};
+    
+    String* names = GenerateNames(&arena, BENCH_STRING_NAMES, "a_somewhat_long_symbol_name_");
+    
+    // NOTE(soimn): Null terminated copies, for StringLength
+    char** cnames = PushArray(&arena, char*, BENCH_STRING_NAMES);
+    
+    for (U32 i = 0; i < BENCH_STRING_NAMES; ++i)
+    {
+        cnames[i] = (char*)PushSize(&arena, names[i].size + 1);
+        Copy(names[i].data, cnames[i], names[i].size);
+        cnames[i][names[i].size] = 0;
+    }
+    
+    U8* text = (U8*)PushSize(&arena, BENCH_STRING_TEXT_SIZE + 1);
+    
+    U64 random = 0x5851F42D4C957F2DULL;
+    
+    for (UMM i = 0; i < BENCH_STRING_TEXT_SIZE; ++i) text[i] = (U8)('a' + RandomU32(&random, 26));
+    text[BENCH_STRING_TEXT_SIZE] = 0;
+    
+    // NOTE(soimn): A line break every 4KB on average
+    for (UMM i = 0; i < BENCH_STRING_TEXT_SIZE / KILOBYTES(4); ++i) text[RandomU32(&random, BENCH_STRING_TEXT_SIZE)] = '\n';
+    
+    // NOTE(soimn): An equal copy, so the comparisons go through the whole text
+    U8* text_copy = (U8*)PushSize(&arena, BENCH_STRING_TEXT_SIZE);
+    Copy(text, text_copy, BENCH_STRING_TEXT_SIZE);
+    
+    String text_string = {text, BENCH_STRING_TEXT_SIZE};
+    String set         = CONST_STRING("\"\\\n");
+    
+    U64 total = 0;
+    U64 start = 0;
+    
+    start = ReadTimer();
+    for (U32 i = 0; i < BENCH_STRING_NAMES; ++i) total += StringLength(cnames[i]);
+    ReportBenchmark("StringLength names", SecondsSince(start), BENCH_STRING_NAMES);
+    
+    start = ReadTimer();
+    for (U32 i = 0; i < BENCH_STRING_NAMES; ++i) total += ScalarStringLength(cnames[i]);
+    ReportBenchmark("scalar StringLength names", SecondsSince(start), BENCH_STRING_NAMES);
+    
+    start = ReadTimer();
+    for (U32 i = 0; i < BENCH_STRING_NAMES; ++i) total += StringCompare(names[i], names[(i + 1) % BENCH_STRING_NAMES]);
+    ReportBenchmark("StringCompare names", SecondsSince(start), BENCH_STRING_NAMES);
+    
+    start = ReadTimer();
+    for (U32 i = 0; i < BENCH_STRING_NAMES; ++i) total += ScalarMemoryEquals(names[i].data, names[(i + 1) % BENCH_STRING_NAMES].data, names[i].size);
+    ReportBenchmark("scalar StringCompare names", SecondsSince(start), BENCH_STRING_NAMES);
+    
+    start = ReadTimer();
+    total += StringLength((char*)text);
+    ReportThroughput("StringLength text", SecondsSince(start), BENCH_STRING_TEXT_SIZE);
+    
+    start = ReadTimer();
+    total += ScalarStringLength((char*)text);
+    ReportThroughput("scalar StringLength text", SecondsSince(start), BENCH_STRING_TEXT_SIZE);
+    
+    start = ReadTimer();
+    total += MemoryEquals(text, text_copy, BENCH_STRING_TEXT_SIZE);
+    ReportThroughput("StringCompare text", SecondsSince(start), BENCH_STRING_TEXT_SIZE);
+    
+    start = ReadTimer();
+    total += ScalarMemoryEquals(text, text_copy, BENCH_STRING_TEXT_SIZE);
+    ReportThroughput("scalar StringCompare text", SecondsSince(start), BENCH_STRING_TEXT_SIZE);
+    
+    // NOTE(soimn): Every line of the text, like a line table is built
+    start = ReadTimer();
+    for (String scan = text_string; scan.size; Advance(&scan, FindFirstByte(scan, '\n') + 1)) ++total;
+    ReportThroughput("FindFirstByte lines", SecondsSince(start), BENCH_STRING_TEXT_SIZE);
+    
+    start = ReadTimer();
+    for (String scan = text_string; scan.size; Advance(&scan, ScalarFindFirstByte(scan, '\n') + 1)) ++total;
+    ReportThroughput("scalar FindFirstByte lines", SecondsSince(start), BENCH_STRING_TEXT_SIZE);
+    
+    start = ReadTimer();
+    for (String scan = text_string; scan.size; Advance(&scan, FindFirstOf(scan, set) + 1)) ++total;
+    ReportThroughput("FindFirstOf string literal ends", SecondsSince(start), BENCH_STRING_TEXT_SIZE);
+    
+    start = ReadTimer();
+    for (String scan = text_string; scan.size; Advance(&scan, ScalarFindFirstOf(scan, set) + 1)) ++total;
+    ReportThroughput("scalar FindFirstOf string literal ends", SecondsSince(start), BENCH_STRING_TEXT_SIZE);
+    
+    BenchmarkSink = total;
+    
+    ClearArena(&arena);
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+#define TEST_JOBS_WORKERS 4
+#define TEST_JOBS_COUNT 100000
+#define TEST_JOBS_ROWS 64
+#define TEST_JOBS_COLUMNS 1000
+#define TEST_JOBS_SUBMITTED 20000
+
+struct Jobs_Test
+{
+    U32* marks;
+    volatile U32 element_count;
+    volatile U32 worker_job_counts[JOB_SYSTEM_MAX_WORKERS];
+};
+
+inline void
+MarkRangeJob(Job_Worker* worker, void* data, UMM start, UMM end)
+{
+    Jobs_Test* test = (Jobs_Test*)data;
+    
+    for (UMM i = start; i < end; ++i) test->marks[i] += 1;
+}
+
+inline void
+IncrementElements(Job_Worker* worker, U32* elements, UMM count, void* data)
+{
+    Jobs_Test* test = (Jobs_Test*)data;
+    
+    for (UMM i = 0; i < count; ++i) elements[i] += 1;
+    
+    AtomicAdd(&test->element_count, (U32)count);
+}
+
+// NOTE(soimn): Every row runs a ParallelFor of its own over the columns, from inside a job of the outer one
+inline void
+MarkRowsJob(Job_Worker* worker, void* data, UMM start, UMM end)
+{
+    Jobs_Test* test = (Jobs_Test*)data;
+    
+    for (UMM row = start; row < end; ++row)
+    {
+        Jobs_Test row_test = {};
+        row_test.marks = test->marks + row * TEST_JOBS_COLUMNS;
+        
+        ParallelFor(worker, TEST_JOBS_COLUMNS, 16, MarkRangeJob, &row_test);
+    }
+}
+
+// NOTE(soimn): Spins for a while, so the other workers have time to steal some of the submitted jobs
+inline void
+MarkSlowlyJob(Job_Worker* worker, void* data, UMM start, UMM end)
+{
+    Jobs_Test* test = (Jobs_Test*)data;
+    
+    volatile U32 spin = 0;
+    for (U32 i = 0; i < 1000; ++i) spin += i;
+    
+    test->marks[start] += 1;
+    AtomicAdd(&test->worker_job_counts[worker->index], 1);
+}
+
+inline U32
+CountMarksOtherThan(U32* marks, UMM count, U32 expected)
+{
+    U32 result = 0;
+    
+    for (UMM i = 0; i < count; ++i) result += (marks[i] != expected);
+    
+    return result;
+}
+
+// NOTE(soimn): Every flavour of ParallelFor, nested ParallelFors, and more jobs submitted from one worker than its
+//              deque starts out with room for. Every element and index has to be visited exactly once.
+inline void
+TestJobSystem(U32 worker_count)
+{
+    Memory_Arena arena = {};
+    
+    StartJobSystem(&JobSystem, worker_count);
+    
+    Job_Worker* worker = &JobSystem.workers[0];
+    
+    {
+        Jobs_Test test = {};
+        test.marks = PushArray(&arena, U32, TEST_JOBS_COUNT);
+        ZeroArray(test.marks, TEST_JOBS_COUNT);
+        
+        ParallelFor(worker, TEST_JOBS_COUNT, 16, MarkRangeJob, &test);
+        
+        Check(CountMarksOtherThan(test.marks, TEST_JOBS_COUNT, 1) == 0);
+    }
+    
+    {
+        Jobs_Test test = {};
+        
+        Dynamic_Array<U32> array = DynamicArray<U32>(TEST_JOBS_COUNT * sizeof(U32));
+        for (U32 i = 0; i < TEST_JOBS_COUNT; ++i) *PushElement(&array) = i;
+        
+        ParallelFor(worker, &array, 64, IncrementElements, &test);
+        
+        U32 mismatch_count = 0;
+        for (U32 i = 0; i < TEST_JOBS_COUNT; ++i) mismatch_count += (array.data[i] != i + 1);
+        
+        Check(mismatch_count == 0);
+        Check(test.element_count == TEST_JOBS_COUNT);
+        
+        FreeArray(&array);
+    }
+    
+    {
+        Jobs_Test test = {};
+        
+        Bucket_Array<U32, 256> array = BucketArray<U32, 256>(&arena);
+        for (U32 i = 0; i < TEST_JOBS_COUNT; ++i) *PushElement(&array) = i;
+        
+        ParallelFor(worker, &array, IncrementElements, &test);
+        
+        U32 mismatch_count = 0;
+        for (U32 i = 0; i < TEST_JOBS_COUNT; ++i) mismatch_count += (*ElementAt(&array, i) != i + 1);
+        
+        Check(mismatch_count == 0);
+        Check(test.element_count == TEST_JOBS_COUNT);
+    }
+    
+    {
+        Jobs_Test test = {};
+        test.marks = PushArray(&arena, U32, TEST_JOBS_ROWS * TEST_JOBS_COLUMNS);
+        ZeroArray(test.marks, TEST_JOBS_ROWS * TEST_JOBS_COLUMNS);
+        
+        ParallelFor(worker, TEST_JOBS_ROWS, 1, MarkRowsJob, &test);
+        
+        Check(CountMarksOtherThan(test.marks, TEST_JOBS_ROWS * TEST_JOBS_COLUMNS, 1) == 0);
+    }
+    
+    {
+        Jobs_Test test = {};
+        test.marks = PushArray(&arena, U32, TEST_JOBS_SUBMITTED);
+        ZeroArray(test.marks, TEST_JOBS_SUBMITTED);
+        
+        Job_Counter counter = {};
+        
+        for (U32 i = 0; i < TEST_JOBS_SUBMITTED; ++i)
+        {
+            SubmitJob(worker, MarkSlowlyJob, &test, &counter, i, i + 1);
+        }
+        
+        // NOTE(soimn): Worker 0 only runs jobs while it waits, so with no other worker to steal them, every job is
+        //              still in its deque, which had to grow to hold them
+        if (worker_count == 1) Check(worker->deque.buffer->mask + 1 >= TEST_JOBS_SUBMITTED);
+        
+        WaitForCounter(worker, &counter);
+        
+        Check(counter.count == 0);
+        Check(CountMarksOtherThan(test.marks, TEST_JOBS_SUBMITTED, 1) == 0);
+        
+        U32 stolen_count = 0;
+        for (U32 i = 1; i < worker_count; ++i) stolen_count += test.worker_job_counts[i];
+        
+        Check(stolen_count + test.worker_job_counts[0] == TEST_JOBS_SUBMITTED);
+        Check(worker_count == 1 || stolen_count != 0);
+    }
+    
+    StopJobSystem(&JobSystem);
+    
+    ClearArena(&arena);
+}
+
+inline void
+TestJobs()
+{
+    TestJobSystem(1);
+    TestJobSystem(TEST_JOBS_WORKERS);
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+#define TEST_PARSER_DECLARATIONS 20000
+
+inline bool
+TokenIs(Syntax_Tree* tree, Node_Index node, const char* name)
+{
+    return StringCompare(NodeToken(tree, node)->string, String{(U8*)name, StringLength(name)});
+}
+
+inline Syntax_Tree
+ParseCString(const char* source, Diagnostics_Engine* diagnostics, Memory_Arena* arena, bool lazy_function_bodies = false)
+{
+    String_Stream stream = StringStream(arena);
+    Append(&stream, String{(U8*)source, StringLength(source)});
+    
+    return ParseStringStream(stream, 1, diagnostics, PARSER_DEFAULT_MAX_ERRORS, lazy_function_bodies);
+}
+
+// NOTE(soimn): Tags on functions, globals and locals, and a broken tag, which the parser has to recover from
+inline void
+TestParseTags()
+{
+    Memory_Arena arena = {};
+    
+    {
+        Diagnostics_Engine diagnostics = DiagnosticsEngine();
+        
+        Syntax_Tree tree = ParseCString("@inline @section(\"text\", 4) int f(int a) { @unused int x = a; return x; }\n"
+                                        "@thread_local int g = 1, h;\n"
+                                        "int i;\n", &diagnostics, &arena);
+        
+        AST_Range declarations = NodeChildren(&tree, 0);
+        
+        if (Check(diagnostics.error_count == 0) && Check(declarations.end - declarations.start == 3))
+        {
+            Node_Index function = tree.extra_data.data[declarations.start];
+            Node_Index variable = tree.extra_data.data[declarations.start + 1];
+            Node_Index untagged = tree.extra_data.data[declarations.start + 2];
+            
+            AST_Range tags = NodeTags(&tree, function);
+            
+            if (Check(NodeKind(&tree, function) == ASTNode_FunctionDef) && Check(tags.end - tags.start == 2))
+            {
+                Node_Index inline_tag  = tree.extra_data.data[tags.start];
+                Node_Index section_tag = tree.extra_data.data[tags.start + 1];
+                
+                Check(NodeKind(&tree, inline_tag) == ASTNode_Tag && TokenIs(&tree, inline_tag, "inline"));
+                Check(NodeKind(&tree, section_tag) == ASTNode_Tag && TokenIs(&tree, section_tag, "section"));
+                
+                AST_Range arguments = NodeChildren(&tree, section_tag);
+                Check(arguments.end - arguments.start == 2);
+                Check(NodeChildren(&tree, inline_tag).start == NodeChildren(&tree, inline_tag).end);
+                
+                AST_Range statements = NodeChildren(&tree, NodeData(&tree, function)->rhs);
+                
+                if (Check(statements.end - statements.start == 2))
+                {
+                    Node_Index local = tree.extra_data.data[statements.start];
+                    AST_Range local_tags = NodeTags(&tree, local);
+                    
+                    Check(NodeKind(&tree, local) == ASTNode_VarDecl && local_tags.end - local_tags.start == 1);
+                }
+            }
+            
+            tags = NodeTags(&tree, variable);
+            
+            if (Check(NodeKind(&tree, variable) == ASTNode_VarDecl) && Check(tags.end - tags.start == 1))
+            {
+                Check(TokenIs(&tree, tree.extra_data.data[tags.start], "thread_local"));
+                Check(NodeVariables(&tree, variable).end - NodeVariables(&tree, variable).start == 2);
+            }
+            
+            tags = NodeTags(&tree, untagged);
+            Check(NodeKind(&tree, untagged) == ASTNode_VarDecl && tags.start == tags.end);
+        }
+        
+        FreeSyntaxTree(&tree);
+        ClearArena(&diagnostics.arena);
+    }
+    
+    {
+        Diagnostics_Engine diagnostics = DiagnosticsEngine();
+        
+        Syntax_Tree tree = ParseCString("@123 int x;\n@tag(1 int y;\nint z;\n", &diagnostics, &arena);
+        
+        AST_Range declarations = NodeChildren(&tree, 0);
+        
+        if (Check(diagnostics.error_count == 2) && Check(declarations.end - declarations.start == 3))
+        {
+            Check(NodeKind(&tree, tree.extra_data.data[declarations.start]) == ASTNode_Error);
+            Check(NodeKind(&tree, tree.extra_data.data[declarations.start + 1]) == ASTNode_Error);
+            Check(NodeKind(&tree, tree.extra_data.data[declarations.start + 2]) == ASTNode_VarDecl);
+        }
+        
+        FreeSyntaxTree(&tree);
+        ClearArena(&diagnostics.arena);
+    }
+    
+    ClearArena(&arena);
+}
+
+// NOTE(soimn): The generated source parses without errors, to one declaration per range of
+//              SplitTopLevelDeclarations, and to the same nodes with lazy function bodies once they are parsed
+inline void
+TestParseSource()
+{
+    Memory_Arena arena = {};
+    
+    String_Stream stream = StringStream(&arena);
+    
+    U64 random = 0x2545F4914F6CDD1DULL;
+    GenerateSource(&stream, &random, TEST_PARSER_DECLARATIONS);
+    
+    Diagnostics_Engine diagnostics = DiagnosticsEngine();
+    
+    Syntax_Tree tree = ParseStringStream(stream, 1, &diagnostics);
+    Syntax_Tree lazy = ParseStringStream(stream, 1, &diagnostics, PARSER_DEFAULT_MAX_ERRORS, true);
+    
+    AST_Range declarations = NodeChildren(&tree, 0);
+    Check(diagnostics.error_count == 0);
+    Check(declarations.end - declarations.start == TEST_PARSER_DECLARATIONS);
+    
+    Dynamic_Array<Token_Range> ranges = DynamicArray<Token_Range>(tree.tokens.count * sizeof(Token_Range));
+    SplitTopLevelDeclarations(tree.tokens.data, (U32)tree.tokens.count, &ranges);
+    Check(ranges.count == TEST_PARSER_DECLARATIONS);
+    FreeArray(&ranges);
+    
+    Parser parser = ParserState(&lazy, &diagnostics, PARSER_DEFAULT_MAX_ERRORS);
+    
+    AST_Range lazy_declarations = NodeChildren(&lazy, 0);
+    U32 function_count          = 0;
+    
+    if (Check(lazy_declarations.end - lazy_declarations.start == declarations.end - declarations.start))
+    {
+        for (U32 i = 0; i < declarations.end - declarations.start; ++i)
+        {
+            Node_Index node      = tree.extra_data.data[declarations.start + i];
+            Node_Index lazy_node = lazy.extra_data.data[lazy_declarations.start + i];
+            
+            if (!Check(NodeKind(&tree, node) == NodeKind(&lazy, lazy_node))) break;
+            
+            if (NodeKind(&lazy, lazy_node) == ASTNode_FunctionDef)
+            {
+                AST_Range statements      = NodeChildren(&tree, NodeData(&tree, node)->rhs);
+                AST_Range lazy_statements = NodeChildren(&lazy, ParseFunctionBody(&parser, lazy_node));
+                
+                Check(statements.end - statements.start == lazy_statements.end - lazy_statements.start);
+                
+                ++function_count;
+            }
+        }
+    }
+    
+    // NOTE(soimn): The lazy blocks stay behind in the tree once their bodies are parsed
+    Check(NodeCount(&lazy) == NodeCount(&tree) + function_count);
+    Check(diagnostics.error_count == 0);
+    
+    FreeParserState(&parser);
+    FreeSyntaxTree(&lazy);
+    FreeSyntaxTree(&tree);
+    ClearArena(&diagnostics.arena);
+    ClearArena(&arena);
+}
+
+// NOTE(soimn): Counts that a rolled back speculation has to restore
+struct Parser_Counts
+{
+    U32 token_index;
+    U32 node_count;
+    U32 extra_count;
+    U32 scratch_count;
+    U32 expression_stack_count;
+    bool is_recovering;
+};
+
+inline Parser_Counts
+ParserCounts(Parser* parser)
+{
+    return {parser->token_index, NodeCount(parser->tree), (U32)parser->tree->extra_data.count, (U32)parser->scratch.count,
+            (U32)parser->expression_stack.count, parser->is_recovering};
+}
+
+inline bool
+ParserCountsAreEqual(Parser_Counts a, Parser_Counts b)
+{
+    return (a.token_index == b.token_index && a.node_count == b.node_count && a.extra_count == b.extra_count &&
+            a.scratch_count == b.scratch_count && a.expression_stack_count == b.expression_stack_count &&
+            a.is_recovering == b.is_recovering);
+}
+
+// NOTE(soimn): A failed speculation nested in one that succeeds is rolled back to where it began, the outer one
+//              keeps what it parsed, and neither reports anything. Statements that only look like declarations are
+//              parsed as expressions, and broken declarations are reported as declarations.
+inline void
+TestSpeculation()
+{
+    Memory_Arena arena = {};
+    
+    {
+        Diagnostics_Engine diagnostics = DiagnosticsEngine();
+        
+        String_Stream stream = StringStream(&arena);
+        Append(&stream, CONST_STRING("x = 1 + 2; y = 3 + ; z;"));
+        
+        Syntax_Tree tree = SyntaxTree(Tokenize(stream, 1, &diagnostics));
+        
+        Parser parser = ParserState(&tree, &diagnostics, PARSER_DEFAULT_MAX_ERRORS);
+        BeginParsingRange(&parser, tree.tokens.data, 0, (U32)tree.tokens.count - 1);
+        
+        Parser_Counts start = ParserCounts(&parser);
+        
+        Parser_Checkpoint outer = BeginSpeculation(&parser);
+        
+        Node_Index assignment = ParseExpression(&parser);
+        Check(EatToken(&parser, Token_Semicolon));
+        
+        Parser_Counts after_outer = ParserCounts(&parser);
+        
+        // NOTE(soimn): The frame and the list element stand in for the ones an abandoned construct leaves behind
+        Parser_Checkpoint inner = BeginSpeculation(&parser);
+        
+        PushListElement(&parser, ParseExpression(&parser));
+        *PushElement(&parser.expression_stack) = {};
+        
+        Check(parser.is_recovering);
+        Check(!EndSpeculation(&parser, inner));
+        Check(ParserCountsAreEqual(ParserCounts(&parser), after_outer));
+        Check(!parser.speculation_failed && parser.speculation_depth == 1);
+        
+        Check(EndSpeculation(&parser, outer));
+        Check(ParserCountsAreEqual(ParserCounts(&parser), after_outer));
+        Check(NodeKind(&tree, assignment) == ASTNode_Binary && NodeToken(&tree, assignment)->type == Token_Equals);
+        Check(parser.speculation_depth == 0);
+        
+        RollBack(&parser, outer);
+        Check(ParserCountsAreEqual(ParserCounts(&parser), start));
+        
+        Check(parser.error_count == 0);
+        Check(diagnostics.error_count == 0);
+        
+        FreeParserState(&parser);
+        FreeSyntaxTree(&tree);
+        ClearArena(&diagnostics.arena);
+    }
+    
+    {
+        Diagnostics_Engine diagnostics = DiagnosticsEngine();
+        
+        Syntax_Tree tree = ParseCString("int f(int a) { a * b; a * b + c; for (a * b = 1; a; a = 0) a * b = a; int e = 1 + ; }\n",
+                                        &diagnostics, &arena);
+        
+        AST_Range declarations = NodeChildren(&tree, 0);
+        
+        if (Check(diagnostics.error_count == 1) && Check(declarations.end - declarations.start == 1))
+        {
+            AST_Range statements = NodeChildren(&tree, NodeData(&tree, tree.extra_data.data[declarations.start])->rhs);
+            
+            if (Check(statements.end - statements.start == 4))
+            {
+                Check(NodeKind(&tree, tree.extra_data.data[statements.start])     == ASTNode_VarDecl);
+                Check(NodeKind(&tree, tree.extra_data.data[statements.start + 1]) == ASTNode_ExpressionStatement);
+                Check(NodeKind(&tree, tree.extra_data.data[statements.start + 2]) == ASTNode_For);
+                Check(NodeKind(&tree, tree.extra_data.data[statements.start + 3]) == ASTNode_VarDecl);
+            }
+        }
+        
+        // NOTE(soimn): The error is the one of the declaration, not of the expression that was tried after it
+        String_Stream emitted = StringStream(&arena);
+        EmitDiagnostics(&diagnostics, &emitted);
+        
+        String emitted_text = Linearize(WholeStream(&emitted), &arena);
+        String expected     = CONST_STRING("Expected an expression, found ';'\n");
+        
+        if (Check(emitted_text.size >= expected.size))
+        {
+            Check(StringCompare(String{emitted_text.data + emitted_text.size - expected.size, expected.size}, expected));
+        }
+        
+        FreeSyntaxTree(&tree);
+        ClearArena(&diagnostics.arena);
+    }
+    
+    ClearArena(&arena);
+}
+
+#define TEST_TRAVERSAL_DECLARATIONS 5000
+#define TEST_TRAVERSAL_DEPTH 1000000
+
+// NOTE(soimn): Recursive reference for FlattenSyntaxTree, which records the pre-order and, for every position, the
+//              position after the last descendant. The children of every node stay behind on the scratch array.
+inline void
+ReferencePreOrder(Syntax_Tree* tree, Node_Index node, Dynamic_Array<Node_Index>* order, Dynamic_Array<U32>* ends, Dynamic_Array<Node_Index>* scratch)
+{
+    U32 position = (U32)order->count;
+    
+    *PushElement(order) = node;
+    *PushElement(ends)  = 0;
+    
+    UMM children_start = scratch->count;
+    PushNodeChildren(tree, node, scratch);
+    UMM children_end = scratch->count;
+    
+    for (UMM i = children_start; i < children_end; ++i)
+    {
+        ReferencePreOrder(tree, scratch->data[i], order, ends, scratch);
+    }
+    
+    ends->data[position] = (U32)order->count;
+}
+
+// NOTE(soimn): Every node is in post-order once, after its children, and the kind groups partition post-order
+inline void
+CheckTraversalOrders(Syntax_Tree* tree, AST_Traversal* traversal)
+{
+    U32 max_count = NodeCount(tree);
+    
+    Dynamic_Array<U32> positions = DynamicArray<U32>((max_count + 1) * sizeof(U32));
+    
+    U32* post_positions = PushElements(&positions, max_count);
+    for (U32 i = 0; i < max_count; ++i) post_positions[i] = U32_MAX;
+    
+    U32 repeated_count = 0;
+    
+    for (U32 i = 0; i < traversal->node_count; ++i)
+    {
+        repeated_count += (post_positions[traversal->post_order[i]] != U32_MAX);
+        post_positions[traversal->post_order[i]] = i;
+    }
+    
+    Check(repeated_count == 0);
+    
+    Dynamic_Array<Node_Index> children = DynamicArray<Node_Index>((max_count + 1) * sizeof(Node_Index));
+    U32 misplaced_count = 0;
+    
+    for (U32 i = 0; i < traversal->node_count; ++i)
+    {
+        Node_Index node = traversal->pre_order[i];
+        
+        ResetArray(&children);
+        PushNodeChildren(tree, node, &children);
+        
+        for (UMM j = 0; j < children.count; ++j)
+        {
+            misplaced_count += (post_positions[children.data[j]] >= post_positions[node]);
+        }
+    }
+    
+    Check(misplaced_count == 0);
+    
+    U32 grouped_count  = 0;
+    U32 mismatch_count = 0;
+    
+    for (U32 kind = 0; kind < AST_NODE_KIND_COUNT; ++kind)
+    {
+        AST_Range range = NodesOfKind(traversal, (Enum8(AST_NODE_KIND))kind);
+        
+        for (U32 i = range.start; i < range.end; ++i)
+        {
+            Node_Index node = traversal->by_kind[i];
+            
+            mismatch_count += (NodeKind(tree, node) != kind);
+            mismatch_count += (i > range.start && post_positions[traversal->by_kind[i - 1]] >= post_positions[node]);
+        }
+        
+        grouped_count += range.end - range.start;
+    }
+    
+    Check(mismatch_count == 0);
+    Check(grouped_count == traversal->node_count);
+    
+    FreeArray(&children);
+    FreeArray(&positions);
+}
+
+// NOTE(soimn): The flattened generated source matches a recursive walk, and a long chain of prefix operators, which
+//              would overflow the call stack of a recursive walk, flattens to one node per operator
+inline void
+TestFlattenTree()
+{
+    Memory_Arena arena = {};
+    
+    {
+        String_Stream stream = StringStream(&arena);
+        
+        U64 random = 0x1F83D9ABFB41BD6BULL;
+        GenerateSource(&stream, &random, TEST_TRAVERSAL_DECLARATIONS);
+        
+        Diagnostics_Engine diagnostics = DiagnosticsEngine();
+        Syntax_Tree tree = ParseStringStream(stream, 1, &diagnostics);
+        Check(diagnostics.error_count == 0);
+        
+        AST_Traversal traversal = FlattenSyntaxTree(&tree, &arena);
+        
+        U32 max_count = NodeCount(&tree);
+        
+        Dynamic_Array<Node_Index> order   = DynamicArray<Node_Index>((max_count + 1) * sizeof(Node_Index));
+        Dynamic_Array<U32> ends           = DynamicArray<U32>((max_count + 1) * sizeof(U32));
+        Dynamic_Array<Node_Index> scratch = DynamicArray<Node_Index>((max_count + 1) * sizeof(Node_Index));
+        
+        ReferencePreOrder(&tree, NODE_NONE, &order, &ends, &scratch);
+        
+        if (Check(traversal.node_count == order.count))
+        {
+            U32 mismatch_count = 0;
+            
+            for (U32 i = 0; i < traversal.node_count; ++i)
+            {
+                mismatch_count += (traversal.pre_order[i] != order.data[i]);
+                mismatch_count += (SkipSubtree(&traversal, i) != ends.data[i]);
+            }
+            
+            Check(mismatch_count == 0);
+            
+            CheckTraversalOrders(&tree, &traversal);
+        }
+        
+        FreeArray(&order);
+        FreeArray(&ends);
+        FreeArray(&scratch);
+        FreeSyntaxTree(&tree);
+        ClearArena(&diagnostics.arena);
+    }
+    
+    {
+        String_Stream stream = StringStream(&arena);
+        
+        Append(&stream, CONST_STRING("int deep = "));
+        for (U32 i = 0; i < TEST_TRAVERSAL_DEPTH; ++i) Append(&stream, CONST_STRING("~"));
+        Append(&stream, CONST_STRING("1;\n"));
+        
+        Diagnostics_Engine diagnostics = DiagnosticsEngine();
+        Syntax_Tree tree = ParseStringStream(stream, 1, &diagnostics);
+        Check(diagnostics.error_count == 0);
+        
+        AST_Traversal traversal = FlattenSyntaxTree(&tree, &arena);
+        
+        AST_Range unary = NodesOfKind(&traversal, ASTNode_Unary);
+        
+        if (Check(unary.end - unary.start == TEST_TRAVERSAL_DEPTH))
+        {
+            // NOTE(soimn): The outermost operator is last in post-order, and its subtree runs to the end
+            Node_Index outermost = traversal.by_kind[unary.end - 1];
+            
+            U32 position = 0;
+            while (position < traversal.node_count && traversal.pre_order[position] != outermost) ++position;
+            
+            Check(SkipSubtree(&traversal, position) == traversal.node_count);
+            Check(traversal.subtree_sizes[position] == TEST_TRAVERSAL_DEPTH + 1);
+            
+            CheckTraversalOrders(&tree, &traversal);
+        }
+        
+        FreeSyntaxTree(&tree);
+        ClearArena(&diagnostics.arena);
+    }
+    
+    ClearArena(&arena);
+}
+
+inline void
+TestParser()
+{
+    TestParseTags();
+    TestParseSource();
+    TestSpeculation();
+    TestFlattenTree();
+}
+
+#define BENCH_PARSER_DECLARATIONS 100000
+#define BENCH_PARSER_ITERATIONS 5
+
+// NOTE(soimn): Tokenizing and parsing a large generated file on one thread, eagerly and with lazy function bodies,
+//              in MB of source and nodes per second. The best of a few runs is reported.
+inline void
+BenchParser()
+{
+    Memory_Arena arena = {};
+    
+    String_Stream stream = StringStream(&arena);
+    
+    U64 random = 0x2545F4914F6CDD1DULL;
+    GenerateSource(&stream, &random, BENCH_PARSER_DECLARATIONS);
+    
+    UMM byte_count = stream.bucket_array.num_elements;
+    
+    Diagnostics_Engine diagnostics = DiagnosticsEngine();
+    
+    F64 tokenize_seconds = 1e9;
+    F64 parse_seconds    = 1e9;
+    F64 lazy_seconds     = 1e9;
+    U32 node_count       = 0;
+    U32 lazy_node_count  = 0;
+    UMM token_count      = 0;
+    
+    for (U32 iteration = 0; iteration < BENCH_PARSER_ITERATIONS; ++iteration)
+    {
+        U64 start = ReadTimer();
+        Dynamic_Array<Token> tokens = Tokenize(stream, 1, &diagnostics);
+        tokenize_seconds = MIN(tokenize_seconds, SecondsSince(start));
+        
+        token_count = tokens.count;
+        
+        Dynamic_Array<Token> lazy_tokens = DynamicArray<Token>(tokens.count * sizeof(Token));
+        CopyArray(tokens.data, PushElements(&lazy_tokens, tokens.count), tokens.count);
+        
+        start = ReadTimer();
+        Syntax_Tree tree = ParseTokens(tokens, &diagnostics);
+        parse_seconds = MIN(parse_seconds, SecondsSince(start));
+        
+        start = ReadTimer();
+        Syntax_Tree lazy = ParseTokens(lazy_tokens, &diagnostics, PARSER_DEFAULT_MAX_ERRORS, true);
+        lazy_seconds = MIN(lazy_seconds, SecondsSince(start));
+        
+        node_count      = NodeCount(&tree);
+        lazy_node_count = NodeCount(&lazy);
+        
+        FreeSyntaxTree(&lazy);
+        FreeSyntaxTree(&tree);
+    }
+    
+    Check(diagnostics.error_count == 0);
+    
+    ReportThroughput("Tokenize", tokenize_seconds, byte_count);
+    ReportRate("Tokenize", tokenize_seconds, token_count, "tokens");
+    ReportThroughput("ParseTokens", parse_seconds, byte_count);
+    ReportRate("ParseTokens", parse_seconds, node_count, "nodes");
+    ReportThroughput("ParseTokens lazy bodies", lazy_seconds, byte_count);
+    ReportRate("ParseTokens lazy bodies", lazy_seconds, lazy_node_count, "nodes");
+    
+    ClearArena(&diagnostics.arena);
+    ClearArena(&arena);
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): Lexes the declarations, joined by newlines, from a stream in the arena, which has to outlive the tokens
+inline Dynamic_Array<Token>
+TokenizeDeclarations(const char** declarations, U32 count, Diagnostics_Engine* diagnostics, Memory_Arena* arena)
+{
+    String_Stream stream = StringStream(arena);
+    
+    for (U32 i = 0; i < count; ++i)
+    {
+        Append(&stream, String{(U8*)declarations[i], StringLength(declarations[i])});
+        Append(&stream, CONST_STRING("\n"));
+    }
+    
+    return Tokenize(stream, 1, diagnostics);
+}
+
+// NOTE(soimn): Compares the trees node for node in pre-order, by kind, main token and subtree size, and the token
+//              after every lazy block
+inline void
+CheckTreesMatch(Syntax_Tree* tree, Syntax_Tree* expected)
+{
+    Memory_Arena arena = {};
+    
+    AST_Traversal traversal          = FlattenSyntaxTree(tree, &arena);
+    AST_Traversal expected_traversal = FlattenSyntaxTree(expected, &arena);
+    
+    if (Check(traversal.node_count == expected_traversal.node_count))
+    {
+        U32 mismatch_count = 0;
+        
+        for (U32 i = 0; i < traversal.node_count; ++i)
+        {
+            Node_Index node          = traversal.pre_order[i];
+            Node_Index expected_node = expected_traversal.pre_order[i];
+            
+            mismatch_count += (NodeKind(tree, node) != NodeKind(expected, expected_node));
+            mismatch_count += (tree->main_tokens.data[node] != expected->main_tokens.data[expected_node]);
+            mismatch_count += (traversal.subtree_sizes[i] != expected_traversal.subtree_sizes[i]);
+            
+            if (NodeKind(tree, node) == ASTNode_LazyBlock)
+            {
+                mismatch_count += (NodeData(tree, node)->lhs != NodeData(expected, expected_node)->lhs);
+            }
+        }
+        
+        Check(mismatch_count == 0);
+    }
+    
+    ClearArena(&arena);
+}
+
+// NOTE(soimn): Parses the bodies of every function definition at the top level
+inline void
+ParseAllFunctionBodies(Syntax_Tree* tree, Diagnostics_Engine* diagnostics)
+{
+    Parser parser = ParserState(tree, diagnostics, PARSER_DEFAULT_MAX_ERRORS);
+    
+    AST_Range declarations = NodeChildren(tree, 0);
+    
+    for (U32 i = declarations.start; i < declarations.end; ++i)
+    {
+        Node_Index declaration = tree->extra_data.data[i];
+        if (NodeKind(tree, declaration) == ASTNode_FunctionDef) ParseFunctionBody(&parser, declaration);
+    }
+    
+    FreeParserState(&parser);
+}
+
+inline bool
+IndicesAre(U32* indices, U32 count, U32* expected, U32 expected_count)
+{
+    bool result = (count == expected_count);
+    
+    for (U32 i = 0; result && i < count; ++i) result = (indices[i] == expected[i]);
+    
+    return result;
+}
+
+// NOTE(soimn): Reparses after an edit that changes, inserts, deletes and duplicates declarations, and checks the
+//              tree against a fresh parse of the new tokens, and the lists of changes against the declarations
+//              that were touched. The old tree has two identical prototypes that both survive the edit.
+inline void
+TestReparse(bool lazy_function_bodies)
+{
+    const char* old_source[] = {
+        "int a = 1;",
+        "int f(int x) { return x + a; }",
+        "int f(int x);",
+        "int f(int x);",
+        "int g(int y) { int z = y * 2; return z; }",
+        "struct S { int m; };",
+        "int e = 1 + ;",
+    };
+    
+    const char* new_source[] = {
+        "int a = 1;",
+        "int f(int x) { return x + a; }",
+        "int h;",
+        "int f(int x);",
+        "int f(int x);",
+        "int g(int y) { int z = y * 3; return z; }",
+        "int e = 1 + ;",
+        "int a = 1;",
+    };
+    
+    Memory_Arena arena = {};
+    
+    Diagnostics_Engine diagnostics = DiagnosticsEngine();
+    
+    Incremental_Tree tree = ParseIncremental(TokenizeDeclarations(old_source, ARRAY_COUNT(old_source), &diagnostics, &arena),
+                                             &diagnostics, PARSER_DEFAULT_MAX_ERRORS, lazy_function_bodies);
+    
+    Check(diagnostics.error_count == 1);
+    Check(tree.declarations.count == ARRAY_COUNT(old_source));
+    
+    // NOTE(soimn): The duplicated prototypes are reused in order, the second 'int a = 1;' is new, since the first
+    //              one is already taken, and the broken declaration is parsed again
+    {
+        Reparse_Changes changes = {};
+        
+        ReparseIncremental(&tree, TokenizeDeclarations(new_source, ARRAY_COUNT(new_source), &diagnostics, &arena),
+                           &diagnostics, &arena, &changes, PARSER_DEFAULT_MAX_ERRORS, lazy_function_bodies);
+        
+        U32 expected_changed[] = {2, 5, 6, 7};
+        U32 expected_removed[] = {4, 5, 6};
+        
+        Check(IndicesAre(changes.changed, changes.changed_count, expected_changed, ARRAY_COUNT(expected_changed)));
+        Check(IndicesAre(changes.removed, changes.removed_count, expected_removed, ARRAY_COUNT(expected_removed)));
+    }
+    
+    Syntax_Tree fresh = ParseTokens(TokenizeDeclarations(new_source, ARRAY_COUNT(new_source), &diagnostics, &arena),
+                                    &diagnostics, PARSER_DEFAULT_MAX_ERRORS, lazy_function_bodies);
+    
+    CheckTreesMatch(&tree.tree, &fresh);
+    
+    // NOTE(soimn): The same source again only parses the broken declaration
+    {
+        Reparse_Changes changes = {};
+        
+        ReparseIncremental(&tree, TokenizeDeclarations(new_source, ARRAY_COUNT(new_source), &diagnostics, &arena),
+                           &diagnostics, &arena, &changes, PARSER_DEFAULT_MAX_ERRORS, lazy_function_bodies);
+        
+        U32 expected_changed[] = {6};
+        U32 expected_removed[] = {6};
+        
+        Check(IndicesAre(changes.changed, changes.changed_count, expected_changed, ARRAY_COUNT(expected_changed)));
+        Check(IndicesAre(changes.removed, changes.removed_count, expected_removed, ARRAY_COUNT(expected_removed)));
+    }
+    
+    CheckTreesMatch(&tree.tree, &fresh);
+    
+    // NOTE(soimn): Lazy bodies that were copied from the old tree parse to the same nodes as fresh ones
+    if (lazy_function_bodies)
+    {
+        U32 error_count = diagnostics.error_count;
+        
+        ParseAllFunctionBodies(&tree.tree, &diagnostics);
+        ParseAllFunctionBodies(&fresh, &diagnostics);
+        
+        Check(diagnostics.error_count == error_count);
+        
+        CheckTreesMatch(&tree.tree, &fresh);
+    }
+    
+    FreeSyntaxTree(&fresh);
+    FreeIncrementalTree(&tree);
+    ClearArena(&diagnostics.arena);
+    ClearArena(&arena);
+}
+
+inline void
+TestIncremental()
+{
+    TestReparse(false);
+    TestReparse(true);
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+#define TEST_MODULE_FILES 6
+#define TEST_MODULE_DECLARATIONS 3000
+#define TEST_MODULE_WORKERS 4
+
+// NOTE(soimn): ParseFiles on several workers produces the same trees as parsing every file on its own does, in the
+//              order the files were given. One of the files has a syntax error in the middle, so the diagnostics have
+//              to come out the same as well.
+inline void
+TestModuleTrees()
+{
+    Memory_Arena arena = {};
+    
+    U64 random = 0x9E3779B97F4A7C15ULL;
+    const char** paths = GenerateFiles(&arena, &random, TEST_MODULE_FILES, TEST_MODULE_DECLARATIONS, "gnom_test_module_");
+    
+    // NOTE(soimn): A broken declaration is inserted between two declarations in the middle of the last file
+    {
+        String contents = {};
+        bool is_read    = ReadEntireFile(paths[TEST_MODULE_FILES - 1], &arena, &contents);
+        
+        UMM middle = contents.size / 2;
+        while (middle + 1 < contents.size && !(contents.data[middle] == '\n' && contents.data[middle + 1] == '\n')) ++middle;
+        
+        String broken = CONST_STRING("\nint broken = 1 + ;\n");
+        String edited = {(U8*)PushSize(&arena, contents.size + broken.size), contents.size + broken.size};
+        
+        Copy(contents.data, edited.data, middle);
+        Copy(broken.data, edited.data + middle, broken.size);
+        Copy(contents.data + middle, edited.data + middle + broken.size, contents.size - middle);
+        
+        Check(is_read && WriteEntireFile(paths[TEST_MODULE_FILES - 1], edited.data, edited.size));
+    }
+    
+    StartJobSystem(&JobSystem, TEST_MODULE_WORKERS);
+    
+    Diagnostics_Engine diagnostics = DiagnosticsEngine();
+    Module module = ParseFiles(&JobSystem.workers[0], paths, TEST_MODULE_FILES, &diagnostics);
+    
+    Diagnostics_Engine sequential_diagnostics = DiagnosticsEngine();
+    
+    for (U32 i = 0; i < TEST_MODULE_FILES; ++i)
+    {
+        Source_File* file = &module.files[i];
+        
+        String contents = {};
+        ReadEntireFile(paths[i], &arena, &contents);
+        
+        String_Stream stream = StringStream(&arena);
+        Append(&stream, contents);
+        
+        SetDiagnosticsFileName(&sequential_diagnostics, file->id, String{(U8*)paths[i], StringLength(paths[i])});
+        
+        Syntax_Tree tree = ParseStringStream(stream, file->id, &sequential_diagnostics);
+        
+        if (Check(file->is_loaded) && Check(NodeCount(&file->tree) == NodeCount(&tree)) &&
+            Check(file->tree.extra_data.count == tree.extra_data.count))
+        {
+            for (U32 j = 0; j < NodeCount(&tree); ++j)
+            {
+                bool is_equal = (NodeKind(&file->tree, j) == NodeKind(&tree, j) &&
+                                 file->tree.main_tokens.data[j] == tree.main_tokens.data[j]);
+                
+                if (!Check(is_equal)) break;
+            }
+        }
+        
+        FreeSyntaxTree(&tree);
+    }
+    
+    String_Stream emitted            = StringStream(&arena);
+    String_Stream sequential_emitted = StringStream(&arena);
+    EmitDiagnostics(&diagnostics, &emitted);
+    EmitDiagnostics(&sequential_diagnostics, &sequential_emitted);
+    
+    String emitted_text            = Linearize(WholeStream(&emitted), &arena);
+    String sequential_emitted_text = Linearize(WholeStream(&sequential_emitted), &arena);
+    
+    Check(diagnostics.error_count == 1 && sequential_diagnostics.error_count == 1);
+    Check(StringCompare(emitted_text, sequential_emitted_text));
+    
+    FreeModule(&module);
+    StopJobSystem(&JobSystem);
+    
+    DeleteFiles(paths, TEST_MODULE_FILES);
+    
+    ClearArena(&sequential_diagnostics.arena);
+    ClearArena(&diagnostics.arena);
+    ClearArena(&arena);
+}
+
+// NOTE(soimn): The error limit of the parser applies to each run of declarations, so errors after a run that hit the
+//              limit are still reported by ParseFiles, while ParseTokens gives up on the rest of the file
+inline void
+TestModuleErrorLimit()
+{
+    Memory_Arena arena = {};
+    
+    const char* path = "gnom_test_module_errors.gn";
+    
+    String_Stream stream = StringStream(&arena);
+    
+    for (U32 i = 0; i < 40; ++i) Print(&stream, "int broken_%u = 1 + ;\n", i);
+    
+    U64 random = 0x9E3779B97F4A7C15ULL;
+    GenerateSource(&stream, &random, 2000);
+    
+    for (U32 i = 40; i < 43; ++i) Print(&stream, "int broken_%u = 1 + ;\n", i);
+    
+    String contents = Linearize(WholeStream(&stream), &arena);
+    Check(WriteEntireFile(path, contents.data, contents.size));
+    
+    StartJobSystem(&JobSystem, TEST_MODULE_WORKERS);
+    
+    Diagnostics_Engine diagnostics = DiagnosticsEngine();
+    Module module = ParseFiles(&JobSystem.workers[0], &path, 1, &diagnostics);
+    
+    Diagnostics_Engine sequential_diagnostics = DiagnosticsEngine();
+    Syntax_Tree tree = ParseStringStream(stream, 1, &sequential_diagnostics);
+    
+    // NOTE(soimn): The limit, the diagnostic for hitting it, and the errors of the last run
+    Check(diagnostics.error_count == PARSER_DEFAULT_MAX_ERRORS + 1 + 3);
+    Check(sequential_diagnostics.error_count == PARSER_DEFAULT_MAX_ERRORS + 1);
+    
+    FreeSyntaxTree(&tree);
+    FreeModule(&module);
+    StopJobSystem(&JobSystem);
+    
+    DeleteFiles(&path, 1);
+    
+    ClearArena(&sequential_diagnostics.arena);
+    ClearArena(&diagnostics.arena);
+    ClearArena(&arena);
+}
+
+// NOTE(soimn): With use_ast_cache, the second ParseFiles of unchanged files loads the same trees from the cache
+inline void
+TestModuleCache()
+{
+    Memory_Arena arena = {};
+    
+    U64 random = 0xBB67AE8584CAA73BULL;
+    const char** paths = GenerateFiles(&arena, &random, TEST_MODULE_FILES, TEST_MODULE_DECLARATIONS, "gnom_test_module_cache_");
+    
+    StartJobSystem(&JobSystem, TEST_MODULE_WORKERS);
+    
+    Diagnostics_Engine diagnostics = DiagnosticsEngine();
+    Module parsed = ParseFiles(&JobSystem.workers[0], paths, TEST_MODULE_FILES, &diagnostics, true, true);
+    Module cached = ParseFiles(&JobSystem.workers[0], paths, TEST_MODULE_FILES, &diagnostics, true, true);
+    
+    Check(diagnostics.error_count == 0);
+    
+    for (U32 i = 0; i < TEST_MODULE_FILES; ++i)
+    {
+        Syntax_Tree* parsed_tree = &parsed.files[i].tree;
+        Syntax_Tree* cached_tree = &cached.files[i].tree;
+        
+        Check(!parsed.files[i].is_cached && cached.files[i].is_cached);
+        
+        // NOTE(soimn): The cached trees are parsed in full, since lazy bodies could not be parsed from the cache
+        bool is_equal = (NodeCount(parsed_tree) == NodeCount(cached_tree) &&
+                         parsed_tree->extra_data.count == cached_tree->extra_data.count &&
+                         MemoryEquals(parsed_tree->kinds.data, cached_tree->kinds.data, NodeCount(parsed_tree)) &&
+                         MemoryEquals(parsed_tree->data.data, cached_tree->data.data, NodeCount(parsed_tree) * sizeof(AST_Node_Data)));
+        
+        Check(is_equal);
+        
+        for (U32 j = 0; j < NodeCount(parsed_tree); ++j)
+        {
+            if (!Check(NodeKind(parsed_tree, j) != ASTNode_LazyBlock)) break;
+        }
+    }
+    
+    FreeModule(&cached);
+    FreeModule(&parsed);
+    StopJobSystem(&JobSystem);
+    
+    for (U32 i = 0; i < TEST_MODULE_FILES; ++i)
+    {
+        DeleteFileA(ASTCachePath(paths[i], &arena));
+    }
+    
+    DeleteFiles(paths, TEST_MODULE_FILES);
+    
+    ClearArena(&diagnostics.arena);
+    ClearArena(&arena);
+}
+
+inline void
+TestModule()
+{
+    TestModuleTrees();
+    TestModuleErrorLimit();
+    TestModuleCache();
+}
+
+#define BENCH_MODULE_FILES 64
+#define BENCH_MODULE_DECLARATIONS 2000
+#define BENCH_MODULE_LARGE_FILE_DECLARATIONS 100000
+
+// NOTE(soimn): ParseFiles on 1, 2, 4, ... workers up to the number of processors, on many files and on a single
+//              large one, which is only spread over the workers by splitting it into runs of declarations. The
+//              speedup is relative to a single worker.
+inline void
+BenchModule()
+{
+    Memory_Arena arena = {};
+    
+    U64 random = 0x9E3779B97F4A7C15ULL;
+    const char** paths      = GenerateFiles(&arena, &random, BENCH_MODULE_FILES, BENCH_MODULE_DECLARATIONS, "gnom_bench_module_");
+    const char** large_path = GenerateFiles(&arena, &random, 1, BENCH_MODULE_LARGE_FILE_DECLARATIONS, "gnom_bench_module_large_");
+    
+    const char** inputs[2]  = {paths, large_path};
+    U32 input_counts[2]     = {BENCH_MODULE_FILES, 1};
+    const char* input_names[2] = {"files", "large file"};
+    
+    U32 processor_count = ProcessorCount();
+    
+    for (U32 input = 0; input < 2; ++input)
+    {
+        F64 single_seconds = 0;
+        
+        for (U32 worker_count = 1;; worker_count = MIN(worker_count * 2, processor_count))
+        {
+            StartJobSystem(&JobSystem, worker_count);
+            
+            Diagnostics_Engine diagnostics = DiagnosticsEngine();
+            
+            U64 start = ReadTimer();
+            Module module = ParseFiles(&JobSystem.workers[0], inputs[input], input_counts[input], &diagnostics);
+            F64 seconds = SecondsSince(start);
+            
+            Check(diagnostics.error_count == 0);
+            
+            FreeModule(&module);
+            StopJobSystem(&JobSystem);
+            ClearArena(&diagnostics.arena);
+            
+            if (worker_count == 1) single_seconds = seconds;
+            
+            Print(PrintStream, "    ParseFiles %s, %u workers: %F ms, %Fx\n", input_names[input], worker_count,
+                  RoundTiming(seconds * 1e3), RoundTiming(single_seconds / MAX(seconds, 1e-9)));
+            
+            if (worker_count == processor_count) break;
+        }
+    }
+    
+    DeleteFiles(paths, BENCH_MODULE_FILES);
+    DeleteFiles(large_path, 1);
+    
+    ClearArena(&arena);
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+#define TEST_CHECKER_FILES 4
+#define TEST_CHECKER_DECLARATIONS 2000
+#define TEST_CHECKER_WORKERS 4
+
+// NOTE(soimn): Parses and checks the files like the compiler does, and returns the number of errors
+inline U32
+CheckFiles(const char** paths, U32 path_count, bool lazy_function_bodies)
+{
+    Diagnostics_Engine diagnostics = DiagnosticsEngine();
+    
+    Module module = ParseFiles(&JobSystem.workers[0], paths, path_count, &diagnostics, lazy_function_bodies);
+    
+    Atom_Table atoms = AtomTable();
+    Checker checker  = CheckModule(&JobSystem.workers[0], &module, &atoms, &diagnostics);
+    
+    U32 result = diagnostics.error_count;
+    
+    FreeChecker(&checker);
+    FreeAtomTable(&atoms);
+    FreeModule(&module);
+    ClearArena(&diagnostics.arena);
+    
+    return result;
+}
+
+// NOTE(soimn): Function bodies are checked the same with and without lazy_function_bodies, and lazy bodies with
+//              syntax errors are reported when the checker parses them
+inline void
+TestCheckBodies()
+{
+    Memory_Arena arena = {};
+    
+    U64 random = 0x6A09E667F3BCC909ULL;
+    const char** paths = GenerateFiles(&arena, &random, TEST_CHECKER_FILES, TEST_CHECKER_DECLARATIONS, "gnom_test_checker_");
+    
+    const char* broken_path = "gnom_test_checker_broken.gn";
+    String broken = CONST_STRING("int g;\n"
+                                 "int f(int a) { int x = a + g + y; for (int i = 0; i < 3; i += 1) x = x + i; return i + x; }\n"
+                                 "int h(int a) { return a + ; }\n"
+                                 "int k(int a) { return f(a) + h(a) + missing; }\n");
+    
+    Check(WriteEntireFile(broken_path, broken.data, broken.size));
+    
+    StartJobSystem(&JobSystem, TEST_CHECKER_WORKERS);
+    
+    Check(CheckFiles(paths, TEST_CHECKER_FILES, false) == 0);
+    Check(CheckFiles(paths, TEST_CHECKER_FILES, true) == 0);
+    
+    // NOTE(soimn): 'y', 'i' and 'missing' are not declared, and the syntax error in h is only found by the checker
+    Check(CheckFiles(&broken_path, 1, true) == 4);
+    
+    StopJobSystem(&JobSystem);
+    
+    DeleteFiles(paths, TEST_CHECKER_FILES);
+    DeleteFiles(&broken_path, 1);
+    
+    ClearArena(&arena);
+}
+
+// NOTE(soimn): Forward references, cycles of one and of three variables, a cycle of structs holding each other by
+//              value, a struct that refers to itself through a pointer, which is not a cycle, and a variable that
+//              depends on a cycle. Every cycle is reported once per member, and every job is resolved after the
+//              jobs it refers to, apart from the references that break a cycle.
+inline void
+TestCheckOrder(U32 worker_count)
+{
+    Memory_Arena arena = {};
+    
+    const char* path = "gnom_test_checker_order.gn";
+    String source = CONST_STRING("int a = b;\n"
+                                 "int b = c;\n"
+                                 "int c = 3;\n"
+                                 "int x = y;\n"
+                                 "int y = z;\n"
+                                 "int z = x;\n"
+                                 "int s = s + 1;\n"
+                                 "struct P { P* next; int value; };\n"
+                                 "struct A { B b; };\n"
+                                 "struct B { A a; };\n"
+                                 "int d = x + c;\n");
+    
+    Check(WriteEntireFile(path, source.data, source.size));
+    
+    StartJobSystem(&JobSystem, worker_count);
+    
+    Diagnostics_Engine diagnostics = DiagnosticsEngine();
+    
+    Module module    = ParseFiles(&JobSystem.workers[0], &path, 1, &diagnostics, true);
+    Atom_Table atoms = AtomTable();
+    Checker checker  = CheckModule(&JobSystem.workers[0], &module, &atoms, &diagnostics);
+    
+    StopJobSystem(&JobSystem);
+    
+    String_Stream emitted = StringStream(&arena);
+    EmitDiagnostics(&diagnostics, &emitted);
+    
+    String expected = CONST_STRING("[ERROR] gnom_test_checker_order.gn:4:5: 'x' depends on itself through 'y'\n"
+                                   "[ERROR] gnom_test_checker_order.gn:5:5: 'y' depends on itself through 'z'\n"
+                                   "[ERROR] gnom_test_checker_order.gn:6:5: 'z' depends on itself through 'x'\n"
+                                   "[ERROR] gnom_test_checker_order.gn:7:5: 's' depends on itself\n"
+                                   "[ERROR] gnom_test_checker_order.gn:9:8: 'A' depends on itself through 'B'\n"
+                                   "[ERROR] gnom_test_checker_order.gn:10:8: 'B' depends on itself through 'A'\n");
+    
+    Check(StringCompare(Linearize(WholeStream(&emitted), &arena), expected));
+    
+    U32* positions = PushArray(&arena, U32, MAX(checker.job_count, 1));
+    
+    if (Check(checker.job_count == 11) && Check(checker.resolved_count == checker.job_count))
+    {
+        for (U32 i = 0; i < checker.resolved_count; ++i) positions[checker.order[i]] = i;
+        
+        U32 misplaced_count = 0;
+        
+        for (U32 i = 0; i < checker.job_count; ++i)
+        {
+            Check_Job* job = &checker.jobs[i];
+            
+            for (U32 j = 0; j < job->reference_count; ++j)
+            {
+                U32 target = job->references[j].target;
+                
+                bool is_breaking = (target == i || (job->is_cyclic && checker.jobs[target].is_cyclic));
+                
+                misplaced_count += (!is_breaking && positions[target] >= positions[i]);
+            }
+        }
+        
+        Check(misplaced_count == 0);
+        
+        // NOTE(soimn): The forward chain resolves backwards, and the pointer to P does not make P cyclic
+        Check(positions[2] < positions[1] && positions[1] < positions[0]);
+        Check(!checker.jobs[7].is_cyclic && !checker.jobs[10].is_cyclic);
+        Check(checker.jobs[3].is_cyclic && checker.jobs[6].is_cyclic && checker.jobs[8].is_cyclic);
+    }
+    
+    FreeChecker(&checker);
+    FreeAtomTable(&atoms);
+    FreeModule(&module);
+    ClearArena(&diagnostics.arena);
+    
+    DeleteFiles(&path, 1);
+    
+    ClearArena(&arena);
+}
+
+inline void
+TestChecker()
+{
+    TestCheckBodies();
+    TestCheckOrder(1);
+    TestCheckOrder(TEST_CHECKER_WORKERS);
+}
+
+#define BENCH_CHECKER_FILES 64
+#define BENCH_CHECKER_DECLARATIONS 2000
+
+// NOTE(soimn): Checks the same module, parsed with lazy function bodies like the compiler does, on 1, 2, 4, ...
+//              workers up to one per processor. Only CheckModule is timed, and the speedup is against 1 worker.
+inline void
+BenchChecker()
+{
+    Memory_Arena arena = {};
+    
+    U64 random = 0x510E527FADE682D1ULL;
+    const char** paths = GenerateFiles(&arena, &random, BENCH_CHECKER_FILES, BENCH_CHECKER_DECLARATIONS, "gnom_bench_checker_");
+    
+    U32 processor_count = ProcessorCount();
+    F64 single_seconds  = 0;
+    
+    for (U32 worker_count = 1;; worker_count = MIN(worker_count * 2, processor_count))
+    {
+        StartJobSystem(&JobSystem, worker_count);
+        
+        Diagnostics_Engine diagnostics = DiagnosticsEngine();
+        
+        Module module    = ParseFiles(&JobSystem.workers[0], paths, BENCH_CHECKER_FILES, &diagnostics, true);
+        Atom_Table atoms = AtomTable();
+        
+        U64 start       = ReadTimer();
+        Checker checker = CheckModule(&JobSystem.workers[0], &module, &atoms, &diagnostics);
+        F64 seconds     = SecondsSince(start);
+        
+        Check(diagnostics.error_count == 0);
+        
+        FreeChecker(&checker);
+        FreeAtomTable(&atoms);
+        FreeModule(&module);
+        StopJobSystem(&JobSystem);
+        ClearArena(&diagnostics.arena);
+        
+        if (worker_count == 1) single_seconds = seconds;
+        
+        Print(PrintStream, "    CheckModule, %u workers: %F ms, %Fx\n", worker_count,
+              RoundTiming(seconds * 1e3), RoundTiming(single_seconds / MAX(seconds, 1e-9)));
+        
+        if (worker_count == processor_count) break;
+    }
+    
+    DeleteFiles(paths, BENCH_CHECKER_FILES);
+    
+    ClearArena(&arena);
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+#define TEST_SYMBOLS_OPERATIONS 200000
+#define TEST_SYMBOLS_NAME_RANGE 512
+#define TEST_SYMBOLS_MAX_DEPTH 16
+
+// NOTE(soimn): The symbol bound to the name by the entries in [start, end), latest first, or SYMBOL_NONE
+inline U32
+ScanEntries(Scope_Entry* entries, U32 start, U32 end, Atom name)
+{
+    U32 result = SYMBOL_NONE;
+    
+    for (U32 i = end; i > start; --i)
+    {
+        if (entries[i - 1].name == name)
+        {
+            result = entries[i - 1].symbol;
+            break;
+        }
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Random declarations, lookups and scope changes, checked against a backward scan of every name
+//              declared so far. Scopes are open for around fifty declarations, so many of them grow past
+//              SYMBOL_SCOPE_INDEX_THRESHOLD and are looked up through their index.
+inline void
+TestSymbolTable()
+{
+    Memory_Arena arena = {};
+    
+    Scope_Entry* entries = PushArray(&arena, Scope_Entry, TEST_SYMBOLS_OPERATIONS);
+    U32 entry_count      = 0;
+    
+    // NOTE(soimn): Level 0 is the global scope, which is never closed
+    U32 scope_starts[TEST_SYMBOLS_MAX_DEPTH + 1] = {};
+    U32 depth       = 0;
+    U32 next_symbol = 1;
+    
+    Symbol_Table table = SymbolTable();
+    
+    U64 random = 0xBB67AE8584CAA73BULL;
+    
+    for (U32 i = 0; i < TEST_SYMBOLS_OPERATIONS; ++i)
+    {
+        U32 operation = RandomU32(&random, 100);
+        Atom name     = 1 + RandomU32(&random, TEST_SYMBOLS_NAME_RANGE);
+        
+        if (operation < 2 && depth < TEST_SYMBOLS_MAX_DEPTH)
+        {
+            PushScope(&table);
+            scope_starts[++depth] = entry_count;
+        }
+        
+        else if (operation < 3 && depth != 0)
+        {
+            PopScope(&table);
+            entry_count = scope_starts[depth--];
+        }
+        
+        else if (operation < 50)
+        {
+            U32 expected = ScanEntries(entries, scope_starts[depth], entry_count, name);
+            
+            if (expected == SYMBOL_NONE)
+            {
+                expected               = next_symbol++;
+                entries[entry_count++] = {name, expected};
+            }
+            
+            Check(DeclareSymbol(&table, Symbol{name, i, Symbol_Variable}) == expected);
+        }
+        
+        else
+        {
+            Check(LookupSymbol(&table, name) == ScanEntries(entries, 0, entry_count, name));
+            Check(LookupInCurrentScope(&table, name) == ScanEntries(entries, scope_starts[depth], entry_count, name));
+        }
+    }
+    
+    FreeSymbolTable(&table);
+    ClearArena(&arena);
+}
+
+#define TEST_ATOM_CACHE_NAMES 20000
+#define TEST_ATOM_CACHE_ROUNDS 4
+#define TEST_ATOM_CACHE_WORKERS 4
+
+struct Atom_Cache_Test
+{
+    String* names;
+    Atom_Cache* caches;
+    Atom* atoms;
+};
+
+inline void
+InternNamesJob(Job_Worker* worker, void* data, UMM start, UMM end)
+{
+    Atom_Cache_Test* test = (Atom_Cache_Test*)data;
+    
+    for (UMM i = start; i < end; ++i)
+    {
+        test->atoms[i] = Intern(&test->caches[worker->index], test->names[i % TEST_ATOM_CACHE_NAMES]);
+    }
+}
+
+// NOTE(soimn): Every name is interned several times on every worker, through the cache of the worker, and gets
+//              the same atom everywhere, which is the one the table gives it
+inline void
+TestAtomCaches()
+{
+    Memory_Arena arena = {};
+    
+    Atom_Table table = AtomTable();
+    
+    Atom_Cache_Test test = {};
+    test.names  = GenerateNames(&arena, TEST_ATOM_CACHE_NAMES, "name_");
+    test.caches = PushArray(&arena, Atom_Cache, JOB_SYSTEM_MAX_WORKERS);
+    test.atoms  = PushArray(&arena, Atom, TEST_ATOM_CACHE_NAMES * TEST_ATOM_CACHE_ROUNDS);
+    
+    for (U32 i = 0; i < JOB_SYSTEM_MAX_WORKERS; ++i) test.caches[i] = AtomCache(&table);
+    
+    StartJobSystem(&JobSystem, TEST_ATOM_CACHE_WORKERS);
+    ParallelFor(&JobSystem.workers[0], TEST_ATOM_CACHE_NAMES * TEST_ATOM_CACHE_ROUNDS, 64, InternNamesJob, &test);
+    StopJobSystem(&JobSystem);
+    
+    Check(table.strings.count == TEST_ATOM_CACHE_NAMES + 1);
+    
+    U32 mismatch_count = 0;
+    
+    for (U32 i = 0; i < TEST_ATOM_CACHE_NAMES * TEST_ATOM_CACHE_ROUNDS; ++i)
+    {
+        String name = test.names[i % TEST_ATOM_CACHE_NAMES];
+        
+        mismatch_count += (test.atoms[i] != Intern(&table, name));
+        mismatch_count += !StringCompare(AtomString(&table, test.atoms[i]), name);
+    }
+    
+    Check(mismatch_count == 0);
+    
+    for (U32 i = 0; i < JOB_SYSTEM_MAX_WORKERS; ++i) FreeAtomCache(&test.caches[i]);
+    
+    FreeAtomTable(&table);
+    ClearArena(&arena);
+}
+
+inline void
+TestSymbols()
+{
+    TestSymbolTable();
+    TestAtomCaches();
+}
+
+#define BENCH_SYMBOLS_GLOBALS 200000
+#define BENCH_SYMBOLS_DEPTH 2000
+#define BENCH_SYMBOLS_LOCALS 100000
+#define BENCH_SYMBOLS_LOOKUPS 2000000
+
+// NOTE(soimn): Times a lookup of every query, and returns how many of them were found
+inline U64
+TimeLookups(const char* name, Symbol_Table* table, Atom* queries, U32 query_count)
+{
+    U64 result = 0;
+    U64 start  = ReadTimer();
+    
+    for (U32 i = 0; i < query_count; ++i)
+    {
+        result += (LookupSymbol(table, queries[i]) != SYMBOL_NONE);
+    }
+    
+    ReportBenchmark(name, SecondsSince(start), query_count);
+    
+    return result;
+}
+
+// NOTE(soimn): The shapes that are slow for a scope stack: a large global namespace, names looked up from under
+//              thousands of nested scopes, and a single local scope with as many names as a generated function.
+//              Lookups in a scope of SYMBOL_SCOPE_INDEX_THRESHOLD names, which is scanned, and in one of
+//              BENCH_SYMBOLS_LOCALS names, which is indexed, should cost about the same.
+inline void
+BenchSymbols()
+{
+    Memory_Arena arena = {};
+    
+    Atom* queries = PushArray(&arena, Atom, BENCH_SYMBOLS_LOOKUPS);
+    U64 random    = 0x3C6EF372FE94F82BULL;
+    U64 hits      = 0;
+    
+    Symbol_Table table = SymbolTable();
+    
+    U64 start = ReadTimer();
+    
+    for (U32 i = 0; i < BENCH_SYMBOLS_GLOBALS; ++i) DeclareSymbol(&table, Symbol{1 + i, i, Symbol_Variable});
+    
+    ReportBenchmark("declare globals", SecondsSince(start), BENCH_SYMBOLS_GLOBALS);
+    
+    for (U32 i = 0; i < BENCH_SYMBOLS_LOOKUPS; ++i) queries[i] = 1 + RandomU32(&random, BENCH_SYMBOLS_GLOBALS);
+    
+    hits += TimeLookups("lookup globals", &table, queries, BENCH_SYMBOLS_LOOKUPS);
+    
+    // NOTE(soimn): Every nested scope declares four names of its own, so a lookup of a global tests the mask of
+    //              every scope on the way out, and scans the one in sixteen that may hold the name
+    start = ReadTimer();
+    
+    for (U32 i = 0; i < BENCH_SYMBOLS_DEPTH; ++i)
+    {
+        PushScope(&table);
+        for (U32 j = 0; j < 4; ++j) DeclareSymbol(&table, Symbol{BENCH_SYMBOLS_GLOBALS + 1 + 4 * i + j, i, Symbol_Variable});
+    }
+    
+    ReportBenchmark("open nested scopes", SecondsSince(start), BENCH_SYMBOLS_DEPTH);
+    
+    hits += TimeLookups("lookup globals from a nested scope", &table, queries, BENCH_SYMBOLS_LOOKUPS / 100);
+    
+    for (U32 i = 0; i < BENCH_SYMBOLS_DEPTH; ++i) PopScope(&table);
+    
+    PushScope(&table);
+    
+    for (U32 i = 0; i < SYMBOL_SCOPE_INDEX_THRESHOLD; ++i) DeclareSymbol(&table, Symbol{BENCH_SYMBOLS_GLOBALS + 1 + i, i, Symbol_Variable});
+    for (U32 i = 0; i < BENCH_SYMBOLS_LOOKUPS; ++i) queries[i] = BENCH_SYMBOLS_GLOBALS + 1 + RandomU32(&random, SYMBOL_SCOPE_INDEX_THRESHOLD);
+    
+    hits += TimeLookups("lookup in a small scope", &table, queries, BENCH_SYMBOLS_LOOKUPS);
+    
+    PopScope(&table);
+    PushScope(&table);
+    
+    start = ReadTimer();
+    
+    for (U32 i = 0; i < BENCH_SYMBOLS_LOCALS; ++i) DeclareSymbol(&table, Symbol{BENCH_SYMBOLS_GLOBALS + 1 + i, i, Symbol_Variable});
+    
+    ReportBenchmark("declare locals", SecondsSince(start), BENCH_SYMBOLS_LOCALS);
+    
+    for (U32 i = 0; i < BENCH_SYMBOLS_LOOKUPS; ++i) queries[i] = BENCH_SYMBOLS_GLOBALS + 1 + RandomU32(&random, BENCH_SYMBOLS_LOCALS);
+    
+    hits += TimeLookups("lookup in a large scope", &table, queries, BENCH_SYMBOLS_LOOKUPS);
+    
+    PopScope(&table);
+    
+    BenchmarkSink = hits;
+    
+    FreeSymbolTable(&table);
+    ClearArena(&arena);
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+typedef void (*Test_Proc)();
+
+struct Test
+{
+    const char* name;
+    Test_Proc proc;
+};
+
+global Test Tests[] = {
+    {"hash_map", TestHashMap},
+    {"integer_format", TestIntegerFormat},
+    {"float_format", TestFloatFormat},
+    {"strings", TestStrings},
+    {"jobs", TestJobs},
+    {"parser", TestParser},
+    {"incremental", TestIncremental},
+    {"module", TestModule},
+    {"checker", TestChecker},
+    {"symbols", TestSymbols},
+};
+
+global Test Benchmarks[] = {
+    {"hash_map", BenchHashMap},
+    {"integer_format", BenchIntegerFormat},
+    {"float_format", BenchFloatFormat},
+    {"strings", BenchStrings},
+    {"parser", BenchParser},
+    {"module", BenchModule},
+    {"checker", BenchChecker},
+    {"symbols", BenchSymbols},
+};
+
+inline bool
+CStringsAreEqual(const char* a, const char* b)
+{
+    return StringCompare(String{(U8*)a, StringLength(a)}, String{(U8*)b, StringLength(b)});
+}
+
+int
+main(int argc, const char** argv)
+{
+    ErrorStreamObject = OutputStream(&OutputStreamArena, GetStdHandle(STD_ERROR_HANDLE), OUTPUT_STREAM_FLUSH_THRESHOLD);
+    ErrorStream = &ErrorStreamObject;
+    
+    PrintStreamObject = OutputStream(&OutputStreamArena, GetStdHandle(STD_OUTPUT_HANDLE), OUTPUT_STREAM_FLUSH_THRESHOLD);
+    PrintStream = &PrintStreamObject;
+    
+    int result = 0;
+    
+    bool run_benchmarks = (argc > 1 && CStringsAreEqual(argv[1], "bench"));
+    const char* filter  = (argc > 1 + run_benchmarks ? argv[1 + run_benchmarks] : 0);
+    
+    Test* tests      = (run_benchmarks ? Benchmarks : Tests);
+    UMM test_count   = (run_benchmarks ? ARRAY_COUNT(Benchmarks) : ARRAY_COUNT(Tests));
+    U32 run_count    = 0;
+    U32 failed_count = 0;
+    
+    for (UMM i = 0; i < test_count; ++i)
+    {
+        if (!filter || CStringsAreEqual(filter, tests[i].name))
+        {
+            TestState = {};
+            TestState.name = tests[i].name;
+            
+            Print(PrintStream, "%s\n", tests[i].name);
+            Flush(PrintStream);
+            
+            tests[i].proc();
+            
+            if (!run_benchmarks)
+            {
+                Print(PrintStream, "    %u of %u checks passed\n", TestState.check_count - TestState.failure_count, TestState.check_count);
+            }
+            
+            Flush(ErrorStream);
+            Flush(PrintStream);
+            
+            ++run_count;
+            failed_count += (TestState.failure_count != 0);
+        }
+    }
+    
+    if (run_count == 0)
+    {
+        Print(ErrorStream, "Usage: %s [bench] [name]\n", argv[0]);
+        result = 1;
+    }
+    
+    else if (failed_count != 0)
+    {
+        Print(ErrorStream, "%u of %u tests failed\n", failed_count, run_count);
+        result = 1;
+    }
+    
+    Flush(PrintStream);
+    Flush(ErrorStream);
+    
+    return result;
+}
@@ -0,0 +1,406 @@
+#pragma once
+
+#include "common.h"
+#include "memory.h"
+#include "string.h"
+
+#include <emmintrin.h>
+
+// NOTE(soimn): Open addressing hash map in the style of Swiss tables. Every slot has a control byte, which
+//              is either HASH_MAP_EMPTY or the low 7 bits of the hash of the key in the slot. Lookups probe
+//              16 control bytes at a time with SSE2 and only compare keys on a 7 bit hash match.
+//
+//              Probing is linear at slot granularity, so deletion can shift the following entries back
+//              instead of leaving tombstones. The first HASH_MAP_GROUP_WIDTH - 1 control bytes are mirrored
+//              after the last one, so a group can be loaded at any slot without wrapping.
+//
+//              All memory comes from the arena. Growing abandons the old table in the arena, so reserve
+//              up front when the final size is known.
+
+#define HASH_MAP_GROUP_WIDTH 16
+#define HASH_MAP_EMPTY 0x80
+#define HASH_MAP_MIN_CAPACITY 16
+
+inline U64
+HashU64(U64 value)
+{
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDULL;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53ULL;
+    value ^= value >> 33;
+    
+    return value;
+}
+
+inline U64
+HashString(String string)
+{
+    U64 hash = 0x9E3779B97F4A7C15ULL ^ string.size;
+    
+    while (string.size >= 8)
+    {
+        hash ^= *(U64*)string.data;
+        hash *= 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 32;
+        
+        string.data += 8;
+        string.size -= 8;
+    }
+    
+    U64 tail = 0;
+    for (U8 i = 0; i < string.size; ++i)
+    {
+        tail |= (U64)string.data[i] << (i * 8);
+    }
+    
+    return HashU64(hash ^ tail);
+}
+
+inline U64
+HashKey(U32 key)
+{
+    return HashU64(key);
+}
+
+inline U64
+HashKey(U64 key)
+{
+    return HashU64(key);
+}
+
+inline U64
+HashKey(String key)
+{
+    return HashString(key);
+}
+
+template<typename T>
+inline U64
+HashKey(T* key)
+{
+    return HashU64((UMM)key);
+}
+
+inline bool
+KeysAreEqual(U32 k0, U32 k1)
+{
+    return (k0 == k1);
+}
+
+inline bool
+KeysAreEqual(U64 k0, U64 k1)
+{
+    return (k0 == k1);
+}
+
+inline bool
+KeysAreEqual(String k0, String k1)
+{
+    return (k0.size == k1.size && StringCompare(k0, k1));
+}
+
+template<typename T>
+inline bool
+KeysAreEqual(T* k0, T* k1)
+{
+    return (k0 == k1);
+}
+
+inline U32
+HashMapMatchMask(U8* control, U8 value)
+{
+    __m128i group = _mm_loadu_si128((__m128i*)control);
+    
+    return (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)value)));
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+template<typename K, typename V>
+struct Hash_Map_Slot
+{
+    K key;
+    V value;
+};
+
+template<typename K, typename V>
+struct Hash_Map
+{
+    Memory_Arena* arena;
+    
+    U8* control;
+    Hash_Map_Slot<K, V>* slots;
+    
+    U32 capacity;
+    U32 count;
+};
+
+template<typename K, typename V>
+inline void
+SetControl(Hash_Map<K, V>* map, U32 index, U8 value)
+{
+    map->control[index] = value;
+    
+    if (index < HASH_MAP_GROUP_WIDTH - 1)
+    {
+        map->control[map->capacity + index] = value;
+    }
+}
+
+// NOTE(soimn): Returns the first empty slot in the probe sequence of the hash. This is the insertion point,
+//              since linear probing with backward shift deletion never leaves holes in a probe sequence.
+template<typename K, typename V>
+inline U32
+FindEmptySlot(Hash_Map<K, V>* map, U64 hash)
+{
+    U32 mask     = map->capacity - 1;
+    U32 position = (U32)(hash >> 7) & mask;
+    
+    for (;;)
+    {
+        U32 empty_mask = HashMapMatchMask(map->control + position, HASH_MAP_EMPTY);
+        
+        if (empty_mask)
+        {
+            return (position + FindFirstSetBit(empty_mask)) & mask;
+        }
+        
+        position = (position + HASH_MAP_GROUP_WIDTH) & mask;
+    }
+}
+
+template<typename K, typename V>
+inline void
+AllocateHashMapTable(Hash_Map<K, V>* map, U32 capacity)
+{
+    Assert(capacity >= HASH_MAP_MIN_CAPACITY && (capacity & (capacity - 1)) == 0);
+    
+    map->capacity = capacity;
+    map->count    = 0;
+    map->control  = PushArray(map->arena, U8, capacity + HASH_MAP_GROUP_WIDTH - 1);
+    map->slots    = (Hash_Map_Slot<K, V>*)PushSize(map->arena, capacity * sizeof(Hash_Map_Slot<K, V>), alignof(Hash_Map_Slot<K, V>));
+    
+    for (U32 i = 0; i < capacity + HASH_MAP_GROUP_WIDTH - 1; ++i)
+    {
+        map->control[i] = HASH_MAP_EMPTY;
+    }
+}
+
+template<typename K, typename V>
+inline U32
+HashMapCapacityFor(U32 count)
+{
+    // NOTE(soimn): Max load factor of 7/8
+    UMM required = (UMM)count + count / 7 + 1;
+    
+    U32 capacity = HASH_MAP_MIN_CAPACITY;
+    while (capacity < required)
+    {
+        Assert(capacity <= U32_MAX / 2);
+        capacity <<= 1;
+    }
+    
+    return capacity;
+}
+
+template<typename K, typename V>
+inline Hash_Map<K, V>
+HashMap(Memory_Arena* arena, U32 initial_count = 0)
+{
+    Hash_Map<K, V> result = {};
+    result.arena = arena;
+    
+    AllocateHashMapTable(&result, HashMapCapacityFor<K, V>(initial_count));
+    
+    return result;
+}
+
+template<typename K, typename V>
+inline void
+Reserve(Hash_Map<K, V>* map, U32 count)
+{
+    U32 capacity = HashMapCapacityFor<K, V>(count);
+    
+    if (capacity > map->capacity)
+    {
+        U8* old_control                = map->control;
+        Hash_Map_Slot<K, V>* old_slots = map->slots;
+        U32 old_capacity               = map->capacity;
+        U32 old_count                  = map->count;
+        
+        AllocateHashMapTable(map, capacity);
+        
+        for (U32 i = 0; i < old_capacity; ++i)
+        {
+            if (old_control[i] != HASH_MAP_EMPTY)
+            {
+                U64 hash  = HashKey(old_slots[i].key);
+                U32 index = FindEmptySlot(map, hash);
+                
+                SetControl(map, index, (U8)(hash & 0x7F));
+                map->slots[index] = old_slots[i];
+            }
+        }
+        
+        map->count = old_count;
+    }
+}
+
+// NOTE(soimn): Returns the slot index of the key, or U32_MAX if the key is not present
+template<typename K, typename V>
+inline U32
+FindSlot(Hash_Map<K, V>* map, K key)
+{
+    U32 result = U32_MAX;
+    
+    U64 hash = HashKey(key);
+    U8 h2    = (U8)(hash & 0x7F);
+    
+    U32 mask     = map->capacity - 1;
+    U32 position = (U32)(hash >> 7) & mask;
+    
+    for (;;)
+    {
+        U8* group = map->control + position;
+        
+        for (U32 match_mask = HashMapMatchMask(group, h2); match_mask; match_mask &= match_mask - 1)
+        {
+            U32 index = (position + FindFirstSetBit(match_mask)) & mask;
+            
+            if (KeysAreEqual(map->slots[index].key, key))
+            {
+                result = index;
+                break;
+            }
+        }
+        
+        if (result != U32_MAX || HashMapMatchMask(group, HASH_MAP_EMPTY))
+        {
+            break;
+        }
+        
+        position = (position + HASH_MAP_GROUP_WIDTH) & mask;
+    }
+    
+    return result;
+}
+
+template<typename K, typename V>
+inline V*
+Lookup(Hash_Map<K, V>* map, K key)
+{
+    U32 index = FindSlot(map, key);
+    
+    return (index != U32_MAX ? &map->slots[index].value : 0);
+}
+
+// NOTE(soimn): Inserts the key if it is not present, and returns a pointer to the value of the key.
+//              An existing value is overwritten.
+template<typename K, typename V>
+inline V*
+Insert(Hash_Map<K, V>* map, K key, V value)
+{
+    V* result = Lookup(map, key);
+    
+    if (!result)
+    {
+        Reserve(map, map->count + 1);
+        
+        U64 hash  = HashKey(key);
+        U32 index = FindEmptySlot(map, hash);
+        
+        SetControl(map, index, (U8)(hash & 0x7F));
+        map->slots[index].key = key;
+        ++map->count;
+        
+        result = &map->slots[index].value;
+    }
+    
+    *result = value;
+    
+    return result;
+}
+
+template<typename K, typename V>
+inline bool
+Remove(Hash_Map<K, V>* map, K key)
+{
+    U32 hole    = FindSlot(map, key);
+    bool result = (hole != U32_MAX);
+    
+    if (result)
+    {
+        U32 mask = map->capacity - 1;
+        
+        // NOTE(soimn): Backward shift deletion. Every following entry of the cluster whose home slot is not
+        //              between the hole and itself is moved into the hole, which leaves no gaps in any probe
+        //              sequence.
+        for (U32 scan = (hole + 1) & mask; map->control[scan] != HASH_MAP_EMPTY; scan = (scan + 1) & mask)
+        {
+            U32 home = (U32)(HashKey(map->slots[scan].key) >> 7) & mask;
+            
+            if (((scan - home) & mask) >= ((scan - hole) & mask))
+            {
+                SetControl(map, hole, map->control[scan]);
+                map->slots[hole] = map->slots[scan];
+                hole = scan;
+            }
+        }
+        
+        SetControl(map, hole, HASH_MAP_EMPTY);
+        --map->count;
+    }
+    
+    return result;
+}
+
+template<typename K, typename V>
+inline void
+ClearHashMap(Hash_Map<K, V>* map)
+{
+    for (U32 i = 0; i < map->capacity + HASH_MAP_GROUP_WIDTH - 1; ++i)
+    {
+        map->control[i] = HASH_MAP_EMPTY;
+    }
+    
+    map->count = 0;
+}
+
+// NOTE(soimn): Bulk build mode. The keys are required to be unique and not already present in the map, which
+//              allows skipping the lookup. The table is sized once up front, and the hashes are computed a batch
+//              at a time with the home groups prefetched before any insertion touches them.
+template<typename K, typename V>
+inline void
+BulkInsert(Hash_Map<K, V>* map, K* keys, V* values, U32 count)
+{
+    Reserve(map, map->count + count);
+    
+    U32 mask = map->capacity - 1;
+    
+    U64 hashes[HASH_MAP_GROUP_WIDTH];
+    
+    for (U32 batch_start = 0; batch_start < count; batch_start += HASH_MAP_GROUP_WIDTH)
+    {
+        U32 batch_size = MIN(count - batch_start, HASH_MAP_GROUP_WIDTH);
+        
+        for (U32 i = 0; i < batch_size; ++i)
+        {
+            hashes[i] = HashKey(keys[batch_start + i]);
+            _mm_prefetch((const char*)(map->control + ((U32)(hashes[i] >> 7) & mask)), _MM_HINT_T0);
+        }
+        
+        for (U32 i = 0; i < batch_size; ++i)
+        {
+            U32 index = FindEmptySlot(map, hashes[i]);
+            
+            SetControl(map, index, (U8)(hashes[i] & 0x7F));
+            map->slots[index].key   = keys[batch_start + i];
+            map->slots[index].value = values[batch_start + i];
+        }
+    }
+    
+    map->count += count;
+}
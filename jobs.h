@@ -0,0 +1,524 @@
+#pragma once
+
+#include "common.h"
+#include "atomics.h"
+#include "memory.h"
+
+typedef void (*Thread_Proc)(void* data);
+
+inline void*
+StartThread(Thread_Proc proc, void* data);
+
+inline void
+JoinThread(void* thread);
+
+inline U32
+ProcessorCount();
+
+inline void*
+NewSemaphore(U32 initial_count);
+
+inline void
+SignalSemaphore(void* semaphore, U32 count);
+
+inline void
+WaitForSemaphore(void* semaphore);
+
+inline void
+FreeSemaphore(void* semaphore);
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): Work stealing job system. Every worker owns a Chase-Lev deque, and pushes and pops the jobs it
+//              submits at the bottom, while idle workers steal from the top of the deques of the others. The owner
+//              only synchronizes with thieves when its deque is down to its last job, so submitting and running
+//              the jobs of a worker is mostly free of contention, and a worker running out of work takes the
+//              oldest, and usually largest, job of another.
+//
+//              Fork-join is done with counters. Submitting a job adds one to its counter, and finishing it
+//              subtracts one, so a counter reaches 0 when every job submitted to it, and every job those submitted
+//              to it, is done. A worker waiting on a counter runs other jobs in the meantime rather than block.
+//              A job that waits can therefore have other jobs run on top of it on the same worker, and must not
+//              keep anything in the scratch arena of the worker across the wait.
+//
+//              Worker 0 is the thread that started the job system, which only runs jobs while it waits on a
+//              counter. The other workers run on threads of their own, and sleep on a semaphore after spinning for
+//              a while without finding a job.
+//
+//              Every worker has a scratch arena for memory that is only used while a job runs, which is reset after
+//              every job the worker runs.
+
+#define JOB_SYSTEM_MAX_WORKERS 64
+#define JOB_SYSTEM_IDLE_SPINS 4096
+#define JOB_DEQUE_INITIAL_CAPACITY 256
+
+struct Job_Worker;
+
+// NOTE(soimn): A job runs on the range [start..end), which is only meaningful for the jobs of ParallelFor
+typedef void (*Job_Proc)(Job_Worker* worker, void* data, UMM start, UMM end);
+
+struct Job_Counter
+{
+    volatile U32 count;
+};
+
+struct Job
+{
+    Job_Proc proc;
+    void* data;
+    UMM start;
+    UMM end;
+    Job_Counter* counter;
+};
+
+// NOTE(soimn): Buffers are never freed while the job system runs, since a thief may still read from a buffer that
+//              the owner has replaced with a larger one
+struct Job_Deque_Buffer
+{
+    I64 mask;
+    Job* jobs;
+};
+
+// NOTE(soimn): top is only advanced, and bottom is only changed by the owner. They are kept on separate cache
+//              lines, so thieves reading top do not invalidate bottom for the owner.
+struct Job_Deque
+{
+    volatile I64 top;
+    U8 top_padding[64 - sizeof(I64)];
+    
+    volatile I64 bottom;
+    Job_Deque_Buffer* volatile buffer;
+    U8 bottom_padding[64 - sizeof(I64) - sizeof(Job_Deque_Buffer*)];
+};
+
+struct Job_System;
+
+struct Job_Worker
+{
+    Job_System* system;
+    U32 index;
+    
+    Job_Deque deque;
+    Memory_Arena deque_arena;
+    
+    Memory_Arena scratch;
+    
+    U32 random_state;
+};
+
+struct Job_System
+{
+    Job_Worker workers[JOB_SYSTEM_MAX_WORKERS];
+    U32 worker_count;
+    
+    void* threads[JOB_SYSTEM_MAX_WORKERS];
+    void* semaphore;
+    
+    volatile U32 sleeping_count;
+    volatile U32 is_stopping;
+};
+
+inline Job_Deque_Buffer*
+JobDequeBuffer(Memory_Arena* arena, I64 capacity)
+{
+    Job_Deque_Buffer* result = PushArray(arena, Job_Deque_Buffer, 1);
+    result->mask = capacity - 1;
+    result->jobs = PushArray(arena, Job, capacity);
+    
+    return result;
+}
+
+inline void
+PushJob(Job_Worker* worker, Job job)
+{
+    Job_Deque* deque = &worker->deque;
+    
+    I64 bottom               = deque->bottom;
+    I64 top                  = deque->top;
+    Job_Deque_Buffer* buffer = deque->buffer;
+    
+    if (bottom - top > buffer->mask)
+    {
+        Job_Deque_Buffer* new_buffer = JobDequeBuffer(&worker->deque_arena, 2 * (buffer->mask + 1));
+        
+        for (I64 i = top; i < bottom; ++i)
+        {
+            new_buffer->jobs[i & new_buffer->mask] = buffer->jobs[i & buffer->mask];
+        }
+        
+        _ReadWriteBarrier();
+        deque->buffer = new_buffer;
+        buffer        = new_buffer;
+    }
+    
+    buffer->jobs[bottom & buffer->mask] = job;
+    
+    _ReadWriteBarrier();
+    deque->bottom = bottom + 1;
+}
+
+inline bool
+PopJob(Job_Worker* worker, Job* job)
+{
+    Job_Deque* deque = &worker->deque;
+    
+    bool result = false;
+    
+    I64 bottom               = deque->bottom - 1;
+    Job_Deque_Buffer* buffer = deque->buffer;
+    
+    // NOTE(soimn): The claim on the bottom job has to be visible to thieves before top is read, see MemoryFence
+    deque->bottom = bottom;
+    MemoryFence();
+    
+    I64 top = deque->top;
+    
+    if (top <= bottom)
+    {
+        *job   = buffer->jobs[bottom & buffer->mask];
+        result = true;
+        
+        if (top == bottom)
+        {
+            // NOTE(soimn): The last job, which a thief may be taking at the same time
+            result        = (AtomicCompareExchange(&deque->top, top + 1, top) == top);
+            deque->bottom = bottom + 1;
+        }
+    }
+    
+    else
+    {
+        deque->bottom = bottom + 1;
+    }
+    
+    return result;
+}
+
+inline bool
+StealJob(Job_Worker* victim, Job* job)
+{
+    Job_Deque* deque = &victim->deque;
+    
+    bool result = false;
+    
+    I64 top = deque->top;
+    _ReadWriteBarrier();
+    I64 bottom = deque->bottom;
+    
+    if (top < bottom)
+    {
+        Job_Deque_Buffer* buffer = deque->buffer;
+        *job = buffer->jobs[top & buffer->mask];
+        
+        result = (AtomicCompareExchange(&deque->top, top + 1, top) == top);
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Takes a job from the deque of the worker, or steals one from another worker, starting at a random
+//              one so thieves spread out over the victims
+inline bool
+FindJob(Job_Worker* worker, Job* job)
+{
+    Job_System* system = worker->system;
+    
+    bool result = PopJob(worker, job);
+    
+    if (!result && system->worker_count > 1)
+    {
+        worker->random_state ^= worker->random_state << 13;
+        worker->random_state ^= worker->random_state >> 17;
+        worker->random_state ^= worker->random_state << 5;
+        
+        U32 first = worker->random_state % system->worker_count;
+        
+        for (U32 i = 0; i < system->worker_count && !result; ++i)
+        {
+            U32 victim = (first + i) % system->worker_count;
+            
+            if (victim != worker->index) result = StealJob(&system->workers[victim], job);
+        }
+    }
+    
+    return result;
+}
+
+inline bool
+IsAnyJobQueued(Job_System* system)
+{
+    bool result = false;
+    
+    for (U32 i = 0; i < system->worker_count && !result; ++i)
+    {
+        result = (system->workers[i].deque.top < system->workers[i].deque.bottom);
+    }
+    
+    return result;
+}
+
+inline void
+RunJob(Job_Worker* worker, Job job)
+{
+    job.proc(worker, job.data, job.start, job.end);
+    
+    AtomicAdd(&job.counter->count, (U32)-1);
+}
+
+// NOTE(soimn): Submits the job to the deque of the worker, which has to be the worker the calling thread runs
+inline void
+SubmitJob(Job_Worker* worker, Job job)
+{
+    Job_System* system = worker->system;
+    
+    AtomicAdd(&job.counter->count, 1);
+    
+    PushJob(worker, job);
+    
+    // NOTE(soimn): Pairs with the check for queued jobs a worker does after announcing that it is going to sleep
+    MemoryFence();
+    
+    if (system->sleeping_count != 0) SignalSemaphore(system->semaphore, 1);
+}
+
+inline void
+SubmitJob(Job_Worker* worker, Job_Proc proc, void* data, Job_Counter* counter, UMM start = 0, UMM end = 1)
+{
+    SubmitJob(worker, Job{proc, data, start, end, counter});
+}
+
+inline void
+WaitForCounter(Job_Worker* worker, Job_Counter* counter)
+{
+    while (counter->count != 0)
+    {
+        Job job;
+        if (FindJob(worker, &job))
+        {
+            RunJob(worker, job);
+            ResetArena(&worker->scratch);
+        }
+        
+        else
+        {
+            _mm_pause();
+        }
+    }
+}
+
+inline void
+JobWorkerThread(void* data)
+{
+    Job_Worker* worker = (Job_Worker*)data;
+    Job_System* system = worker->system;
+    
+    U32 idle_spins = 0;
+    
+    for (;;)
+    {
+        Job job;
+        if (FindJob(worker, &job))
+        {
+            RunJob(worker, job);
+            ResetArena(&worker->scratch);
+            
+            idle_spins = 0;
+        }
+        
+        else if (system->is_stopping)
+        {
+            break;
+        }
+        
+        else if (idle_spins < JOB_SYSTEM_IDLE_SPINS)
+        {
+            ++idle_spins;
+            _mm_pause();
+        }
+        
+        else
+        {
+            AtomicAdd(&system->sleeping_count, 1);
+            
+            if (!IsAnyJobQueued(system) && !system->is_stopping)
+            {
+                WaitForSemaphore(system->semaphore);
+            }
+            
+            AtomicAdd(&system->sleeping_count, (U32)-1);
+            
+            idle_spins = 0;
+        }
+    }
+}
+
+// NOTE(soimn): The job system is started in place, since the workers keep a pointer to it. A worker_count of 0
+//              uses one worker per processor.
+inline void
+StartJobSystem(Job_System* system, U32 worker_count = 0)
+{
+    *system = {};
+    
+    if (worker_count == 0) worker_count = ProcessorCount();
+    
+    system->worker_count = MAX(MIN(worker_count, JOB_SYSTEM_MAX_WORKERS), 1);
+    system->semaphore    = NewSemaphore(0);
+    
+    for (U32 i = 0; i < system->worker_count; ++i)
+    {
+        Job_Worker* worker = &system->workers[i];
+        worker->system       = system;
+        worker->index        = i;
+        worker->random_state = 2654435761U * (i + 1);
+        worker->deque.buffer = JobDequeBuffer(&worker->deque_arena, JOB_DEQUE_INITIAL_CAPACITY);
+    }
+    
+    for (U32 i = 1; i < system->worker_count; ++i)
+    {
+        system->threads[i] = StartThread(JobWorkerThread, &system->workers[i]);
+    }
+}
+
+// NOTE(soimn): Has to be called from the thread that started the job system, with no jobs left to run
+inline void
+StopJobSystem(Job_System* system)
+{
+    system->is_stopping = true;
+    
+    SignalSemaphore(system->semaphore, system->worker_count);
+    
+    for (U32 i = 1; i < system->worker_count; ++i)
+    {
+        JoinThread(system->threads[i]);
+    }
+    
+    for (U32 i = 0; i < system->worker_count; ++i)
+    {
+        ClearArena(&system->workers[i].deque_arena);
+        ClearArena(&system->workers[i].scratch);
+    }
+    
+    FreeSemaphore(system->semaphore);
+    
+    *system = {};
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): ParallelFor runs proc over [0..count) in batches of at most batch_size, and returns when all of
+//              them are done. The range is split in halves, and the upper half submitted as a job of its own, until
+//              it is down to a batch, so the deques only hold a logarithmic number of jobs, and a thief takes half
+//              of the remaining work rather than a single batch.
+struct Parallel_For
+{
+    Job_Proc proc;
+    void* data;
+    UMM batch_size;
+    Job_Counter counter;
+};
+
+inline void
+ParallelForJob(Job_Worker* worker, void* data, UMM start, UMM end)
+{
+    Parallel_For* parallel_for = (Parallel_For*)data;
+    
+    while (end - start > parallel_for->batch_size)
+    {
+        UMM middle = start + (end - start) / 2;
+        
+        SubmitJob(worker, ParallelForJob, parallel_for, &parallel_for->counter, middle, end);
+        
+        end = middle;
+    }
+    
+    parallel_for->proc(worker, parallel_for->data, start, end);
+}
+
+inline void
+ParallelFor(Job_Worker* worker, UMM count, UMM batch_size, Job_Proc proc, void* data)
+{
+    Parallel_For parallel_for = {};
+    parallel_for.proc       = proc;
+    parallel_for.data       = data;
+    parallel_for.batch_size = MAX(batch_size, 1);
+    
+    if (count != 0)
+    {
+        SubmitJob(worker, ParallelForJob, &parallel_for, &parallel_for.counter, 0, count);
+        WaitForCounter(worker, &parallel_for.counter);
+    }
+}
+
+template<typename T>
+struct Parallel_For_Elements
+{
+    void (*proc)(Job_Worker* worker, T* elements, UMM count, void* data);
+    void* data;
+    T* elements;
+};
+
+template<typename T>
+inline void
+ParallelForElementsJob(Job_Worker* worker, void* data, UMM start, UMM end)
+{
+    Parallel_For_Elements<T>* parallel_for = (Parallel_For_Elements<T>*)data;
+    
+    parallel_for->proc(worker, parallel_for->elements + start, end - start, parallel_for->data);
+}
+
+template<typename T>
+inline void
+ParallelFor(Job_Worker* worker, Dynamic_Array<T>* array, UMM batch_size,
+            void (*proc)(Job_Worker* worker, T* elements, UMM count, void* data), void* data)
+{
+    Parallel_For_Elements<T> parallel_for = {proc, data, array->data};
+    
+    ParallelFor(worker, array->count, batch_size, ParallelForElementsJob<T>, &parallel_for);
+}
+
+template<typename T, U32 BlockSize>
+struct Parallel_For_Blocks
+{
+    void (*proc)(Job_Worker* worker, T* elements, UMM count, void* data);
+    void* data;
+    Bucket_Array_Block** blocks;
+};
+
+template<typename T, U32 BlockSize>
+inline void
+ParallelForBlocksJob(Job_Worker* worker, void* data, UMM start, UMM end)
+{
+    Parallel_For_Blocks<T, BlockSize>* parallel_for = (Parallel_For_Blocks<T, BlockSize>*)data;
+    
+    for (UMM i = start; i < end; ++i)
+    {
+        Bucket_Array_Block* block = parallel_for->blocks[i];
+        
+        if (block->offset != 0) parallel_for->proc(worker, (T*)(block + 1), block->offset, parallel_for->data);
+    }
+}
+
+// NOTE(soimn): Runs proc on the elements of one block at a time. The blocks are collected up front, since they
+//              are only reachable by walking the block list.
+template<typename T, U32 BlockSize>
+inline void
+ParallelFor(Job_Worker* worker, Bucket_Array<T, BlockSize>* array,
+            void (*proc)(Job_Worker* worker, T* elements, UMM count, void* data), void* data)
+{
+    Dynamic_Array<Bucket_Array_Block*> blocks = DynamicArray<Bucket_Array_Block*>(MAX(array->block_count, 1) * sizeof(Bucket_Array_Block*));
+    
+    for (Bucket_Array_Block* block = array->first_block; block && blocks.count < array->block_count; block = block->next)
+    {
+        *PushElement(&blocks) = block;
+    }
+    
+    Parallel_For_Blocks<T, BlockSize> parallel_for = {proc, data, blocks.data};
+    
+    ParallelFor(worker, blocks.count, 1, ParallelForBlocksJob<T, BlockSize>, &parallel_for);
+    
+    FreeArray(&blocks);
+}
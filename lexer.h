@@ -3,6 +3,7 @@
 #include "common.h"
 #include "string.h"
 #include "memory.h"
+#include "diagnostics.h"
 
 enum LEXER_TOKEN_TYPE
 {
@@ -15,6 +16,9 @@ enum LEXER_TOKEN_TYPE
     Token_Do,
     Token_While,
     Token_For,
+    Token_Return,
+    Token_Break,
+    Token_Continue,
     
     Token_Identifier,
     // TODO(soimn): GetTokenRaw unicode character constant support
@@ -64,6 +68,7 @@ enum LEXER_TOKEN_TYPE
     Token_Elipsis,            // ...
     Token_Comma,              // ,
     Token_Semicolon,          // ;
+    Token_At,                 // @
     
     Token_OpenParen,          // (
     Token_CloseParen,         // )
@@ -80,20 +85,25 @@ enum LEXER_TOKEN_TYPE
     Token_EndOfStream,
     
     Token_Error,
+    
+    LEXER_TOKEN_TYPE_COUNT
 };
 
 struct Lexer
 {
+    Diagnostics_Engine* diagnostics;
+    
     File_ID file;
     U32 line;
     U32 column;
     char peek[2];
-    Bucket_Array_Iterator iterator;
+    Bucket_Array_Iterator<char, STRING_STREAM_BLOCK_SIZE> iterator;
 };
 
 struct Token
 {
     Enum32(LEXER_TOKEN_TYPE) type;
+    Source_Location location;
     
     union
     {
@@ -116,11 +126,106 @@ struct Token
     
 };
 
+// NOTE(soimn): Describes the token type for diagnostics, e.g. "Expected ';', found an identifier"
+inline const char*
+TokenName(Enum32(LEXER_TOKEN_TYPE) type)
+{
+    const char* result = "";
+    
+    switch (type)
+    {
+        case Token_Struct:             result = "'struct'"; break;
+        case Token_Union:              result = "'union'"; break;
+        case Token_Enum:               result = "'enum'"; break;
+        case Token_Typedef:            result = "'typedef'"; break;
+        case Token_If:                 result = "'if'"; break;
+        case Token_Else:               result = "'else'"; break;
+        case Token_Do:                 result = "'do'"; break;
+        case Token_While:              result = "'while'"; break;
+        case Token_For:                result = "'for'"; break;
+        case Token_Return:             result = "'return'"; break;
+        case Token_Break:              result = "'break'"; break;
+        case Token_Continue:           result = "'continue'"; break;
+        case Token_Identifier:         result = "an identifier"; break;
+        case Token_Character:          result = "a character constant"; break;
+        case Token_String:             result = "a string literal"; break;
+        case Token_INT:                result = "an integer literal"; break;
+        case Token_F32:                result = "a float literal"; break;
+        case Token_F64:                result = "a float literal"; break;
+        case Token_Plus:               result = "'+'"; break;
+        case Token_Inc:                result = "'++'"; break;
+        case Token_PlusEquals:         result = "'+='"; break;
+        case Token_Minus:              result = "'-'"; break;
+        case Token_Dec:                result = "'--'"; break;
+        case Token_MinusEquals:        result = "'-='"; break;
+        case Token_Divide:             result = "'/'"; break;
+        case Token_DivideEquals:       result = "'/='"; break;
+        case Token_Asterisk:           result = "'*'"; break;
+        case Token_MultiplyEquals:     result = "'*='"; break;
+        case Token_Modulo:             result = "'%'"; break;
+        case Token_ModuloEquals:       result = "'%='"; break;
+        case Token_Equals:             result = "'='"; break;
+        case Token_EqualTo:            result = "'=='"; break;
+        case Token_LogicalNot:         result = "'!'"; break;
+        case Token_NotEqual:           result = "'!='"; break;
+        case Token_GreaterThan:        result = "'>'"; break;
+        case Token_GreaterThanOrEqual: result = "'>='"; break;
+        case Token_RightShift:         result = "'>>'"; break;
+        case Token_RightShiftEquals:   result = "'>>='"; break;
+        case Token_LessThan:           result = "'<'"; break;
+        case Token_LessThanOrEqual:    result = "'<='"; break;
+        case Token_LeftShift:          result = "'<<'"; break;
+        case Token_LeftShiftEquals:    result = "'<<='"; break;
+        case Token_Ampersand:          result = "'&'"; break;
+        case Token_LogicalAnd:         result = "'&&'"; break;
+        case Token_AndEquals:          result = "'&='"; break;
+        case Token_Or:                 result = "'|'"; break;
+        case Token_LogicalOr:          result = "'||'"; break;
+        case Token_OrEquals:           result = "'|='"; break;
+        case Token_Not:                result = "'~'"; break;
+        case Token_NotEquals:          result = "'~='"; break;
+        case Token_XOR:                result = "'^'"; break;
+        case Token_XOREquals:          result = "'^='"; break;
+        case Token_QuestionMark:       result = "'?'"; break;
+        case Token_Colon:              result = "':'"; break;
+        case Token_Dot:                result = "'.'"; break;
+        case Token_Elipsis:            result = "'...'"; break;
+        case Token_Comma:              result = "','"; break;
+        case Token_Semicolon:          result = "';'"; break;
+        case Token_At:                 result = "'@'"; break;
+        case Token_OpenParen:          result = "'('"; break;
+        case Token_CloseParen:         result = "')'"; break;
+        case Token_OpenBrace:          result = "'{'"; break;
+        case Token_CloseBrace:         result = "'}'"; break;
+        case Token_OpenBracket:        result = "'['"; break;
+        case Token_CloseBracket:       result = "']'"; break;
+        case Token_Unknown:            result = "an unknown token"; break;
+        case Token_Comment:            result = "a comment"; break;
+        case Token_Whitespace:         result = "whitespace"; break;
+        case Token_EndOfLine:          result = "end of line"; break;
+        case Token_EndOfStream:        result = "end of file"; break;
+        case Token_Error:              result = "an invalid token"; break;
+        
+        INVALID_DEFAULT_CASE;
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Whether the value of the token is its string. Keywords and operators keep the string they were
+//              lexed from, which is empty for operators.
+inline bool
+TokenHasString(Enum32(LEXER_TOKEN_TYPE) type)
+{
+    return !(type == Token_INT || type == Token_F32 || type == Token_F64 || type == Token_Character ||
+             type == Token_Whitespace || type == Token_EndOfLine || type == Token_EndOfStream || type == Token_Error);
+}
+
 inline void
 Refill(Lexer* lexer)
 {
-    char* peek_0 = (char*)PeekForward(&lexer->iterator, 0);
-    char* peek_1 = (char*)PeekForward(&lexer->iterator, 1);
+    char* peek_0 = PeekForward(&lexer->iterator, 0);
+    char* peek_1 = PeekForward(&lexer->iterator, 1);
     
     lexer->peek[0] = (peek_0 != 0 ? *peek_0 : 0);
     lexer->peek[1] = (peek_1 != 0 ? *peek_1 : 0);
@@ -138,7 +243,7 @@ Advance(Lexer* lexer, U32 amount)
         if (IsEndOfLine(lexer->peek[0]))
         {
             ++lexer->line;
-            lexer->column = 0;
+            lexer->column = 1;
         }
         
         Advance(&lexer->iterator);
@@ -147,9 +252,13 @@ Advance(Lexer* lexer, U32 amount)
 }
 
 inline Lexer
-LexStringStream(String_Stream stream)
+LexStringStream(String_Stream stream, File_ID file, Diagnostics_Engine* diagnostics)
 {
     Lexer lexer = {};
+    lexer.diagnostics = diagnostics;
+    lexer.file        = file;
+    lexer.line        = 1;
+    lexer.column      = 1;
     
     lexer.iterator = Iterate(&stream.bucket_array);
     Refill(&lexer);
@@ -195,6 +304,11 @@ GetTokenRaw(Lexer* lexer, bool eat_all_whitespace_and_comments)
         }
     }
     
+    token.location = SourceLocation(lexer->file, lexer->line, lexer->column);
+    
+    Bucket_Array_Block* start_block = lexer->iterator.current_block;
+    UMM start_index                 = lexer->iterator.current_index;
+    
     char c = lexer->peek[0];
     Advance(lexer, 1);
     
@@ -221,6 +335,7 @@ GetTokenRaw(Lexer* lexer, bool eat_all_whitespace_and_comments)
         //case '.': token.type = Token_Dot; break;
         case ',': token.type = Token_Comma; break;
         case ';': token.type = Token_Semicolon; break;
+        case '@': token.type = Token_At; break;
         case '(': token.type = Token_OpenParen; break;
         case ')': token.type = Token_CloseParen; break;
         case '{': token.type = Token_OpenBrace; break;
@@ -251,7 +366,7 @@ GetTokenRaw(Lexer* lexer, bool eat_all_whitespace_and_comments)
                     token.type = Token_Comment;
                     token.string.first_block = lexer->iterator.current_block;
                     token.string.index       = lexer->iterator.current_index;
-                    token.string.block_size  = lexer->iterator.block_size;
+                    token.string.block_size  = STRING_STREAM_BLOCK_SIZE;
                     
                     while (lexer->peek[0] != 0 && !(lexer->peek[0] == '*' && lexer->peek[1] == '/'))
                     {
@@ -269,7 +384,7 @@ GetTokenRaw(Lexer* lexer, bool eat_all_whitespace_and_comments)
                     token.type = Token_Comment;
                     token.string.first_block = lexer->iterator.current_block;
                     token.string.index       = lexer->iterator.current_index;
-                    token.string.block_size  = lexer->iterator.block_size;
+                    token.string.block_size  = STRING_STREAM_BLOCK_SIZE;
                     
                     while (lexer->peek[0] != 0 && !IsEndOfLine(lexer->peek[0]))
                     {
@@ -290,12 +405,12 @@ GetTokenRaw(Lexer* lexer, bool eat_all_whitespace_and_comments)
             {
                 token.type = Token_Identifier;
                 
-                token.string.first_block = lexer->iterator.current_block;
-                token.string.index       = lexer->iterator.current_index;
-                token.string.block_size  = lexer->iterator.block_size;
+                token.string.first_block = start_block;
+                token.string.index       = start_index;
+                token.string.block_size  = STRING_STREAM_BLOCK_SIZE;
                 token.string.size        = 1;
                 
-                while (lexer->peek[0] != 0 && IsAlpha(lexer->peek[0]) || IsNumeric(lexer->peek[0]) || lexer->peek[0] == '_')
+                while (lexer->peek[0] != 0 && (IsAlpha(lexer->peek[0]) || IsNumeric(lexer->peek[0]) || lexer->peek[0] == '_'))
                 {
                     ++token.string.size;
                     Advance(lexer, 1);
@@ -345,6 +460,21 @@ GetTokenRaw(Lexer* lexer, bool eat_all_whitespace_and_comments)
                 {
                     token.type = Token_For;
                 }
+                
+                else if (StringCompare(token.string, CONST_STRING("return")))
+                {
+                    token.type = Token_Return;
+                }
+                
+                else if (StringCompare(token.string, CONST_STRING("break")))
+                {
+                    token.type = Token_Break;
+                }
+                
+                else if (StringCompare(token.string, CONST_STRING("continue")))
+                {
+                    token.type = Token_Continue;
+                }
             }
             
             else if (c == '"')
@@ -353,7 +483,7 @@ GetTokenRaw(Lexer* lexer, bool eat_all_whitespace_and_comments)
                 
                 token.string.first_block = lexer->iterator.current_block;
                 token.string.index       = lexer->iterator.current_index;
-                token.string.block_size  = lexer->iterator.block_size;
+                token.string.block_size  = STRING_STREAM_BLOCK_SIZE;
                 
                 while (lexer->peek[0] != 0 && lexer->peek[0] != '"')
                 {
@@ -363,7 +493,7 @@ GetTokenRaw(Lexer* lexer, bool eat_all_whitespace_and_comments)
                 
                 if (lexer->peek[0] == 0)
                 {
-                    //// ERROR: Reached end of stream before closing '"'
+                    Diagnose(lexer->diagnostics, Error, token.location, UnterminatedString);
                     token.type = Token_Error;
                 }
                 
@@ -392,13 +522,13 @@ GetTokenRaw(Lexer* lexer, bool eat_all_whitespace_and_comments)
                     
                     if (lexer->peek[0] == '\'')
                     {
-                        //// ERROR: Empty character constant
+                        Diagnose(lexer->diagnostics, Error, token.location, EmptyCharacter);
                         token.type = Token_Error;
                     }
                     
                     else
                     {
-                        //// ERROR: Missing terminating ' character
+                        Diagnose(lexer->diagnostics, Error, token.location, UnterminatedCharacter);
                         token.type = Token_Error;
                     }
                 }
@@ -426,53 +556,41 @@ GetTokenRaw(Lexer* lexer, bool eat_all_whitespace_and_comments)
                     
                     if (is_hex || is_octal || is_binary)
                     {
-                        Advance(lexer, 1);
+                        // NOTE(soimn): Octal constants have no prefix letter to skip, the first digit follows the 0
+                        if (!is_octal) Advance(lexer, 1);
                         token.type = Token_INT;
                         
                         U64 base = (U64)(is_hex ? 16 : (is_octal ? 8 : 2));
                         
-                        U64 last_num = 0;
+                        bool detected_overflow = false;
                         for (;;)
                         {
-                            if (token.num_u64 < last_num)
-                            {
-                                //// ERROR: Integer literal is too large to be represented in any integer type
-                                token.type = Token_Error;
-                            }
+                            U8 digit = 0;
+                            
+                            if      (IsNumeric(lexer->peek[0]))                                                  digit = (U8)(lexer->peek[0] - '0');
+                            else if (is_hex && ToUpper(lexer->peek[0]) >= 'A' && ToUpper(lexer->peek[0]) <= 'F') digit = (U8)(ToUpper(lexer->peek[0]) - 'A' + 10);
+                            else                                                                                 break;
                             
-                            if (IsNumeric(lexer->peek[0]))
+                            if (!detected_overflow && token.num_u64 > (U64_MAX - digit) / base)
                             {
-                                U8 digit = (U8)(lexer->peek[0] - '0');
-                                
-                                last_num = token.num_u64;
-                                
-                                token.num_u64 *= base;
-                                token.num_u64 += digit;
-                                
-                                if (is_binary && digit > 1)
-                                {
-                                    //// ERROR: Invalid digit '%u' in binary constant
-                                    token.type = Token_Error;
-                                }
+                                Diagnose(lexer->diagnostics, Error, token.location, IntegerTooLarge);
+                                token.type = Token_Error;
                                 
-                                else if (is_octal && digit > 7)
-                                {
-                                    //// ERROR: Invalid digit '%u' in octal constant
-                                    token.type = Token_Error;
-                                }
+                                detected_overflow = true;
                             }
                             
-                            else if (is_hex && (ToUpper(lexer->peek[0]) >= 'A' && ToUpper(lexer->peek[0]) <= 'F'))
+                            token.num_u64 = token.num_u64 * base + digit;
+                            
+                            if (is_binary && digit > 1)
                             {
-                                last_num = token.num_u64;
-                                
-                                token.num_u64 *= 16;
-                                token.num_u64 += (ToUpper(lexer->peek[0]) - 'A') + 10;
+                                Diagnose(lexer->diagnostics, Error, token.location, InvalidDigit, (U32)digit, "binary");
+                                token.type = Token_Error;
                             }
                             
-                            else
+                            else if (is_octal && digit > 7)
                             {
-                                break;
+                                Diagnose(lexer->diagnostics, Error, token.location, InvalidDigit, (U32)digit, "octal");
+                                token.type = Token_Error;
                             }
                             
                             Advance(lexer, 1);
@@ -489,20 +607,22 @@ GetTokenRaw(Lexer* lexer, bool eat_all_whitespace_and_comments)
                         bool has_exponent             = false;
                         bool detected_overflow        = false;
                         
-                        U64 last_acc = 0;
                         I32 length   = (IsNumeric(c) ? 1 : 0);
                         for (;; ++length)
                         {
                             if (!detected_overflow && IsNumeric(lexer->peek[0]))
                             {
-                                acc *= 10;
-                                acc += lexer->peek[0] - '0';
+                                U8 digit = (U8)(lexer->peek[0] - '0');
                                 
-                                if (acc < last_acc)
+                                if (acc > (U64_MAX - digit) / 10)
                                 {
                                     // NOTE(soimn): Continue parsing the number as if all is good
                                     detected_overflow = true;
-                                    acc = last_acc;
+                                }
+                                
+                                else
+                                {
+                                    acc = acc * 10 + digit;
                                 }
                             }
                             
@@ -542,7 +662,7 @@ GetTokenRaw(Lexer* lexer, bool eat_all_whitespace_and_comments)
                                             
                                             else
                                             {
-                                                //// ERROR: Floating point number ended in exponent with no digits
+                                                Diagnose(lexer->diagnostics, Error, token.location, MissingExponentDigits);
                                                 token.type = Token_Error;
                                                 break;
                                             }
@@ -564,7 +684,7 @@ GetTokenRaw(Lexer* lexer, bool eat_all_whitespace_and_comments)
                                                 
                                                 if (exponent < last_exponent)
                                                 {
-                                                    //// ERROR: Magnitude of floating-point constant too large
+                                                    Diagnose(lexer->diagnostics, Error, token.location, FloatMagnitudeTooLarge);
                                                     token.type = Token_Error;
                                                 }
                                             }
@@ -602,12 +722,12 @@ GetTokenRaw(Lexer* lexer, bool eat_all_whitespace_and_comments)
                                     if (num > F32_MIN && num < F32_MAX)
                                     {
                                         token.type    = Token_F32;
-                                        token.num_f32 = num;
+                                        token.num_f32 = (F32)num;
                                     }
                                     
                                     else
                                     {
-                                        //// ERROR: Floating point literal too large to be represented by type 'float'
+                                        Diagnose(lexer->diagnostics, Error, token.location, FloatTooLargeForF32);
                                         token.type = Token_Error;
                                     }
                                 }
@@ -629,7 +749,7 @@ GetTokenRaw(Lexer* lexer, bool eat_all_whitespace_and_comments)
                                 
                                 else
                                 {
-                                    //// ERROR: Integer literal is too large to be represented in any integer type
+                                    Diagnose(lexer->diagnostics, Error, token.location, IntegerTooLarge);
                                     token.type = Token_Error;
                                 }
                             }
@@ -839,7 +959,7 @@ GetToken(Lexer* lexer)
         else
         {
             // TODO(soimn): How to handle incomplete elipsis tokens?
-            //// ERROR: ..
+            Diagnose(lexer->diagnostics, Error, result.location, IncompleteElipsis);
             result.type = Token_Error;
         }
     }
@@ -847,6 +967,8 @@ GetToken(Lexer* lexer)
     return result;
 }
 
+// NOTE(soimn): Peeking lexes the token twice, and thereby reports its diagnostics twice. The duplicates share
+//              location and message, and are dropped when the diagnostics are emitted.
 inline Token
 PeekToken(Lexer* lexer)
 {
@@ -868,4 +990,25 @@ RequireToken(Lexer* lexer, Enum32(LEXER_TOKEN_TYPE) type, bool allways_remove =
     }
     
     return result;
-}
\ No newline at end of file
+}
+
+// NOTE(soimn): Lexes the entire stream up front, so the parser can look ahead and skip around with plain
+//              indexing instead of copying the lexer. There are never more tokens than characters, which bounds
+//              the reservation, and the array always ends with a Token_EndOfStream token.
+inline Dynamic_Array<Token>
+Tokenize(String_Stream stream, File_ID file, Diagnostics_Engine* diagnostics)
+{
+    Dynamic_Array<Token> result = DynamicArray<Token>((stream.bucket_array.num_elements + 1) * sizeof(Token));
+    
+    Lexer lexer = LexStringStream(stream, file, diagnostics);
+    
+    for (;;)
+    {
+        Token* token = PushElement(&result);
+        *token = GetToken(&lexer);
+        
+        if (token->type == Token_EndOfStream) break;
+    }
+    
+    return result;
+}
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "common.h"
+#include "atomics.h"
+
+#include <emmintrin.h>
+#include <intrin.h>
 
 // TODO(soimn): Add tags to memory arenas to allow for tracking and 
 //              more detailed error messages
@@ -13,6 +17,9 @@ struct Memory_Block
 	U64 space;
 };
 
+// NOTE(soimn): The space AllocateMemoryBlock adds to the requested size, for the header and its alignment
+#define MEMORY_BLOCK_HEADER_SIZE ((alignof(Memory_Block) - 1) + sizeof(Memory_Block))
+
 struct Memory_Arena
 {
 	Memory_Block* current_block;
@@ -26,6 +33,22 @@ AllocateMemoryBlock(UMM block_size);
 inline void
 FreeMemoryBlock(Memory_Block* block);
 
+inline void*
+ReserveMemory(UMM size);
+
+inline void
+CommitMemory(void* ptr, UMM size);
+
+inline void
+ReleaseMemory(void* ptr);
+
+// NOTE(soimn): Maps a file read only into memory. Returns 0 when the file cannot be opened or is empty.
+inline void*
+MapFile(const char* path, UMM* size);
+
+inline void
+UnmapFile(void* view);
+
 inline U8*
 Align(void* ptr, U8 alignment)
 {
@@ -52,12 +75,39 @@ Copy(void* source, void* dest, UMM size)
     U8* bsource = (U8*) source;
     U8* bdest   = (U8*) dest;
     
-    while (bsource < (U8*) source + size)
+    for (; size >= 16; size -= 16, bsource += 16, bdest += 16)
+    {
+        _mm_storeu_si128((__m128i*) bdest, _mm_loadu_si128((__m128i*) bsource));
+    }
+    
+    for (; size; --size)
     {
         *(bdest++) = *(bsource++);
     }
 }
 
+inline bool
+MemoryEquals(void* a, void* b, UMM size)
+{
+    bool result = true;
+    
+    U8* ba = (U8*) a;
+    U8* bb = (U8*) b;
+    
+    for (; result && size >= 16; size -= 16, ba += 16, bb += 16)
+    {
+        __m128i equal = _mm_cmpeq_epi8(_mm_loadu_si128((__m128i*) ba), _mm_loadu_si128((__m128i*) bb));
+        result = (_mm_movemask_epi8(equal) == 0xFFFF);
+    }
+    
+    for (; result && size; --size)
+    {
+        result = (*(ba++) == *(bb++));
+    }
+    
+    return result;
+}
+
 #define CopyStruct(source, dest) Copy((void*) (source), (void*) (dest), sizeof(*(source)))
 #define CopyArray(source, dest, count) Copy((void*) (source), (void*) (dest), sizeof(*(source)) * (count))
 
@@ -65,7 +115,7 @@ inline void
 ZeroSize(void* ptr, UMM size)
 {
 	U8* bptr = (U8*) ptr;
-    
+
 	while (bptr < (U8*) ptr + size) *(bptr++) = 0;
 }
 
@@ -76,6 +126,218 @@ ZeroSize(void* ptr, UMM size)
 /// /////////////////////////////////////////////
 /// /////////////////////////////////////////////
 
+// NOTE(soimn): Freed memory blocks are kept in a process wide cache, bucketed by power of two size classes, 
+//              instead of being returned to the OS. Blocks are always allocated with the full size of their 
+//              class, header included, so a class is a whole number of pages, and any cached block in a class can
+//              satisfy any request that rounds up to that class once the header is added. Blocks larger than the
+//              largest class bypass the cache entirely.
+//
+//              The cache is shared by every thread, so the free lists are guarded by a spin lock. Only the list
+//              operations are done under the lock, allocating, prefaulting and freeing blocks is done outside it.
+
+#define MEMORY_BLOCK_CACHE_MIN_CLASS 12
+#define MEMORY_BLOCK_CACHE_MAX_CLASS 30
+#define MEMORY_BLOCK_CACHE_CLASS_COUNT (MEMORY_BLOCK_CACHE_MAX_CLASS - MEMORY_BLOCK_CACHE_MIN_CLASS + 1)
+#define MEMORY_BLOCK_CACHE_PAGE_SIZE KILOBYTES(4)
+
+struct Memory_Block_Cache
+{
+    Spin_Lock lock;
+    
+    Memory_Block* free_lists[MEMORY_BLOCK_CACHE_CLASS_COUNT];
+    U32 block_counts[MEMORY_BLOCK_CACHE_CLASS_COUNT];
+    
+    UMM retained_size;
+    UMM retention_limit;
+    
+    bool prefault_pages;
+};
+
+global Memory_Block_Cache MemoryBlockCache = {{}, {}, {}, 0, MEGABYTES(256), false};
+
+inline void
+ConfigureMemoryBlockCache(UMM retention_limit, bool prefault_pages)
+{
+    MemoryBlockCache.retention_limit = retention_limit;
+    MemoryBlockCache.prefault_pages  = prefault_pages;
+}
+
+// NOTE(soimn): Returns 0 for 0
+inline U8
+HighestSetBit(UMM value)
+{
+    unsigned long index = 0;
+    _BitScanReverse64(&index, value);
+    
+    return (U8)index;
+}
+
+// NOTE(soimn): Undefined for 0
+inline U32
+FindFirstSetBit(U32 mask)
+{
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    
+    return (U32)index;
+}
+
+inline UMM
+MemoryBlockCapacity(Memory_Block* block)
+{
+    return block->space + (block->push_ptr - Align(block + 1, 8));
+}
+
+inline void
+ResetMemoryBlock(Memory_Block* block)
+{
+    U8* new_push_ptr = Align(block + 1, 8);
+    block->space    += block->push_ptr - new_push_ptr;
+    block->push_ptr  = new_push_ptr;
+    
+    block->prev = 0;
+    block->next = 0;
+}
+
+// NOTE(soimn): Touches every page of the block, so the page faults are taken when the block enters the cache 
+//              and not on first use in a later compilation
+inline void
+PrefaultMemoryBlock(Memory_Block* block)
+{
+    volatile U8* start = block->push_ptr;
+    
+    for (UMM offset = 0; offset < block->space; offset += MEMORY_BLOCK_CACHE_PAGE_SIZE)
+    {
+        start[offset] = 0;
+    }
+}
+
+inline Memory_Block*
+AcquireMemoryBlock(UMM block_size)
+{
+    Memory_Block* result = 0;
+    
+    UMM total_size = block_size + MEMORY_BLOCK_HEADER_SIZE;
+    
+    U8 size_class = HighestSetBit(total_size);
+    size_class    = (U8)(size_class + ((UMM)1 << size_class != total_size));
+    size_class    = (U8)MAX(size_class, MEMORY_BLOCK_CACHE_MIN_CLASS);
+    
+    if (size_class <= MEMORY_BLOCK_CACHE_MAX_CLASS)
+    {
+        U8 index = (U8)(size_class - MEMORY_BLOCK_CACHE_MIN_CLASS);
+        
+        LockSpinLock(&MemoryBlockCache.lock);
+        
+        if (MemoryBlockCache.free_lists[index])
+        {
+            result = MemoryBlockCache.free_lists[index];
+            MemoryBlockCache.free_lists[index] = result->next;
+            --MemoryBlockCache.block_counts[index];
+            
+            MemoryBlockCache.retained_size -= MemoryBlockCapacity(result);
+        }
+        
+        UnlockSpinLock(&MemoryBlockCache.lock);
+        
+        if (result)
+        {
+            result->next = 0;
+        }
+        
+        else
+        {
+            result = AllocateMemoryBlock(((UMM)1 << size_class) - MEMORY_BLOCK_HEADER_SIZE);
+            
+            if (MemoryBlockCache.prefault_pages)
+            {
+                PrefaultMemoryBlock(result);
+            }
+        }
+    }
+    
+    else
+    {
+        result = AllocateMemoryBlock(block_size);
+    }
+    
+    return result;
+}
+
+inline void
+ReleaseMemoryBlock(Memory_Block* block)
+{
+    ResetMemoryBlock(block);
+    
+    // NOTE(soimn): Rounds down, so the block is only cached in a class it can hold every request of
+    UMM capacity  = MemoryBlockCapacity(block);
+    U8 size_class = HighestSetBit(capacity + MEMORY_BLOCK_HEADER_SIZE);
+    
+    bool was_cached = false;
+    
+    if (size_class >= MEMORY_BLOCK_CACHE_MIN_CLASS && size_class <= MEMORY_BLOCK_CACHE_MAX_CLASS)
+    {
+        U8 index = (U8)(size_class - MEMORY_BLOCK_CACHE_MIN_CLASS);
+        
+        LockSpinLock(&MemoryBlockCache.lock);
+        
+        if (MemoryBlockCache.retained_size + capacity <= MemoryBlockCache.retention_limit)
+        {
+            block->next = MemoryBlockCache.free_lists[index];
+            MemoryBlockCache.free_lists[index] = block;
+            ++MemoryBlockCache.block_counts[index];
+            
+            MemoryBlockCache.retained_size += capacity;
+            
+            was_cached = true;
+        }
+        
+        UnlockSpinLock(&MemoryBlockCache.lock);
+    }
+    
+    if (!was_cached)
+    {
+        FreeMemoryBlock(block);
+    }
+}
+
+// NOTE(soimn): Returns every cached block to the OS
+inline void
+TrimMemoryBlockCache()
+{
+    Memory_Block* free_lists[MEMORY_BLOCK_CACHE_CLASS_COUNT];
+    
+    LockSpinLock(&MemoryBlockCache.lock);
+    
+    for (U32 i = 0; i < MEMORY_BLOCK_CACHE_CLASS_COUNT; ++i)
+    {
+        free_lists[i] = MemoryBlockCache.free_lists[i];
+        
+        MemoryBlockCache.free_lists[i]   = 0;
+        MemoryBlockCache.block_counts[i] = 0;
+    }
+    
+    MemoryBlockCache.retained_size = 0;
+    
+    UnlockSpinLock(&MemoryBlockCache.lock);
+    
+    for (U32 i = 0; i < MEMORY_BLOCK_CACHE_CLASS_COUNT; ++i)
+    {
+        Memory_Block* block = free_lists[i];
+        
+        while (block)
+        {
+            Memory_Block* next = block->next;
+            FreeMemoryBlock(block);
+            block = next;
+        }
+    }
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
 inline void
 ClearArena(Memory_Arena* arena)
 {
@@ -90,7 +352,7 @@ ClearArena(Memory_Arena* arena)
     {
         Memory_Block* temp_ptr = block->prev;
         
-        FreeMemoryBlock(block);
+        ReleaseMemoryBlock(block);
         
         block = temp_ptr;
     }
@@ -140,7 +402,7 @@ PushSize(Memory_Arena* arena, UMM size, U8 alignment = 1)
             
             else
             {
-                Memory_Block* new_block = AllocateMemoryBlock(size + alignment - 1);
+                Memory_Block* new_block = AcquireMemoryBlock(size + alignment - 1);
                 
                 Memory_Block* next = arena->current_block->next;
                 
@@ -157,8 +419,11 @@ PushSize(Memory_Arena* arena, UMM size, U8 alignment = 1)
         
         else
         {
-            UMM block_size = MAX(size + alignment - 1, arena->block_size);
-            Memory_Block* new_block = AllocateMemoryBlock(block_size);
+            // NOTE(soimn): The block size of the arena includes the header, so a power of two block size is a
+            //              single size class
+            UMM payload_size = (arena->block_size > MEMORY_BLOCK_HEADER_SIZE ? arena->block_size - MEMORY_BLOCK_HEADER_SIZE : 0);
+            UMM block_size   = MAX(size + alignment - 1, payload_size);
+            Memory_Block* new_block = AcquireMemoryBlock(block_size);
             
             if (arena->current_block)
             {
@@ -197,240 +462,328 @@ struct Bucket_Array_Block
     U32 space;
 };
 
-struct Bucket_Array
-{
-    Memory_Arena* arena;
-    
-    Bucket_Array_Block* first_block;
-    Bucket_Array_Block* current_block;
-    
-    U32 num_elements;
-    U32 element_size;
-    U32 block_size;
-    U32 block_count;
-};
-
-inline Bucket_Array
-BucketArray(Memory_Arena* arena, UMM element_size, U32 block_size)
-{
-    Assert(element_size <= U32_MAX);
-    
-    Bucket_Array result = {};
-    result.arena        = arena;
-    result.element_size = (U32)element_size;
-    result.block_size   = block_size;
-    
-    return result;
-}
-
-#define BUCKET_ARRAY(arena, type, block_size) BucketArray(arena, RoundSize(sizeof(type), alignof(type)), block_size)
+// NOTE(soimn): The block list handling is shared between the typed and untyped bucket arrays. Only the 
+//              element addressing differs, which is where the compile time sizes of the typed arrays pay off.
 
-inline void*
-ElementAt(Bucket_Array* array, UMM index)
+inline Bucket_Array_Block*
+PushBucketArrayBlock(Memory_Arena* arena, Bucket_Array_Block** first_block, Bucket_Array_Block** current_block, U32* block_count, UMM element_size, U32 block_size)
 {
-    void* result = 0;
-    
-    UMM array_size = 0;
+    Bucket_Array_Block* result = 0;
     
-    if (array->block_count)
+    if (*current_block && (*current_block)->next)
     {
-        array_size = (array->block_count - 1) * array->block_size + array->current_block->offset;
+        result = (*current_block)->next;
     }
     
-    if (index < array_size)
+    else
     {
-        Bucket_Array_Block* scan = 0;
+        Assert(*block_count < U32_MAX);
         
-        UMM block_index  = index / array->block_size;
-        U32 block_offset = index % array->block_size;
+        UMM size = sizeof(Bucket_Array_Block) + element_size * block_size;
+        result   = (Bucket_Array_Block*)PushSize(arena, size, alignof(Bucket_Array_Block));
         
-        if (block_index == array->block_count - 1)
-        {
-            scan = array->current_block;
-        }
+        *result       = {};
+        result->space = block_size;
         
-        else if (block_index <= array->block_count / 2)
+        if (*first_block)
         {
-            scan = array->first_block;
-            
-            for (U32 i = 0; i < block_index; ++i)
-            {
-                scan = scan->next;
-            }
+            (*current_block)->next = result;
+            result->prev = *current_block;
         }
         
         else
         {
-            scan = array->current_block;
-            
-            for (U32 i = 0; (i < array->block_count - (block_index + 1)) && scan; ++i)
-            {
-                scan = scan->prev;
-            }
+            *first_block = result;
         }
         
-        if (scan)
-        {
-            result = (U8*)(scan + 1) + array->element_size * block_offset;
-        }
+        ++*block_count;
     }
     
+    *current_block = result;
+    
     return result;
 }
 
-inline void*
-PushElement(Bucket_Array* array)
+inline Bucket_Array_Block*
+BucketArrayBlockAt(Bucket_Array_Block* first_block, Bucket_Array_Block* current_block, U32 current_block_index, UMM block_index)
 {
-    void* result = 0;
+    Bucket_Array_Block* scan = 0;
     
-    if (!array->first_block || !array->current_block->space)
+    if (block_index == current_block_index)
     {
-        Assert(array->block_count < U32_MAX);
+        scan = current_block;
+    }
+    
+    else if (block_index <= current_block_index / 2)
+    {
+        scan = first_block;
         
-        if (array->current_block && array->current_block->next)
+        for (UMM i = 0; i < block_index && scan; ++i)
         {
-            array->current_block = array->current_block->next;
+            scan = scan->next;
         }
+    }
+    
+    else
+    {
+        scan = current_block;
         
-        else
+        for (UMM i = 0; i < current_block_index - block_index && scan; ++i)
         {
-            UMM block_size = sizeof(Bucket_Array_Block) + array->element_size * array->block_size;
-            Bucket_Array_Block* new_block = (Bucket_Array_Block*)PushSize(array->arena, block_size, alignof(Bucket_Array_Block));
-            *new_block = {};
-            
-            if (array->first_block)
-            {
-                array->current_block->next = new_block;
-                new_block->prev = array->current_block;
-            }
-            
-            else
-            {
-                array->first_block = new_block;
-            }
-            
-            array->current_block = new_block;
-            ++array->block_count;
+            scan = scan->prev;
         }
     }
     
-    result = (U8*)(array->current_block + 1) + array->element_size * array->current_block->offset;
-    ++array->current_block->offset;
-    --array->current_block->space;
-    ++array->num_elements;
-    
-    return result;
+    return scan;
+}
+
+inline U32
+BucketArrayCurrentBlockIndex(U32 num_elements, U32 block_size)
+{
+    return (num_elements ? (num_elements - 1) / block_size : 0);
 }
 
 inline void
-ResetArray(Bucket_Array* array)
+ResetBucketArrayBlocks(Bucket_Array_Block* first_block)
 {
-    Bucket_Array_Block* block = array->first_block;
-    
-    while (block)
+    for (Bucket_Array_Block* block = first_block; block; block = block->next)
     {
         block->space += block->offset;
         block->offset = 0;
-        block = block->next;
     }
-    
-    array->current_block = array->first_block;
 }
 
-struct Bucket_Array_Iterator
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): BlockSize is required to be a power of two, so the index math reduces to shifts and masks
+template<typename T, U32 BlockSize>
+struct Bucket_Array
 {
+    static_assert(BlockSize != 0 && (BlockSize & (BlockSize - 1)) == 0, "BlockSize must be a power of two");
+    static_assert(alignof(T) <= alignof(Bucket_Array_Block), "Element alignment exceeds block alignment");
+    
+    Memory_Arena* arena;
+    
+    Bucket_Array_Block* first_block;
     Bucket_Array_Block* current_block;
-    UMM current_index;
-    void* current;
-    U32 element_size;
-    U32 block_size;
+    
     U32 num_elements;
+    U32 block_count;
 };
 
-inline Bucket_Array_Iterator
-Iterate(Bucket_Array* array)
+template<typename T, U32 BlockSize>
+inline Bucket_Array<T, BlockSize>
+BucketArray(Memory_Arena* arena)
 {
-    Bucket_Array_Iterator iterator = {};
-    
-    if (array->block_count)
-    {
-        iterator.current_block = array->first_block;
-        iterator.current_index = 0;
-        iterator.current = array->first_block + 1;
-        
-        iterator.element_size = array->element_size;
-        iterator.block_size   = array->block_size;
-        iterator.num_elements = array->num_elements;
-    }
+    Bucket_Array<T, BlockSize> result = {};
+    result.arena = arena;
     
-    return iterator;
+    return result;
 }
 
-inline void
-Advance(Bucket_Array_Iterator* iterator)
+#define BUCKET_ARRAY(arena, type, block_size) BucketArray<type, block_size>(arena)
+
+template<typename T, U32 BlockSize>
+inline T*
+ElementAt(Bucket_Array<T, BlockSize>* array, UMM index)
 {
-    iterator->current = 0;
+    T* result = 0;
     
-    ++iterator->current_index;
-    
-    if (iterator->current_index < iterator->num_elements)
+    if (index < array->num_elements)
     {
-        U32 offset = iterator->current_index % iterator->block_size;
-        
-        if (offset == 0)
-        {
-            iterator->current_block = iterator->current_block->next;
-        }
+        U32 current_block_index = BucketArrayCurrentBlockIndex(array->num_elements, BlockSize);
+        Bucket_Array_Block* block = BucketArrayBlockAt(array->first_block, array->current_block, current_block_index, index / BlockSize);
         
-        if (iterator->current_block)
+        if (block)
         {
-            iterator->current = (U8*)(iterator->current_block + 1) + iterator->element_size * offset;
+            result = (T*)(block + 1) + index % BlockSize;
         }
     }
+    
+    return result;
 }
 
-inline void*
-PeekForward(Bucket_Array_Iterator* iterator, U32 advancement)
+template<typename T, U32 BlockSize>
+inline T*
+PushElement(Bucket_Array<T, BlockSize>* array)
 {
-    void* result = 0;
-    
-    UMM index  = iterator->current_index + advancement;
-    U32 offset = index % iterator->block_size;
+    if (!array->current_block || !array->current_block->space)
+    {
+        PushBucketArrayBlock(array->arena, &array->first_block, &array->current_block, &array->block_count, sizeof(T), BlockSize);
+    }
     
-    Assert(index > iterator->current_index);
+    T* result = (T*)(array->current_block + 1) + array->current_block->offset;
+    ++array->current_block->offset;
+    --array->current_block->space;
+    ++array->num_elements;
     
-    if (index < iterator->num_elements)
+    return result;
+}
+
+// NOTE(soimn): Copies the elements in one contiguous run per block instead of pushing them one at a time
+template<typename T, U32 BlockSize>
+inline void
+AppendElements(Bucket_Array<T, BlockSize>* array, T* elements, UMM count)
+{
+    while (count)
+    {
+        if (!array->current_block || !array->current_block->space)
+        {
+            PushBucketArrayBlock(array->arena, &array->first_block, &array->current_block, &array->block_count, sizeof(T), BlockSize);
+        }
+        
+        U32 run_length = (U32)MIN(count, array->current_block->space);
+        
+        CopyArray(elements, (T*)(array->current_block + 1) + array->current_block->offset, run_length);
+        
+        array->current_block->offset += run_length;
+        array->current_block->space  -= run_length;
+        array->num_elements          += run_length;
+        
+        elements += run_length;
+        count    -= run_length;
+    }
+}
+
+template<typename T, U32 BlockSize>
+inline void
+ResetArray(Bucket_Array<T, BlockSize>* array)
+{
+    ResetBucketArrayBlocks(array->first_block);
+    
+    array->current_block = array->first_block;
+    array->num_elements  = 0;
+}
+
+template<typename T, U32 BlockSize>
+struct Bucket_Array_Iterator
+{
+    Bucket_Array_Block* current_block;
+    UMM current_index;
+    T* current;
+    U32 num_elements;
+};
+
+template<typename T, U32 BlockSize>
+inline Bucket_Array_Iterator<T, BlockSize>
+Iterate(Bucket_Array<T, BlockSize>* array)
+{
+    Bucket_Array_Iterator<T, BlockSize> iterator = {};
+    
+    if (array->num_elements)
+    {
+        iterator.current_block = array->first_block;
+        iterator.current       = (T*)(array->first_block + 1);
+        iterator.num_elements  = array->num_elements;
+    }
+    
+    return iterator;
+}
+
+template<typename T, U32 BlockSize>
+inline void
+Advance(Bucket_Array_Iterator<T, BlockSize>* iterator)
+{
+    iterator->current = 0;
+    
+    ++iterator->current_index;
+    
+    if (iterator->current_index < iterator->num_elements)
     {
+        UMM offset = iterator->current_index % BlockSize;
         
-        UMM block_index = index / iterator->block_size;
-        UMM current_block_index = iterator->current_index / iterator->block_size;
+        if (offset == 0)
+        {
+            iterator->current_block = iterator->current_block->next;
+        }
         
-        if (block_index > current_block_index)
+        if (iterator->current_block)
         {
-            Bucket_Array_Block* block = iterator->current_block;
-            
-            for (U32 i = 0; (i < block_index - current_block_index) && block; ++i)
-            {
-                block = block->next;
-            }
-            
-            if (block)
-            {
-                result = (U8*)(block + 1) + iterator->element_size * offset;
-            }
+            iterator->current = (T*)(iterator->current_block + 1) + offset;
         }
+    }
+}
+
+template<typename T, U32 BlockSize>
+inline T*
+PeekForward(Bucket_Array_Iterator<T, BlockSize>* iterator, U32 advancement)
+{
+    T* result = 0;
+    
+    UMM index = iterator->current_index + advancement;
+    
+    if (index < iterator->num_elements)
+    {
+        Bucket_Array_Block* block = iterator->current_block;
         
-        else
+        for (UMM i = iterator->current_index / BlockSize; i < index / BlockSize && block; ++i)
+        {
+            block = block->next;
+        }
+        
+        if (block)
         {
-            result = (U8*)(iterator->current_block + 1) + iterator->element_size * offset;
+            result = (T*)(block + 1) + index % BlockSize;
         }
     }
     
     return result;
 }
 
+// NOTE(soimn): Range-for support, e.g. for (Token& token : tokens)
+template<typename T, U32 BlockSize>
+inline Bucket_Array_Iterator<T, BlockSize>
+begin(Bucket_Array<T, BlockSize>& array)
+{
+    return Iterate(&array);
+}
+
+template<typename T, U32 BlockSize>
+inline Bucket_Array_Iterator<T, BlockSize>
+end(Bucket_Array<T, BlockSize>& array)
+{
+    Bucket_Array_Iterator<T, BlockSize> iterator = {};
+    iterator.current_index = array.num_elements;
+    iterator.num_elements  = array.num_elements;
+    
+    return iterator;
+}
+
+template<typename T, U32 BlockSize>
+inline T&
+operator * (const Bucket_Array_Iterator<T, BlockSize>& iterator)
+{
+    return *iterator.current;
+}
+
+template<typename T, U32 BlockSize>
+inline Bucket_Array_Iterator<T, BlockSize>&
+operator ++ (Bucket_Array_Iterator<T, BlockSize>& iterator)
+{
+    Advance(&iterator);
+    return iterator;
+}
+
+template<typename T, U32 BlockSize>
+inline bool
+operator != (const Bucket_Array_Iterator<T, BlockSize>& a, const Bucket_Array_Iterator<T, BlockSize>& b)
+{
+    return (a.current_index != b.current_index);
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+template<typename T, U32 BlockSize>
 struct Free_List_Bucket_Array
 {
+    static_assert(BlockSize != 0 && (BlockSize & (BlockSize - 1)) == 0, "BlockSize must be a power of two");
+    static_assert(sizeof(T) >= sizeof(void*), "Elements must be large enough to hold a free list link");
+    static_assert(alignof(T) <= alignof(Bucket_Array_Block), "Element alignment exceeds block alignment");
+    
     void** free_list;
     
     Memory_Arena* arena;
@@ -438,19 +791,127 @@ struct Free_List_Bucket_Array
     Bucket_Array_Block* first_block;
     Bucket_Array_Block* current_block;
     
-    U32 pad_;
+    U32 num_elements;
+    U32 block_count;
+};
+
+template<typename T, U32 BlockSize>
+inline Free_List_Bucket_Array<T, BlockSize>
+FreeListBucketArray(Memory_Arena* arena)
+{
+    Free_List_Bucket_Array<T, BlockSize> result = {};
+    result.arena = arena;
+    
+    return result;
+}
+
+#define FREE_LIST_BUCKET_ARRAY(arena, type, block_size) FreeListBucketArray<type, block_size>(arena)
+
+// NOTE(soimn): This does not check if the element is freed or not
+template<typename T, U32 BlockSize>
+inline T*
+ElementAt(Free_List_Bucket_Array<T, BlockSize>* array, UMM index)
+{
+    T* result = 0;
+    
+    if (index < array->num_elements)
+    {
+        U32 current_block_index = BucketArrayCurrentBlockIndex(array->num_elements, BlockSize);
+        Bucket_Array_Block* block = BucketArrayBlockAt(array->first_block, array->current_block, current_block_index, index / BlockSize);
+        
+        if (block)
+        {
+            result = (T*)(block + 1) + index % BlockSize;
+        }
+    }
+    
+    return result;
+}
+
+template<typename T, U32 BlockSize>
+inline T*
+PushElement(Free_List_Bucket_Array<T, BlockSize>* array)
+{
+    T* result = 0;
+    
+    if (array->free_list)
+    {
+        result = (T*)array->free_list;
+        array->free_list = (void**)*array->free_list;
+    }
+    
+    else
+    {
+        if (!array->current_block || !array->current_block->space)
+        {
+            PushBucketArrayBlock(array->arena, &array->first_block, &array->current_block, &array->block_count, sizeof(T), BlockSize);
+        }
+        
+        result = (T*)(array->current_block + 1) + array->current_block->offset;
+        ++array->current_block->offset;
+        --array->current_block->space;
+        ++array->num_elements;
+    }
+    
+    return result;
+}
+
+template<typename T, U32 BlockSize>
+inline void
+RemoveElement(Free_List_Bucket_Array<T, BlockSize>* array, T* element)
+{
+    bool is_valid = false;
+    
+    if (element)
+    {
+        for (Bucket_Array_Block* scan = array->first_block; scan; scan = scan->next)
+        {
+            T* block_start = (T*)(scan + 1);
+            
+            if (block_start <= element && element < block_start + BlockSize)
+            {
+                is_valid = (scan != array->current_block || (U32)(element - block_start) < scan->offset);
+                break;
+            }
+        }
+    }
+    
+    Assert(is_valid == true);
+    
+    if (is_valid)
+    {
+        *(void**)element = array->free_list;
+        array->free_list = (void**)element;
+    }
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): Untyped variants for code that only knows the element size at runtime. These are thin 
+//              wrappers around the shared block list handling and pay for a runtime multiply per access.
+
+struct Untyped_Bucket_Array
+{
+    Memory_Arena* arena;
+    
+    Bucket_Array_Block* first_block;
+    Bucket_Array_Block* current_block;
+    
+    U32 num_elements;
     U32 element_size;
     U32 block_size;
     U32 block_count;
 };
 
-inline Free_List_Bucket_Array
-FreeListBucketArray(Memory_Arena* arena, UMM element_size, U32 block_size)
+inline Untyped_Bucket_Array
+UntypedBucketArray(Memory_Arena* arena, UMM element_size, U32 block_size)
 {
     Assert(element_size <= U32_MAX);
-    Assert(element_size >= sizeof(void*));
+    Assert(block_size != 0);
     
-    Free_List_Bucket_Array result = {};
+    Untyped_Bucket_Array result = {};
     result.arena        = arena;
     result.element_size = (U32)element_size;
     result.block_size   = block_size;
@@ -458,17 +919,126 @@ FreeListBucketArray(Memory_Arena* arena, UMM element_size, U32 block_size)
     return result;
 }
 
-#define FREE_LIST_BUCKET_ARRAY(arena, type, block_size) FreeListBucketArray(arena, RoundSize(sizeof(type), alignof(type)), block_size)
+inline void*
+ElementAt(Untyped_Bucket_Array* array, UMM index)
+{
+    void* result = 0;
+    
+    if (index < array->num_elements)
+    {
+        U32 current_block_index = BucketArrayCurrentBlockIndex(array->num_elements, array->block_size);
+        Bucket_Array_Block* block = BucketArrayBlockAt(array->first_block, array->current_block, current_block_index, index / array->block_size);
+        
+        if (block)
+        {
+            result = (U8*)(block + 1) + array->element_size * (index % array->block_size);
+        }
+    }
+    
+    return result;
+}
+
+inline void*
+PushElement(Untyped_Bucket_Array* array)
+{
+    if (!array->current_block || !array->current_block->space)
+    {
+        PushBucketArrayBlock(array->arena, &array->first_block, &array->current_block, &array->block_count, array->element_size, array->block_size);
+    }
+    
+    void* result = (U8*)(array->current_block + 1) + array->element_size * array->current_block->offset;
+    ++array->current_block->offset;
+    --array->current_block->space;
+    ++array->num_elements;
+    
+    return result;
+}
+
+inline void
+ResetArray(Untyped_Bucket_Array* array)
+{
+    ResetBucketArrayBlocks(array->first_block);
+    
+    array->current_block = array->first_block;
+    array->num_elements  = 0;
+}
+
+struct Untyped_Bucket_Array_Iterator
+{
+    Bucket_Array_Block* current_block;
+    UMM current_index;
+    void* current;
+    U32 element_size;
+    U32 block_size;
+    U32 num_elements;
+};
+
+inline Untyped_Bucket_Array_Iterator
+Iterate(Untyped_Bucket_Array* array)
+{
+    Untyped_Bucket_Array_Iterator iterator = {};
+    
+    if (array->num_elements)
+    {
+        iterator.current_block = array->first_block;
+        iterator.current       = array->first_block + 1;
+        iterator.element_size  = array->element_size;
+        iterator.block_size    = array->block_size;
+        iterator.num_elements  = array->num_elements;
+    }
+    
+    return iterator;
+}
+
+inline void
+Advance(Untyped_Bucket_Array_Iterator* iterator)
+{
+    iterator->current = 0;
+    
+    ++iterator->current_index;
+    
+    if (iterator->current_index < iterator->num_elements)
+    {
+        UMM offset = iterator->current_index % iterator->block_size;
+        
+        if (offset == 0)
+        {
+            iterator->current_block = iterator->current_block->next;
+        }
+        
+        if (iterator->current_block)
+        {
+            iterator->current = (U8*)(iterator->current_block + 1) + iterator->element_size * offset;
+        }
+    }
+}
+
+struct Untyped_Free_List_Bucket_Array
+{
+    void** free_list;
+    Untyped_Bucket_Array bucket_array;
+};
+
+inline Untyped_Free_List_Bucket_Array
+UntypedFreeListBucketArray(Memory_Arena* arena, UMM element_size, U32 block_size)
+{
+    Assert(element_size >= sizeof(void*));
+    
+    Untyped_Free_List_Bucket_Array result = {};
+    result.bucket_array = UntypedBucketArray(arena, element_size, block_size);
+    
+    return result;
+}
 
 // NOTE(soimn): This does not check if the element is freed or not
 inline void*
-ElementAt(Free_List_Bucket_Array* array, UMM index)
+ElementAt(Untyped_Free_List_Bucket_Array* array, UMM index)
 {
-    return ElementAt((Bucket_Array*)&array->arena, index);
+    return ElementAt(&array->bucket_array, index);
 }
 
 inline void*
-PushElement(Free_List_Bucket_Array* array)
+PushElement(Untyped_Free_List_Bucket_Array* array)
 {
     void* result = 0;
     
@@ -480,62 +1050,35 @@ PushElement(Free_List_Bucket_Array* array)
     
     else
     {
-        if (!array->first_block || !array->current_block->space)
-        {
-            Assert(array->block_count < U32_MAX);
-            
-            UMM block_size = sizeof(Bucket_Array_Block) + array->element_size * array->block_size;
-            Bucket_Array_Block* new_block = (Bucket_Array_Block*)PushSize(array->arena, block_size, alignof(Bucket_Array_Block));
-            *new_block = {};
-            
-            if (array->first_block)
-            {
-                array->current_block->next = new_block;
-                new_block->prev = array->current_block;
-            }
-            
-            else
-            {
-                array->first_block = new_block;
-            }
-            
-            array->current_block = new_block;
-            ++array->block_count;
-        }
-        
-        result = (U8*)(array->current_block + 1) + array->element_size * array->current_block->offset;
-        ++array->current_block->offset;
-        --array->current_block->space;
+        result = PushElement(&array->bucket_array);
     }
     
     return result;
 }
 
 inline void
-RemoveElement(Free_List_Bucket_Array* array, void* element)
+RemoveElement(Untyped_Free_List_Bucket_Array* array, void* element)
 {
     bool is_valid = false;
     
+    Untyped_Bucket_Array* bucket_array = &array->bucket_array;
+    
     if (element)
     {
         U8* element_u8 = (U8*)element;
-        Bucket_Array_Block* scan = array->first_block;
         
-        while (scan)
+        for (Bucket_Array_Block* scan = bucket_array->first_block; scan; scan = scan->next)
         {
             U8* block_start = (U8*)(scan + 1);
-            UMM offset = (UMM)(element_u8 - block_start);
-            if (block_start <= element_u8 && element_u8 < block_start + array->block_size)
+            
+            if (block_start <= element_u8 && element_u8 < block_start + (UMM)bucket_array->element_size * bucket_array->block_size)
             {
-                if (offset % array->element_size == 0 && (scan != array->current_block || offset < array->current_block->offset))
-                {
-                    is_valid = true;
-                }
+                UMM offset = (UMM)(element_u8 - block_start);
                 
+                is_valid = (offset % bucket_array->element_size == 0 && 
+                            (scan != bucket_array->current_block || offset / bucket_array->element_size < scan->offset));
                 break;
             }
-            
-            scan = scan->next;
         }
     }
     
@@ -546,4 +1089,128 @@ RemoveElement(Free_List_Bucket_Array* array, void* element)
         *(void**)element = array->free_list;
         array->free_list = (void**)element;
     }
+}
+
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): A contiguous array which reserves its entire address range up front and commits pages as it 
+//              grows. Elements never move, so pointers into the array stay valid, and there is never a copy 
+//              on growth. The reservation only costs address space, so it is fine to be generous.
+
+#define DYNAMIC_ARRAY_DEFAULT_RESERVE GIGABYTES(1)
+#define DYNAMIC_ARRAY_COMMIT_SIZE KILOBYTES(64)
+
+template<typename T>
+struct Dynamic_Array
+{
+    T* data;
+    UMM count;
+    UMM committed_count;
+    UMM reserved_count;
+};
+
+template<typename T>
+inline Dynamic_Array<T>
+DynamicArray(UMM reserved_size = DYNAMIC_ARRAY_DEFAULT_RESERVE)
+{
+    Dynamic_Array<T> result = {};
+    
+    reserved_size += (DYNAMIC_ARRAY_COMMIT_SIZE - reserved_size % DYNAMIC_ARRAY_COMMIT_SIZE) % DYNAMIC_ARRAY_COMMIT_SIZE;
+    
+    result.data           = (T*)ReserveMemory(reserved_size);
+    result.reserved_count = reserved_size / sizeof(T);
+    
+    return result;
+}
+
+template<typename T>
+inline void
+Reserve(Dynamic_Array<T>* array, UMM count)
+{
+    if (count > array->committed_count)
+    {
+        Assert(count <= array->reserved_count, "Dynamic array exceeded its reserved address range");
+        
+        UMM committed_size = array->committed_count * sizeof(T);
+        committed_size    -= committed_size % DYNAMIC_ARRAY_COMMIT_SIZE;
+        
+        UMM required_size = count * sizeof(T);
+        required_size    += (DYNAMIC_ARRAY_COMMIT_SIZE - required_size % DYNAMIC_ARRAY_COMMIT_SIZE) % DYNAMIC_ARRAY_COMMIT_SIZE;
+        
+        CommitMemory((U8*)array->data + committed_size, required_size - committed_size);
+        
+        array->committed_count = MIN(required_size / sizeof(T), array->reserved_count);
+    }
+}
+
+template<typename T>
+inline T*
+PushElements(Dynamic_Array<T>* array, UMM count)
+{
+    Reserve(array, array->count + count);
+    
+    T* result = array->data + array->count;
+    array->count += count;
+    
+    return result;
+}
+
+template<typename T>
+inline T*
+PushElement(Dynamic_Array<T>* array)
+{
+    return PushElements(array, 1);
+}
+
+template<typename T>
+inline void
+PopElements(Dynamic_Array<T>* array, UMM count)
+{
+    Assert(count <= array->count);
+    
+    array->count -= count;
+}
+
+template<typename T>
+inline T*
+ElementAt(Dynamic_Array<T>* array, UMM index)
+{
+    return (index < array->count ? array->data + index : 0);
+}
+
+// NOTE(soimn): Keeps the committed pages around for reuse
+template<typename T>
+inline void
+ResetArray(Dynamic_Array<T>* array)
+{
+    array->count = 0;
+}
+
+template<typename T>
+inline void
+FreeArray(Dynamic_Array<T>* array)
+{
+    if (array->data)
+    {
+        ReleaseMemory(array->data);
+    }
+    
+    *array = {};
+}
+
+template<typename T>
+inline T*
+begin(Dynamic_Array<T>& array)
+{
+    return array.data;
+}
+
+template<typename T>
+inline T*
+end(Dynamic_Array<T>& array)
+{
+    return array.data + array.count;
 }
\ No newline at end of file
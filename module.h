@@ -0,0 +1,423 @@
+#pragma once
+
+#include "common.h"
+#include "atomics.h"
+#include "memory.h"
+#include "string.h"
+#include "diagnostics.h"
+#include "jobs.h"
+#include "lexer.h"
+#include "ast.h"
+#include "parser.h"
+#include "ast_cache.h"
+
+inline bool
+ReadEntireFile(const char* path, Memory_Arena* arena, String* contents);
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): The module is the merged view of every file in a compilation. Files keep the order they were given
+//              in, and the ID of a file is its index plus one, so IDs, and with them the order diagnostics are
+//              emitted in, do not depend on which worker parsed which file.
+//
+//              Parsing is done in three phases, which are each a ParallelFor on the job system:
+//              - every file is read, tokenized and split into runs of top level declarations,
+//              - the runs of all files are parsed into a syntax tree fragment owned by the worker that took them,
+//              - the fragments of each file are stitched together into its syntax tree, in source order.
+//              Splitting the files lets a single large file be parsed by several workers, and the work in every
+//              phase is done one item per batch, so a few large items do not leave the other workers idle.
+//
+//              Every worker has its own arena in the module, which holds the source text of the files it read, since
+//              the tokens of a syntax tree point into it. The only shared state is the diagnostics engine and the
+//              memory block cache, which are both locked. The parser of a worker is kept between the jobs it runs,
+//              which is safe since none of the jobs of a phase wait on a counter.
+//
+//              With the AST cache enabled, a file whose cache matches its contents is loaded from the cache when it
+//              is read, and skips the other phases. The trees of the other files are cached as they are stitched,
+//              unless a diagnostic was reported for the file, since loading it from the cache would lose them.
+
+// NOTE(soimn): Declarations are parsed in runs of at least this many tokens, as parsing a single small declaration
+//              is cheaper than handing it out
+#define MODULE_DECLARATION_RUN_TOKENS 4096
+
+#define MODULE_AST_CACHE_EXTENSION ".gnast"
+
+struct Source_File
+{
+    const char* path;
+    File_ID id;
+    bool is_loaded;
+    bool is_cached;
+    bool has_diagnostics;
+    
+    U64 content_hash;
+    U64 content_size;
+    
+    Dynamic_Array<Token> tokens;
+    Token_Range* runs;
+    U32 run_count;
+    U32 first_task;
+    
+    Syntax_Tree tree;
+};
+
+struct Module
+{
+    Memory_Arena arena;
+    
+    Source_File* files;
+    U32 file_count;
+    
+    Memory_Arena worker_arenas[JOB_SYSTEM_MAX_WORKERS];
+    U32 worker_count;
+};
+
+// NOTE(soimn): A run of top level declarations, and where the nodes it was parsed to ended up in the fragment of
+//              the worker that parsed it. The declarations list is the last thing pushed to the extra data, so the
+//              extra data of the nodes ends where it starts.
+struct Declaration_Task
+{
+    Source_File* file;
+    Token_Range tokens;
+    
+    U32 worker;
+    U32 node_start;
+    U32 node_end;
+    U32 extra_start;
+    AST_Range declarations;
+};
+
+struct Parse_Worker;
+
+struct Parse_Batch
+{
+    Module* module;
+    Diagnostics_Engine* diagnostics;
+    Parse_Worker* workers;
+    
+    Declaration_Task* tasks;
+    U32 task_count;
+    UMM token_count;
+    
+    bool lazy_function_bodies;
+    bool use_ast_cache;
+};
+
+struct Parse_Worker
+{
+    bool is_parsing;
+    
+    Syntax_Tree fragment;
+    Parser parser;
+};
+
+// NOTE(soimn): The cache of a file is kept next to it, as the path of the file with the cache extension appended
+inline const char*
+ASTCachePath(const char* path, Memory_Arena* arena)
+{
+    UMM path_length      = StringLength(path);
+    UMM extension_length = sizeof(MODULE_AST_CACHE_EXTENSION) - 1;
+    
+    char* result = (char*)PushSize(arena, path_length + extension_length + 1, 1);
+    
+    Copy((void*)path, result, MAX(path_length, 1));
+    Copy((void*)MODULE_AST_CACHE_EXTENSION, result + path_length, extension_length + 1);
+    
+    return result;
+}
+
+inline void
+LoadFilesJob(Job_Worker* worker, void* data, UMM start, UMM end)
+{
+    Parse_Batch* batch  = (Parse_Batch*)data;
+    Module* module      = batch->module;
+    Memory_Arena* arena = &module->worker_arenas[worker->index];
+    
+    for (UMM file_index = start; file_index < end; ++file_index)
+    {
+        Source_File* file = &module->files[file_index];
+        
+        // NOTE(soimn): The file is read into scratch memory, since appending it to the source stream copies it
+        String contents = {};
+        
+        bool is_read = ReadEntireFile(file->path, &worker->scratch, &contents);
+        
+        if (is_read)
+        {
+            file->content_hash = ContentHash(contents);
+            file->content_size = contents.size;
+        }
+        
+        if (is_read && batch->use_ast_cache &&
+            LoadASTCache(ASTCachePath(file->path, &worker->scratch), file->id, file->content_hash, file->content_size, &file->tree))
+        {
+            file->is_loaded = true;
+            file->is_cached = true;
+        }
+        
+        else if (is_read)
+        {
+            String_Stream stream = StringStream(arena);
+            Append(&stream, contents);
+            
+            file->tokens    = Tokenize(stream, file->id, batch->diagnostics);
+            file->is_loaded = true;
+            
+            U32 token_count = (U32)file->tokens.count;
+            
+            Dynamic_Array<Token_Range> declarations = DynamicArray<Token_Range>(token_count * sizeof(Token_Range));
+            SplitTopLevelDeclarations(file->tokens.data, token_count, &declarations);
+            
+            // NOTE(soimn): Merges neighbouring declarations into runs, there are never more runs than declarations
+            file->runs      = PushArray(arena, Token_Range, MAX(declarations.count, 1));
+            file->run_count = 0;
+            
+            for (UMM i = 0; i < declarations.count; ++i)
+            {
+                Token_Range* run = (file->run_count != 0 ? &file->runs[file->run_count - 1] : 0);
+                
+                if (run != 0 && run->end - run->start < MODULE_DECLARATION_RUN_TOKENS)
+                {
+                    run->end = declarations.data[i].end;
+                }
+                
+                else
+                {
+                    file->runs[file->run_count++] = declarations.data[i];
+                }
+            }
+            
+            FreeArray(&declarations);
+        }
+        
+        else
+        {
+            Diagnose(batch->diagnostics, Error, SourceLocation(file->id, 0, 0), CannotReadFile);
+        }
+        
+        ResetArena(&worker->scratch);
+    }
+}
+
+inline void
+ParseDeclarationsJob(Job_Worker* worker, void* data, UMM start, UMM end)
+{
+    Parse_Batch* batch         = (Parse_Batch*)data;
+    Parse_Worker* parse_worker = &batch->workers[worker->index];
+    
+    if (!parse_worker->is_parsing)
+    {
+        // NOTE(soimn): Node 0 of the fragment is a placeholder, since an index of 0 in the fragment means NODE_NONE
+        parse_worker->fragment = SyntaxTreeStorage((batch->token_count + batch->task_count + 1) * SYNTAX_TREE_NODES_PER_TOKEN);
+        PushNode(&parse_worker->fragment, ASTNode_Error, 0);
+        
+        parse_worker->parser     = ParserState(&parse_worker->fragment, batch->diagnostics, PARSER_DEFAULT_MAX_ERRORS, batch->lazy_function_bodies);
+        parse_worker->is_parsing = true;
+    }
+    
+    Syntax_Tree* fragment = &parse_worker->fragment;
+    
+    for (UMM i = start; i < end; ++i)
+    {
+        Declaration_Task* task = &batch->tasks[i];
+        
+        task->worker      = worker->index;
+        task->node_start  = NodeCount(fragment);
+        task->extra_start = (U32)fragment->extra_data.count;
+        
+        BeginParsingRange(&parse_worker->parser, task->file->tokens.data, task->tokens.start, task->tokens.end);
+        
+        task->declarations = ParseTopLevelDeclarations(&parse_worker->parser);
+        task->node_end     = NodeCount(fragment);
+    }
+}
+
+inline void
+StitchFilesJob(Job_Worker* worker, void* data, UMM start, UMM end)
+{
+    Parse_Batch* batch = (Parse_Batch*)data;
+    Module* module     = batch->module;
+    
+    for (UMM i = start; i < end; ++i)
+    {
+        Source_File* file = &module->files[i];
+        
+        if (!file->is_loaded || file->is_cached) continue;
+        
+        Syntax_Tree* tree = &file->tree;
+        *tree = SyntaxTree(file->tokens);
+        
+        // NOTE(soimn): The translation unit is pushed first so that it gets index 0, see NODE_NONE
+        Node_Index translation_unit = PushNode(tree, ASTNode_TranslationUnit, 0);
+        
+        U32 declaration_count = 0;
+        for (U32 i = 0; i < file->run_count; ++i)
+        {
+            Declaration_Task* task = &batch->tasks[file->first_task + i];
+            declaration_count += task->declarations.end - task->declarations.start;
+        }
+        
+        // NOTE(soimn): The declarations are collected on the side, since the list has to be contiguous in the
+        //              extra data while every task appends extra data of its own
+        Node_Index* declarations = PushArray(&worker->scratch, Node_Index, MAX(declaration_count, 1));
+        U32 declarations_end     = 0;
+        
+        for (U32 i = 0; i < file->run_count; ++i)
+        {
+            Declaration_Task* task  = &batch->tasks[file->first_task + i];
+            Syntax_Tree* fragment   = &batch->workers[task->worker].fragment;
+            
+            AST_Relocation relocation = AppendNodes(tree, fragment, task->node_start, task->node_end,
+                                                    task->extra_start, task->declarations.start);
+            
+            for (U32 j = task->declarations.start; j < task->declarations.end; ++j)
+            {
+                declarations[declarations_end++] = RelocateNode(relocation, fragment->extra_data.data[j]);
+            }
+        }
+        
+        U32 list_start = (U32)tree->extra_data.count;
+        
+        if (declaration_count != 0)
+        {
+            CopyArray(declarations, PushElements(&tree->extra_data, declaration_count), declaration_count);
+        }
+        
+        *NodeData(tree, translation_unit) = {list_start, list_start + declaration_count};
+        
+        if (batch->use_ast_cache && !file->has_diagnostics)
+        {
+            WriteASTCache(ASTCachePath(file->path, &worker->scratch), tree, file->content_hash, file->content_size, &worker->scratch);
+        }
+        
+        ResetArena(&worker->scratch);
+    }
+}
+
+// NOTE(soimn): Lexes and parses every file on the job system of the worker, which has to be the worker of the
+//              calling thread. With lazy_function_bodies the bodies of functions are left for ParseFunctionBody, and
+//              with use_ast_cache files are loaded from and saved to the AST cache, which takes precedence over lazy
+//              bodies.
+//
+//              The error limit of the parser applies to each run of declarations rather than to each file, since
+//              runs are parsed independently of each other, and a shared count would make the diagnostics depend on
+//              which worker got to a run first. A file with more than PARSER_DEFAULT_MAX_ERRORS errors in one run
+//              skips the rest of that run, and the runs after it are still parsed and report their own errors. The
+//              trees and diagnostics are therefore the same as those of ParseTokens only while no run of the file
+//              hits the limit, and do not depend on the number of workers either way.
+inline Module
+ParseFiles(Job_Worker* worker, const char** paths, U32 path_count, Diagnostics_Engine* diagnostics,
+           bool lazy_function_bodies = false, bool use_ast_cache = false)
+{
+    Assert(path_count < (1 << SOURCE_LOCATION_FILE_BITS), "Too many files for a Source_Location");
+    
+    Module module = {};
+    module.file_count = path_count;
+    module.files      = PushArray(&module.arena, Source_File, MAX(path_count, 1));
+    
+    for (U32 i = 0; i < path_count; ++i)
+    {
+        module.files[i] = {};
+        module.files[i].path = paths[i];
+        module.files[i].id   = (File_ID)(i + 1);
+        
+        SetDiagnosticsFileName(diagnostics, module.files[i].id, String{(U8*)paths[i], StringLength(paths[i])});
+    }
+    
+    module.worker_count = worker->system->worker_count;
+    
+    Parse_Worker workers[JOB_SYSTEM_MAX_WORKERS];
+    
+    Parse_Batch batch = {};
+    batch.module      = &module;
+    batch.diagnostics = diagnostics;
+    batch.workers     = workers;
+    
+    // NOTE(soimn): A tree loaded from the cache is read only, so its lazy bodies could never be parsed, and trees
+    //              are parsed in full when they are cached
+    batch.lazy_function_bodies = lazy_function_bodies && !use_ast_cache;
+    batch.use_ast_cache        = use_ast_cache;
+    
+    for (U32 i = 0; i < module.worker_count; ++i)
+    {
+        workers[i] = {};
+    }
+    
+    ParallelFor(worker, module.file_count, 1, LoadFilesJob, &batch);
+    
+    Memory_Arena task_arena = {};
+    
+    for (U32 i = 0; i < module.file_count; ++i)
+    {
+        module.files[i].first_task = batch.task_count;
+        
+        batch.task_count  += module.files[i].run_count;
+        batch.token_count += module.files[i].tokens.count;
+    }
+    
+    batch.tasks = PushArray(&task_arena, Declaration_Task, MAX(batch.task_count, 1));
+    
+    for (U32 i = 0; i < module.file_count; ++i)
+    {
+        Source_File* file = &module.files[i];
+        
+        for (U32 j = 0; j < file->run_count; ++j)
+        {
+            batch.tasks[file->first_task + j] = {};
+            batch.tasks[file->first_task + j].file   = file;
+            batch.tasks[file->first_task + j].tokens = file->runs[j];
+        }
+    }
+    
+    ParallelFor(worker, batch.task_count, 1, ParseDeclarationsJob, &batch);
+    
+    if (use_ast_cache)
+    {
+        InitDiagnosticsStorage(diagnostics);
+        
+        for (Diagnostic& diagnostic : diagnostics->diagnostics)
+        {
+            File_ID file = LocationFile(diagnostic.location);
+            
+            if (file != 0 && file <= module.file_count) module.files[file - 1].has_diagnostics = true;
+        }
+    }
+    
+    ParallelFor(worker, module.file_count, 1, StitchFilesJob, &batch);
+    
+    for (U32 i = 0; i < module.worker_count; ++i)
+    {
+        if (workers[i].is_parsing)
+        {
+            FreeParserState(&workers[i].parser);
+            FreeSyntaxTree(&workers[i].fragment);
+        }
+    }
+    
+    ClearArena(&task_arena);
+    
+    return module;
+}
+
+inline void
+FreeModule(Module* module)
+{
+    for (U32 i = 0; i < module->file_count; ++i)
+    {
+        if (module->files[i].is_loaded)
+        {
+            FreeSyntaxTree(&module->files[i].tree);
+        }
+    }
+    
+    for (U32 i = 0; i < module->worker_count; ++i)
+    {
+        ClearArena(&module->worker_arenas[i]);
+    }
+    
+    ClearArena(&module->arena);
+    
+    *module = {};
+}
@@ -2,54 +2,17 @@
 
 #include "common.h"
 #include "error_handling.h"
+#include "diagnostics.h"
 #include "lexer.h"
 #include "ast.h"
 
-inline ret_type
-ParseTypedEnum()
-{
-    token      = GetToken(&lexer);
-    peek_token = PeekToken(&lexer);
-    
-    if (peek_token == Token_Identifier)
-    {
-        token      = GetToken(&lexer);
-        peek_token = PeekToken(&lexer);
-        
-        if (peek_token.type == Token_OpenBrace)
-        {
-            token      = GetToken(&lexer);
-            peek_token = PeekToken(&lexer);
-            
-            // ParseEnumBody
-        }
-        
-        else
-        {
-            //// ERROR: Unexpected token in enum declaration
-        }
-    }
-    
-    else
-    {
-        //// ERROR: Expected type name after colon in enum declaration
-    }
-}
-
-inline ret_type
-ParseStringStream(String_Stream stream)
-{
-    Lexer lexer = LexStringStream(stream);
-    
-    do
-    {
-        /*
+/*
 ** NOTE(soimn): This is a mock grammar and may not be remotely correct
 **
 ** translation_unit : external_decl_or_def translation_unit
 **                  | external_decl_or_def
 **                  ;
-** 
+**
 ** external_decl_or_def : type_decl
 **                      | type_def
 **                      | function_decl
@@ -79,90 +42,1973 @@ ParseStringStream(String_Stream stream)
 **          | tags type ident ';'
 **          | tags type ident '=' expression ';'
 **          ;
+**
+** tags : tag tags
+**      |
+**      ;
+**
+** tag : '@' ident
+**     | '@' ident '(' ')'
+**     | '@' ident '(' expression_list ')'
+**     ;
+**
+** NOTE(soimn): Linkage tags have the same syntax as other tags, and are told apart by their name, so tags and
+**              linkage_tags are parsed as one list.
 */
+
+// NOTE(soimn): Error recovery is done in panic mode. The first error in a construct is reported, and the parser
+//              then stays quiet until the enclosing list (the translation unit, a struct or enum body, or a
+//              block) resynchronizes on a ';', a '}' or a top level keyword. Construct parsers return an error
+//              node when they fail, so the AST keeps a placeholder for every construct that did not parse.
+//
+//              Children of variable length lists are collected on the scratch stack while the list is parsed,
+//              and moved to the extra data of the tree as one contiguous run when it ends. Lists nest strictly,
+//              so the runs of inner lists are always above the runs of the lists enclosing them.
+
+#define PARSER_DEFAULT_MAX_ERRORS 32
+#define PARSER_EXPRESSION_STACK_RESERVE MEGABYTES(64)
+#define PARSER_SCRATCH_RESERVE MEGABYTES(64)
+
+enum EXPRESSION_FRAME_KIND
+{
+    ExpressionFrame_Root,
+    ExpressionFrame_Prefix,        // Operand of a prefix operator
+    ExpressionFrame_Infix,         // Right hand side of a binary operator
+    ExpressionFrame_TernaryMiddle, // Between ? and :
+    ExpressionFrame_TernaryElse,   // After :
+    ExpressionFrame_Paren,
+    ExpressionFrame_Call,          // Argument of a call
+    ExpressionFrame_Subscript,
+};
+
+// NOTE(soimn): An operator or bracket waiting for an operand, see ParseExpression
+struct Expression_Frame
+{
+    Node_Index node;
+    U32 list_start;
+    Enum8(EXPRESSION_FRAME_KIND) kind;
+    U8 min_binding_power;
+};
+
+// NOTE(soimn): The parser works on a range of the token array, which need not be the whole file. Past the end
+//              of the range the cursor stays on end_token, a Token_EndOfStream token at the location of the first
+//              token after the range, so a range parses exactly like a file that ends there.
+struct Parser
+{
+    Token* tokens;
+    U32 end_index;
+    U32 token_index;
+    Token* token;
+    Token end_token;
+    
+    Syntax_Tree* tree;
+    Diagnostics_Engine* diagnostics;
+    
+    Dynamic_Array<Expression_Frame> expression_stack;
+    Dynamic_Array<Node_Index> scratch;
+    
+    U32 error_count;
+    U32 max_errors;
+    bool is_recovering;
+    bool gave_up;
+    
+    bool lazy_function_bodies;
+    
+    U32 speculation_depth;
+    bool speculation_failed;
+};
+
+inline void
+SkipToken(Parser* parser)
+{
+    if (parser->token_index < parser->end_index)
+    {
+        ++parser->token_index;
+    }
+    
+    parser->token = (parser->token_index < parser->end_index ? &parser->tokens[parser->token_index] : &parser->end_token);
+}
+
+inline Token*
+PeekToken(Parser* parser, U32 offset)
+{
+    U32 index = parser->token_index + offset;
+    
+    return (index < parser->end_index ? &parser->tokens[index] : &parser->end_token);
+}
+
+// NOTE(soimn): Points the parser at the tokens [first_token..end_token). The token at end_token has to exist, which
+//              it always does for ranges of an array that ends with a Token_EndOfStream token.
+inline void
+BeginParsingRange(Parser* parser, Token* tokens, U32 first_token, U32 end_token)
+{
+    parser->tokens      = tokens;
+    parser->end_index   = end_token;
+    parser->token_index = first_token;
+    
+    parser->end_token      = tokens[end_token];
+    parser->end_token.type = Token_EndOfStream;
+    
+    parser->token = (first_token < end_token ? &tokens[first_token] : &parser->end_token);
+    
+    parser->error_count   = 0;
+    parser->is_recovering = false;
+    parser->gave_up       = false;
+}
+
+inline bool
+EatToken(Parser* parser, Enum32(LEXER_TOKEN_TYPE) type)
+{
+    bool result = (parser->token->type == type);
+    
+    if (result)
+    {
+        SkipToken(parser);
+    }
+    
+    return result;
+}
+
+inline bool
+IsTopLevelKeyword(Enum32(LEXER_TOKEN_TYPE) type)
+{
+    return (type == Token_Struct || type == Token_Union || type == Token_Enum || type == Token_Typedef);
+}
+
+// NOTE(soimn): Decides whether an error should be reported. Errors are not reported while recovering, since
+//              they are most likely caused by the error being recovered from, and the parser gives up on the
+//              range it was pointed at by BeginParsingRange after max_errors errors. That range is the whole file
+//              for ParseTokens, but only a run of declarations when files are split up, see ParseFiles. While
+//              speculating, errors only fail the speculation, see BeginSpeculation.
+inline bool
+BeginParserError(Parser* parser)
+{
+    bool result = false;
+    
+    if (parser->speculation_depth != 0)
+    {
+        parser->is_recovering      = true;
+        parser->speculation_failed = true;
+    }
+    
+    else if (!parser->is_recovering && !parser->gave_up)
+    {
+        parser->is_recovering = true;
+        ++parser->error_count;
         
-        Token token  = GetToken(&lexer);
-        Token peek_token = PeekToken(&lexer);
+        if (parser->error_count > parser->max_errors)
+        {
+            Diagnose(parser->diagnostics, Error, parser->token->location, TooManyErrors);
+            parser->gave_up = true;
+        }
+        
+        else
+        {
+            result = true;
+        }
+    }
+    
+    return result;
+}
+
+#define ParserError(parser, message, ...) (BeginParserError(parser) ? (Diagnose((parser)->diagnostics, Error, (parser)->token->location, message, ##__VA_ARGS__), 0) : 0)
+
+inline bool
+ExpectToken(Parser* parser, Enum32(LEXER_TOKEN_TYPE) type)
+{
+    bool result = EatToken(parser, type);
+    
+    if (!result)
+    {
+        ParserError(parser, ExpectedToken, TokenName(type), TokenName(parser->token->type));
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Pushes a node with the current token as its main token
+inline Node_Index
+PushNode(Parser* parser, Enum8(AST_NODE_KIND) kind, U32 lhs = NODE_NONE, U32 rhs = NODE_NONE)
+{
+    return PushNode(parser->tree, kind, parser->token_index, lhs, rhs);
+}
+
+inline Node_Index
+ErrorNode(Parser* parser)
+{
+    return PushNode(parser, ASTNode_Error);
+}
+
+inline bool
+IsErrorNode(Parser* parser, Node_Index node)
+{
+    return (NodeKind(parser->tree, node) == ASTNode_Error);
+}
+
+inline U32
+BeginList(Parser* parser)
+{
+    return (U32)parser->scratch.count;
+}
+
+inline void
+PushListElement(Parser* parser, Node_Index node)
+{
+    *PushElement(&parser->scratch) = node;
+}
+
+// NOTE(soimn): Moves the elements pushed since BeginList to extra data and returns where they ended up
+inline AST_Range
+EndList(Parser* parser, U32 list_start)
+{
+    AST_Range result = {};
+    
+    U32 count = (U32)parser->scratch.count - list_start;
+    
+    result.start = (U32)parser->tree->extra_data.count;
+    result.end   = result.start + count;
+    
+    if (count != 0)
+    {
+        CopyArray(parser->scratch.data + list_start, PushElements(&parser->tree->extra_data, count), count);
+        PopElements(&parser->scratch, count);
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Skips to the next synchronization point. Braces are skipped in pairs, so a broken declaration
+//              with a body is skipped as a whole. The separator (';', or ',' in enum bodies) is consumed, while a
+//              '}' is left for the enclosing body to close, and top level keywords are left to start the next
+//              declaration.
+inline void
+Synchronize(Parser* parser, Enum32(LEXER_TOKEN_TYPE) separator, bool is_top_level)
+{
+    U32 depth = 0;
+    
+    while (parser->token->type != Token_EndOfStream)
+    {
+        Enum32(LEXER_TOKEN_TYPE) type = parser->token->type;
         
-        if (token.type == Token_Struct || token.type == Token_Union)
+        if (depth == 0)
         {
-            if (peek_token.type == Token_Identifier)
+            if (type == separator)
             {
-                /// Named struct or union
+                SkipToken(parser);
+                break;
             }
             
-            else if (peek_token.type == Token_OpenBrace)
+            else if (type == Token_CloseBrace && !is_top_level) break;
+            else if (IsTopLevelKeyword(type))                   break;
+        }
+        
+        if      (type == Token_OpenBrace)              ++depth;
+        else if (type == Token_CloseBrace && depth > 0) --depth;
+        
+        SkipToken(parser);
+    }
+    
+    parser->is_recovering = false;
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): Speculative parsing, for constructs that can only be told apart by trying to parse one of them.
+//              Everything the parser changes while parsing is appended to the token cursor, the arrays of the tree
+//              and the scratch stacks, so a checkpoint is a handful of counts, and rolling back truncates the
+//              arrays to them without freeing or copying anything.
+//
+//              Errors found while speculating are not reported, since the diagnostics engine is shared with the
+//              other workers parsing the module, and a diagnostic cannot be taken back once recorded. An error
+//              instead fails the speculation, which stays failed even if the parser recovers from the error.
+//              Speculations nest.
+//
+//                  Parser_Checkpoint checkpoint = BeginSpeculation(parser);
+//                  Node_Index result = ParseOneThing(parser);
+//                  if (!EndSpeculation(parser, checkpoint)) result = ParseTheOtherThing(parser);
+
+struct Parser_Checkpoint
+{
+    U32 token_index;
+    U32 node_count;
+    U32 extra_count;
+    U32 scratch_count;
+    U32 expression_stack_count;
+    
+    bool is_recovering;
+    bool speculation_failed;
+};
+
+inline Parser_Checkpoint
+BeginSpeculation(Parser* parser)
+{
+    Parser_Checkpoint result = {};
+    result.token_index            = parser->token_index;
+    result.node_count             = NodeCount(parser->tree);
+    result.extra_count            = (U32)parser->tree->extra_data.count;
+    result.scratch_count          = (U32)parser->scratch.count;
+    result.expression_stack_count = (U32)parser->expression_stack.count;
+    result.is_recovering          = parser->is_recovering;
+    result.speculation_failed     = parser->speculation_failed;
+    
+    ++parser->speculation_depth;
+    parser->speculation_failed = false;
+    
+    return result;
+}
+
+// NOTE(soimn): Discards everything parsed since the checkpoint, whether the speculation failed or not
+inline void
+RollBack(Parser* parser, Parser_Checkpoint checkpoint)
+{
+    Syntax_Tree* tree = parser->tree;
+    
+    parser->token_index = checkpoint.token_index;
+    parser->token       = (checkpoint.token_index < parser->end_index ? &parser->tokens[checkpoint.token_index] : &parser->end_token);
+    
+    PopElements(&tree->kinds,       tree->kinds.count - checkpoint.node_count);
+    PopElements(&tree->main_tokens, tree->main_tokens.count - checkpoint.node_count);
+    PopElements(&tree->data,        tree->data.count - checkpoint.node_count);
+    PopElements(&tree->extra_data,  tree->extra_data.count - checkpoint.extra_count);
+    
+    PopElements(&parser->scratch,          parser->scratch.count - checkpoint.scratch_count);
+    PopElements(&parser->expression_stack, parser->expression_stack.count - checkpoint.expression_stack_count);
+    
+    parser->is_recovering = checkpoint.is_recovering;
+}
+
+// NOTE(soimn): Ends the speculation and returns whether it succeeded. A failed speculation is rolled back, while
+//              the result of a successful one is kept.
+inline bool
+EndSpeculation(Parser* parser, Parser_Checkpoint checkpoint)
+{
+    Assert(parser->speculation_depth != 0);
+    
+    bool result = !parser->speculation_failed;
+    
+    if (!result) RollBack(parser, checkpoint);
+    
+    --parser->speculation_depth;
+    parser->speculation_failed = checkpoint.speculation_failed;
+    
+    return result;
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+inline Node_Index ParseStatement(Parser* parser);
+
+// NOTE(soimn): Binding powers of the infix operators, from the loosest to the tightest. Prefix operators bind
+//              tighter than any infix operator, and postfix operators are applied as soon as their operand is
+//              parsed, so they bind tighter still.
+enum OPERATOR_BINDING_POWER
+{
+    BindingPower_None = 0,
+    BindingPower_Assignment,     // = += -= *= /= %= &= |= ^= ~= <<= >>=
+    BindingPower_Ternary,        // ?:
+    BindingPower_LogicalOr,      // ||
+    BindingPower_LogicalAnd,     // &&
+    BindingPower_BitwiseOr,      // |
+    BindingPower_BitwiseXOR,     // ^
+    BindingPower_BitwiseAnd,     // &
+    BindingPower_Equality,       // == !=
+    BindingPower_Relational,     // < <= > >=
+    BindingPower_Shift,          // << >>
+    BindingPower_Additive,       // + -
+    BindingPower_Multiplicative, // * / %
+    BindingPower_Prefix,
+};
+
+struct Operator_Info
+{
+    Enum8(OPERATOR_BINDING_POWER) binding_power;
+    bool is_right_associative;
+};
+
+struct Operator_Table
+{
+    Operator_Info infix[LEXER_TOKEN_TYPE_COUNT];
+};
+
+constexpr Operator_Table
+BuildOperatorTable()
+{
+    Operator_Table table = {};
+    
+    Enum32(LEXER_TOKEN_TYPE) assignments[] = {Token_Equals, Token_PlusEquals, Token_MinusEquals, Token_MultiplyEquals,
+                                              Token_DivideEquals, Token_ModuloEquals, Token_AndEquals, Token_OrEquals,
+                                              Token_XOREquals, Token_NotEquals, Token_LeftShiftEquals, Token_RightShiftEquals};
+    
+    for (Enum32(LEXER_TOKEN_TYPE) type : assignments)
+    {
+        table.infix[type] = {BindingPower_Assignment, true};
+    }
+    
+    table.infix[Token_QuestionMark]       = {BindingPower_Ternary, true};
+    table.infix[Token_LogicalOr]          = {BindingPower_LogicalOr, false};
+    table.infix[Token_LogicalAnd]         = {BindingPower_LogicalAnd, false};
+    table.infix[Token_Or]                 = {BindingPower_BitwiseOr, false};
+    table.infix[Token_XOR]                = {BindingPower_BitwiseXOR, false};
+    table.infix[Token_Ampersand]          = {BindingPower_BitwiseAnd, false};
+    table.infix[Token_EqualTo]            = {BindingPower_Equality, false};
+    table.infix[Token_NotEqual]           = {BindingPower_Equality, false};
+    table.infix[Token_LessThan]           = {BindingPower_Relational, false};
+    table.infix[Token_LessThanOrEqual]    = {BindingPower_Relational, false};
+    table.infix[Token_GreaterThan]        = {BindingPower_Relational, false};
+    table.infix[Token_GreaterThanOrEqual] = {BindingPower_Relational, false};
+    table.infix[Token_LeftShift]          = {BindingPower_Shift, false};
+    table.infix[Token_RightShift]         = {BindingPower_Shift, false};
+    table.infix[Token_Plus]               = {BindingPower_Additive, false};
+    table.infix[Token_Minus]              = {BindingPower_Additive, false};
+    table.infix[Token_Asterisk]           = {BindingPower_Multiplicative, false};
+    table.infix[Token_Divide]             = {BindingPower_Multiplicative, false};
+    table.infix[Token_Modulo]             = {BindingPower_Multiplicative, false};
+    
+    return table;
+}
+
+global constexpr Operator_Table OperatorTable = BuildOperatorTable();
+
+inline bool
+IsPrefixOperator(Enum32(LEXER_TOKEN_TYPE) type)
+{
+    return (type == Token_Plus     || type == Token_Minus     || type == Token_LogicalNot || type == Token_Not ||
+            type == Token_Asterisk || type == Token_Ampersand || type == Token_Inc        || type == Token_Dec);
+}
+
+inline Node_Index
+ParsePrimaryExpression(Parser* parser)
+{
+    Node_Index result = NODE_NONE;
+    
+    Enum8(AST_NODE_KIND) kind = ASTNode_Error;
+    
+    switch (parser->token->type)
+    {
+        case Token_Identifier: kind = ASTNode_Identifier;    break;
+        case Token_INT:        kind = ASTNode_IntLiteral;    break;
+        case Token_F32:        kind = ASTNode_FloatLiteral;  break;
+        case Token_F64:        kind = ASTNode_FloatLiteral;  break;
+        case Token_String:     kind = ASTNode_StringLiteral; break;
+        case Token_Character:  kind = ASTNode_CharLiteral;   break;
+    }
+    
+    if (kind != ASTNode_Error)
+    {
+        result = PushNode(parser, kind);
+        SkipToken(parser);
+    }
+    
+    else
+    {
+        ParserError(parser, ExpectedExpression, TokenName(parser->token->type));
+        result = ErrorNode(parser);
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Completes the node of a frame with the operand as its last child, and returns the node that
+//              replaces the operand. The caller pops the frame.
+inline Node_Index
+CloseExpressionFrame(Parser* parser, Expression_Frame* frame, Node_Index operand)
+{
+    Node_Index result    = frame->node;
+    AST_Node_Data* data = (frame->node != NODE_NONE ? NodeData(parser->tree, frame->node) : 0);
+    
+    switch (frame->kind)
+    {
+        case ExpressionFrame_Prefix:
+        {
+            data->lhs = operand;
+        } break;
+        
+        case ExpressionFrame_Infix:
+        case ExpressionFrame_Subscript:
+        {
+            data->rhs = operand;
+        } break;
+        
+        case ExpressionFrame_TernaryMiddle:
+        {
+            data->rhs = PushExtraData(parser->tree, AST_Branches{operand, NODE_NONE});
+        } break;
+        
+        case ExpressionFrame_TernaryElse:
+        {
+            // NOTE(soimn): The then branch is parked in rhs while the else branch is parsed
+            data->rhs = PushExtraData(parser->tree, AST_Branches{data->rhs, operand});
+        } break;
+        
+        case ExpressionFrame_Call:
+        {
+            PushListElement(parser, operand);
+            data->rhs = PushExtraData(parser->tree, EndList(parser, frame->list_start));
+        } break;
+        
+        case ExpressionFrame_Paren:
+        {
+            result = operand;
+        } break;
+        
+        INVALID_DEFAULT_CASE;
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Pratt parser driven by OperatorTable. Instead of recursing for every operand, the operators,
+//              parentheses, calls and subscripts that are waiting for an operand are kept on an explicit stack
+//              of frames, so neither deep nesting nor long operator chains grow the call stack.
+//
+//              The parser alternates between parsing an operand (prefix operators, opening parentheses and a
+//              primary expression) and folding it into the frames. An infix operator binds to the operand when
+//              its binding power is at least the minimum of the innermost frame, otherwise the innermost frame
+//              is closed with the operand as its last child. Left associative operators require a strictly
+//              higher binding power on their right hand side, right associative operators do not.
+inline Node_Index
+ParseExpression(Parser* parser)
+{
+    Dynamic_Array<Expression_Frame>* stack = &parser->expression_stack;
+    
+    // NOTE(soimn): Everything above the base belongs to this expression, which keeps ParseExpression reentrant
+    UMM base = stack->count;
+    *PushElement(stack) = {NODE_NONE, 0, ExpressionFrame_Root, BindingPower_Assignment};
+    
+    Node_Index operand = NODE_NONE;
+    bool is_done       = false;
+    
+    do
+    {
+        /// Operand
+        for (;;)
+        {
+            if (IsPrefixOperator(parser->token->type))
             {
-                /// Unnamed struct or union
+                *PushElement(stack) = {PushNode(parser, ASTNode_Unary), 0, ExpressionFrame_Prefix, BindingPower_Prefix};
+                SkipToken(parser);
             }
             
-            else
+            else if (parser->token->type == Token_OpenParen)
             {
-                //// ERROR: Unexpected token after the struct/union keyword
+                *PushElement(stack) = {NODE_NONE, 0, ExpressionFrame_Paren, BindingPower_Assignment};
+                SkipToken(parser);
             }
+            
+            else break;
         }
         
-        else if (token.type == Token_Enum)
+        operand = ParsePrimaryExpression(parser);
+        
+        /// Postfix operators and folding
+        bool needs_operand = false;
+        while (!needs_operand && !is_done && !parser->is_recovering)
         {
-            if (peek_token.type == Token_Identifier)
+            Token* token            = parser->token;
+            Expression_Frame* frame = &stack->data[stack->count - 1];
+            Operator_Info info      = OperatorTable.infix[token->type];
+            
+            if (token->type == Token_OpenParen || token->type == Token_OpenBracket)
             {
-                /// Named enum declaration
+                bool is_call = (token->type == Token_OpenParen);
                 
-                token      = GetToken(&lexer);
-                peek_token = PeekToken(&lexer);
+                Node_Index node = PushNode(parser, (is_call ? ASTNode_Call : ASTNode_Subscript), operand);
+                SkipToken(parser);
                 
-                if (peek_token.type == Token_Colon)
+                if (is_call && EatToken(parser, Token_CloseParen))
                 {
-                    /// Named and typed enum declaration
-                    
-                    // ParseTypedEnum();
+                    NodeData(parser->tree, node)->rhs = PushExtraData(parser->tree, EndList(parser, BeginList(parser)));
+                    operand = node;
+                }
+                
+                else
+                {
+                    *PushElement(stack) = {node, BeginList(parser), (is_call ? ExpressionFrame_Call : ExpressionFrame_Subscript), BindingPower_Assignment};
+                    needs_operand = true;
                 }
+            }
+            
+            else if (token->type == Token_Dot)
+            {
+                SkipToken(parser);
                 
-                else if (peek_token.type == Token_OpenBrace)
+                if (parser->token->type == Token_Identifier)
                 {
-                    /// Named but not typed enum declaration
-                    
-                    token      = GetToken(&lexer);
-                    peek_token = PeekToken(&lexer);
-                    
-                    // ParseEnumBody();
+                    operand = PushNode(parser, ASTNode_MemberAccess, operand);
+                    SkipToken(parser);
                 }
                 
                 else
                 {
-                    //// ERROR: Unexpected token in enum declaration
+                    ParserError(parser, ExpectedToken, TokenName(Token_Identifier), TokenName(parser->token->type));
                 }
             }
             
-            else if (peek_token.type == Token_Colon)
+            else if (token->type == Token_Inc || token->type == Token_Dec)
             {
-                /// Unnamed typed enum declaration
-                
-                // ParseTypedEnum();
+                operand = PushNode(parser, ASTNode_Postfix, operand);
+                SkipToken(parser);
             }
             
-            else if (peek_token.type == Token_OpenBrace)
+            else if (info.binding_power != BindingPower_None && info.binding_power >= frame->min_binding_power)
             {
-                /// Unnamed but not typed enum declaration
+                bool is_ternary = (token->type == Token_QuestionMark);
+                
+                Node_Index node = PushNode(parser, (is_ternary ? ASTNode_Ternary : ASTNode_Binary), operand);
+                SkipToken(parser);
+                
+                if (is_ternary)
+                {
+                    *PushElement(stack) = {node, 0, ExpressionFrame_TernaryMiddle, BindingPower_Assignment};
+                }
+                
+                else
+                {
+                    U8 min_binding_power = (U8)(info.binding_power + (info.is_right_associative ? 0 : 1));
+                    *PushElement(stack) = {node, 0, ExpressionFrame_Infix, min_binding_power};
+                }
                 
-                // ParseEnumBody();
+                needs_operand = true;
             }
             
             else
             {
-                //// ERROR: Unexpected token after the enum keyword
+                switch (frame->kind)
+                {
+                    case ExpressionFrame_Root:
+                    {
+                        is_done = true;
+                    } break;
+                    
+                    case ExpressionFrame_Prefix:
+                    case ExpressionFrame_Infix:
+                    case ExpressionFrame_TernaryElse:
+                    {
+                        operand = CloseExpressionFrame(parser, frame, operand);
+                        PopElements(stack, 1);
+                    } break;
+                    
+                    case ExpressionFrame_TernaryMiddle:
+                    {
+                        if (ExpectToken(parser, Token_Colon))
+                        {
+                            NodeData(parser->tree, frame->node)->rhs = operand;
+                            
+                            frame->kind              = ExpressionFrame_TernaryElse;
+                            frame->min_binding_power = BindingPower_Ternary;
+                            needs_operand            = true;
+                        }
+                    } break;
+                    
+                    case ExpressionFrame_Paren:
+                    {
+                        if (ExpectToken(parser, Token_CloseParen))
+                        {
+                            PopElements(stack, 1);
+                        }
+                    } break;
+                    
+                    case ExpressionFrame_Call:
+                    case ExpressionFrame_Subscript:
+                    {
+                        Enum32(LEXER_TOKEN_TYPE) terminator = (frame->kind == ExpressionFrame_Call ? Token_CloseParen : Token_CloseBracket);
+                        
+                        if (frame->kind == ExpressionFrame_Call && EatToken(parser, Token_Comma))
+                        {
+                            PushListElement(parser, operand);
+                            needs_operand = true;
+                        }
+                        
+                        else if (ExpectToken(parser, terminator))
+                        {
+                            operand = CloseExpressionFrame(parser, frame, operand);
+                            PopElements(stack, 1);
+                        }
+                    } break;
+                    
+                    INVALID_DEFAULT_CASE;
+                }
             }
         }
+    } while (!is_done && !parser->is_recovering);
+    
+    // NOTE(soimn): On an error the frames that are still open are closed around the operand, so the partial tree
+    //              is kept in the AST like it is for other constructs
+    while (stack->count > base + 1)
+    {
+        operand = CloseExpressionFrame(parser, &stack->data[stack->count - 1], operand);
+        PopElements(stack, 1);
+    }
+    
+    PopElements(stack, 1);
+    
+    return operand;
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+inline Node_Index
+ParseType(Parser* parser)
+{
+    Node_Index result = NODE_NONE;
+    
+    if (parser->token->type == Token_Identifier)
+    {
+        result = PushNode(parser, ASTNode_TypeName);
+        SkipToken(parser);
         
-        else if (token.type == Token_Typedef)
-        {
-            
-        }
-        
-        else
+        while (parser->token->type == Token_Asterisk)
         {
-            //// ERROR: encountered an unknown token in global scope
+            result = PushNode(parser, ASTNode_PointerType, result);
+            SkipToken(parser);
         }
+    }
+    
+    else
+    {
+        ParserError(parser, ExpectedTypeName, TokenName(parser->token->type));
+        result = ErrorNode(parser);
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): A declaration starts with a tag, or a type followed by a name, i.e. ident '*'* ident. This
+//              resolves 'a * b' as a declaration of b, like C does when a names a type. In statements this is only
+//              a guess, see ParseDeclarationOrExpression.
+inline bool
+IsDeclarationStart(Parser* parser)
+{
+    U32 offset = 0;
+    
+    bool result = (PeekToken(parser, offset)->type == Token_At);
+    
+    if (!result && PeekToken(parser, offset)->type == Token_Identifier)
+    {
+        do ++offset; while (PeekToken(parser, offset)->type == Token_Asterisk);
+        
+        result = (PeekToken(parser, offset)->type == Token_Identifier);
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Parses the tags in front of a declaration, and pushes them to the current list
+inline bool
+ParseTags(Parser* parser)
+{
+    bool encountered_errors = false;
+    
+    while (!encountered_errors && parser->token->type == Token_At)
+    {
+        SkipToken(parser);
+        
+        if (parser->token->type == Token_Identifier)
+        {
+            U32 name = parser->token_index;
+            SkipToken(parser);
+            
+            U32 list_start = BeginList(parser);
+            
+            if (EatToken(parser, Token_OpenParen) && !EatToken(parser, Token_CloseParen))
+            {
+                do
+                {
+                    PushListElement(parser, ParseExpression(parser));
+                } while (!parser->is_recovering && EatToken(parser, Token_Comma));
+                
+                if (parser->is_recovering || !ExpectToken(parser, Token_CloseParen))
+                {
+                    encountered_errors = true;
+                }
+            }
+            
+            AST_Range arguments = EndList(parser, list_start);
+            
+            PushListElement(parser, PushNode(parser->tree, ASTNode_Tag, name, arguments.start, arguments.end));
+        }
+        
+        else
+        {
+            ParserError(parser, ExpectedToken, TokenName(Token_Identifier), TokenName(parser->token->type));
+            encountered_errors = true;
+        }
+    }
+    
+    return !encountered_errors;
+}
+
+// NOTE(soimn): Parses the parameter list of a function, after the opening parenthesis, up to and including the
+//              closing parenthesis. The parameters are pushed to the current list.
+inline bool
+ParseParameters(Parser* parser)
+{
+    bool encountered_errors = false;
+    
+    if (parser->token->type != Token_CloseParen)
+    {
+        do
+        {
+            if (parser->token->type == Token_Elipsis)
+            {
+                PushListElement(parser, PushNode(parser, ASTNode_VariadicParameter));
+                SkipToken(parser);
+                
+                // NOTE(soimn): The variadic parameter has to be the last one
+                break;
+            }
+            
+            Node_Index type = ParseType(parser);
+            
+            if (!IsErrorNode(parser, type) && parser->token->type == Token_Identifier)
+            {
+                PushListElement(parser, PushNode(parser, ASTNode_Parameter, type));
+                SkipToken(parser);
+            }
+            
+            else
+            {
+                ParserError(parser, ExpectedToken, TokenName(Token_Identifier), TokenName(parser->token->type));
+                encountered_errors = true;
+            }
+        } while (!encountered_errors && EatToken(parser, Token_Comma));
+    }
+    
+    if (!encountered_errors && !ExpectToken(parser, Token_CloseParen))
+    {
+        encountered_errors = true;
+    }
+    
+    return !encountered_errors;
+}
+
+// NOTE(soimn): Parses the variables of a declaration, after the type, up to and including the semicolon. The
+//              variables are pushed to the current list.
+inline bool
+ParseVariables(Parser* parser)
+{
+    bool encountered_errors = false;
+    
+    do
+    {
+        if (parser->token->type == Token_Identifier)
+        {
+            U32 name = parser->token_index;
+            SkipToken(parser);
+            
+            Node_Index value = NODE_NONE;
+            if (EatToken(parser, Token_Equals))
+            {
+                value = ParseExpression(parser);
+            }
+            
+            PushListElement(parser, PushNode(parser->tree, ASTNode_Variable, name, value));
+        }
+        
+        else
+        {
+            ParserError(parser, ExpectedToken, TokenName(Token_Identifier), TokenName(parser->token->type));
+            encountered_errors = true;
+        }
+    } while (!parser->is_recovering && EatToken(parser, Token_Comma));
+    
+    if (!parser->is_recovering) ExpectToken(parser, Token_Semicolon);
+    
+    return !encountered_errors;
+}
+
+// NOTE(soimn): Records the tokens of a function body in a lazy block instead of parsing them, see
+//              ParseFunctionBody. The body ends where ParseBlock would end it, after the matching '}' or before a
+//              top level keyword, so errors in the body are only reported once it is parsed.
+inline Node_Index
+SkipFunctionBody(Parser* parser)
+{
+    U32 open_brace = parser->token_index;
+    SkipToken(parser);
+    
+    U32 depth = 1;
+    
+    while (depth != 0 && parser->token->type != Token_EndOfStream && !IsTopLevelKeyword(parser->token->type))
+    {
+        if      (parser->token->type == Token_OpenBrace)  ++depth;
+        else if (parser->token->type == Token_CloseBrace) --depth;
+        
+        SkipToken(parser);
+    }
+    
+    return PushNode(parser->tree, ASTNode_LazyBlock, open_brace, parser->token_index);
+}
+
+// NOTE(soimn): Parses a function declaration or definition, or a variable declaration, with the tags in front of
+//              it. Functions are only allowed at the top level.
+inline Node_Index
+ParseDeclaration(Parser* parser, bool is_top_level)
+{
+    Node_Index result = NODE_NONE;
+    
+    U32 tags_start      = BeginList(parser);
+    bool are_tags_valid = ParseTags(parser);
+    AST_Range tags      = EndList(parser, tags_start);
+    
+    U32 start = parser->token_index;
+    
+    Node_Index type = (are_tags_valid ? ParseType(parser) : ErrorNode(parser));
+    
+    if (IsErrorNode(parser, type))
+    {
+        result = type;
+    }
+    
+    else if (PeekToken(parser, 1)->type == Token_OpenParen)
+    {
+        if (!is_top_level)
+        {
+            ParserError(parser, NestedFunction);
+            result = ErrorNode(parser);
+        }
+        
+        else
+        {
+            U32 name = parser->token_index;
+            
+            // NOTE(soimn): Skip the name and the opening parenthesis
+            SkipToken(parser);
+            SkipToken(parser);
+            
+            U32 list_start      = BeginList(parser);
+            bool is_valid       = ParseParameters(parser);
+            AST_Range parameters = EndList(parser, list_start);
+            
+            if (!is_valid)
+            {
+                result = ErrorNode(parser);
+            }
+            
+            else
+            {
+                U32 prototype = PushExtraData(parser->tree, AST_Function_Prototype{type, parameters.start, parameters.end,
+                                                                                   tags.start, tags.end});
+                
+                if (parser->token->type == Token_OpenBrace)
+                {
+                    Node_Index body = (parser->lazy_function_bodies ? SkipFunctionBody(parser) : ParseStatement(parser));
+                    result = PushNode(parser->tree, ASTNode_FunctionDef, name, prototype, body);
+                }
+                
+                else
+                {
+                    result = PushNode(parser->tree, ASTNode_FunctionDecl, name, prototype);
+                    ExpectToken(parser, Token_Semicolon);
+                }
+            }
+        }
+    }
+    
+    else
+    {
+        U32 list_start      = BeginList(parser);
+        bool is_valid       = ParseVariables(parser);
+        AST_Range variables = EndList(parser, list_start);
+        
+        if (!is_valid)
+        {
+            result = ErrorNode(parser);
+        }
+        
+        else
+        {
+            U32 list = PushExtraData(parser->tree, AST_Variable_List{variables.start, variables.end, tags.start, tags.end});
+            result   = PushNode(parser->tree, ASTNode_VarDecl, start, type, list);
+        }
+    }
+    
+    return result;
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): Parses the statements of a block up to and including the closing brace. A top level keyword is
+//              taken as a sign of a missing '}', and ends the block without consuming it.
+inline Node_Index
+ParseBlock(Parser* parser)
+{
+    U32 open_brace = parser->token_index;
+    SkipToken(parser);
+    
+    U32 list_start = BeginList(parser);
+    
+    while (parser->token->type != Token_CloseBrace && parser->token->type != Token_EndOfStream &&
+           !IsTopLevelKeyword(parser->token->type) && !parser->gave_up)
+    {
+        PushListElement(parser, ParseStatement(parser));
+        
+        if (parser->is_recovering)
+        {
+            Synchronize(parser, Token_Semicolon, false);
+        }
+    }
+    
+    AST_Range statements = EndList(parser, list_start);
+    
+    ExpectToken(parser, Token_CloseBrace);
+    
+    return PushNode(parser->tree, ASTNode_Block, open_brace, statements.start, statements.end);
+}
+
+inline Node_Index
+ParseParenthesizedCondition(Parser* parser)
+{
+    Node_Index result = NODE_NONE;
+    
+    if (ExpectToken(parser, Token_OpenParen))
+    {
+        result = ParseExpression(parser);
+        
+        if (!parser->is_recovering) ExpectToken(parser, Token_CloseParen);
+    }
+    
+    else
+    {
+        result = ErrorNode(parser);
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Parses a declaration, or an expression followed by the terminator, which is consumed either way.
+//              IsDeclarationStart only looks at the first few tokens, so 'a * b + c;' starts like a declaration of
+//              b. Anything that starts like a declaration is parsed as one speculatively, and as an expression when
+//              that fails and the expression parses. When neither parses, the declaration is parsed again to report
+//              its errors.
+inline Node_Index
+ParseDeclarationOrExpression(Parser* parser, Enum32(LEXER_TOKEN_TYPE) terminator, bool* is_expression)
+{
+    Node_Index result = NODE_NONE;
+    
+    *is_expression = !IsDeclarationStart(parser);
+    
+    if (*is_expression)
+    {
+        result = ParseExpression(parser);
+        
+        if (!parser->is_recovering) ExpectToken(parser, terminator);
+    }
+    
+    else if (parser->token->type == Token_At)
+    {
+        // NOTE(soimn): Only declarations have tags
+        result = ParseDeclaration(parser, false);
+    }
+    
+    else
+    {
+        Parser_Checkpoint checkpoint = BeginSpeculation(parser);
+        result = ParseDeclaration(parser, false);
+        
+        if (!EndSpeculation(parser, checkpoint))
+        {
+            checkpoint = BeginSpeculation(parser);
+            result     = ParseExpression(parser);
+            
+            if (!parser->is_recovering) ExpectToken(parser, terminator);
+            
+            *is_expression = EndSpeculation(parser, checkpoint);
+            
+            if (!*is_expression) result = ParseDeclaration(parser, false);
+        }
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Parses an optional part of a for statement, which is an empty node when the terminator follows
+//              directly. The terminator is consumed.
+inline Node_Index
+ParseForClause(Parser* parser, Enum32(LEXER_TOKEN_TYPE) terminator, bool allow_declaration)
+{
+    Node_Index result = NODE_NONE;
+    
+    if (parser->token->type == terminator)
+    {
+        result = PushNode(parser, ASTNode_Empty);
+        SkipToken(parser);
+    }
+    
+    else if (allow_declaration)
+    {
+        bool is_expression = false;
+        result = ParseDeclarationOrExpression(parser, terminator, &is_expression);
+    }
+    
+    else
+    {
+        result = ParseExpression(parser);
+        
+        if (!parser->is_recovering) ExpectToken(parser, terminator);
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Statements parse their children before pushing their own node, so a statement node always comes
+//              after its children. Clauses that are skipped because of an error are filled in with error nodes.
+inline Node_Index
+ParseStatement(Parser* parser)
+{
+    Node_Index result = NODE_NONE;
+    
+    U32 keyword = parser->token_index;
+    
+    switch (parser->token->type)
+    {
+        case Token_OpenBrace:
+        {
+            result = ParseBlock(parser);
+        } break;
+        
+        case Token_Semicolon:
+        {
+            result = PushNode(parser, ASTNode_Empty);
+            SkipToken(parser);
+        } break;
+        
+        case Token_If:
+        {
+            SkipToken(parser);
+            
+            Node_Index condition   = ParseParenthesizedCondition(parser);
+            Node_Index then_branch = (!parser->is_recovering ? ParseStatement(parser) : ErrorNode(parser));
+            Node_Index else_branch = NODE_NONE;
+            
+            if (!parser->is_recovering && EatToken(parser, Token_Else))
+            {
+                else_branch = ParseStatement(parser);
+            }
+            
+            result = PushNode(parser->tree, ASTNode_If, keyword, condition, PushExtraData(parser->tree, AST_Branches{then_branch, else_branch}));
+        } break;
+        
+        case Token_While:
+        {
+            SkipToken(parser);
+            
+            Node_Index condition = ParseParenthesizedCondition(parser);
+            Node_Index body      = (!parser->is_recovering ? ParseStatement(parser) : ErrorNode(parser));
+            
+            result = PushNode(parser->tree, ASTNode_While, keyword, condition, body);
+        } break;
+        
+        case Token_Do:
+        {
+            SkipToken(parser);
+            
+            Node_Index body      = ParseStatement(parser);
+            Node_Index condition = NODE_NONE;
+            
+            if (!parser->is_recovering && ExpectToken(parser, Token_While))
+            {
+                condition = ParseParenthesizedCondition(parser);
+                
+                if (!parser->is_recovering) ExpectToken(parser, Token_Semicolon);
+            }
+            
+            else
+            {
+                condition = ErrorNode(parser);
+            }
+            
+            result = PushNode(parser->tree, ASTNode_DoWhile, keyword, body, condition);
+        } break;
+        
+        case Token_For:
+        {
+            SkipToken(parser);
+            
+            // NOTE(soimn): The init, condition and step are always present, as empty nodes when omitted
+            AST_For_Clauses clauses = {};
+            Node_Index body         = NODE_NONE;
+            
+            if (ExpectToken(parser, Token_OpenParen))
+            {
+                clauses.init = ParseForClause(parser, Token_Semicolon, true);
+                
+                if (!parser->is_recovering) clauses.condition = ParseForClause(parser, Token_Semicolon, false);
+                if (!parser->is_recovering) clauses.step      = ParseForClause(parser, Token_CloseParen, false);
+                if (!parser->is_recovering) body              = ParseStatement(parser);
+            }
+            
+            if (clauses.init      == NODE_NONE) clauses.init      = ErrorNode(parser);
+            if (clauses.condition == NODE_NONE) clauses.condition = ErrorNode(parser);
+            if (clauses.step      == NODE_NONE) clauses.step      = ErrorNode(parser);
+            if (body              == NODE_NONE) body              = ErrorNode(parser);
+            
+            result = PushNode(parser->tree, ASTNode_For, keyword, PushExtraData(parser->tree, clauses), body);
+        } break;
+        
+        case Token_Return:
+        {
+            SkipToken(parser);
+            
+            Node_Index value = NODE_NONE;
+            if (parser->token->type != Token_Semicolon)
+            {
+                value = ParseExpression(parser);
+            }
+            
+            if (!parser->is_recovering) ExpectToken(parser, Token_Semicolon);
+            
+            result = PushNode(parser->tree, ASTNode_Return, keyword, value);
+        } break;
+        
+        case Token_Break:
+        case Token_Continue:
+        {
+            result = PushNode(parser, (parser->token->type == Token_Break ? ASTNode_Break : ASTNode_Continue));
+            SkipToken(parser);
+            
+            ExpectToken(parser, Token_Semicolon);
+        } break;
+        
+        default:
+        {
+            bool is_expression = false;
+            result = ParseDeclarationOrExpression(parser, Token_Semicolon, &is_expression);
+            
+            if (is_expression) result = PushNode(parser->tree, ASTNode_ExpressionStatement, keyword, result);
+        } break;
+    }
+    
+    return result;
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+inline Node_Index
+ParseMember(Parser* parser)
+{
+    Node_Index result = NODE_NONE;
+    
+    Node_Index type = ParseType(parser);
+    
+    if (!IsErrorNode(parser, type) && parser->token->type == Token_Identifier)
+    {
+        result = PushNode(parser, ASTNode_Member, type);
+        SkipToken(parser);
+        
+        ExpectToken(parser, Token_Semicolon);
+    }
+    
+    else
+    {
+        ParserError(parser, ExpectedToken, TokenName(Token_Identifier), TokenName(parser->token->type));
+        result = ErrorNode(parser);
+    }
+    
+    return result;
+}
+
+inline Node_Index
+ParseEnumerator(Parser* parser)
+{
+    Node_Index result = NODE_NONE;
+    
+    if (parser->token->type == Token_Identifier)
+    {
+        U32 name = parser->token_index;
+        SkipToken(parser);
+        
+        Node_Index value = NODE_NONE;
+        if (EatToken(parser, Token_Equals))
+        {
+            value = ParseExpression(parser);
+        }
+        
+        result = PushNode(parser->tree, ASTNode_Enumerator, name, value);
+        
+        if (!parser->is_recovering && parser->token->type != Token_CloseBrace)
+        {
+            ExpectToken(parser, Token_Comma);
+        }
+    }
+    
+    else
+    {
+        ParserError(parser, ExpectedToken, TokenName(Token_Identifier), TokenName(parser->token->type));
+        result = ErrorNode(parser);
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Parses the elements of a struct, union or enum body up to and including the closing brace. A top
+//              level keyword in a body is taken as a sign of a missing '}', and ends the body without consuming it.
+inline AST_Range
+ParseBody(Parser* parser, bool is_enum_body)
+{
+    U32 list_start = BeginList(parser);
+    
+    while (parser->token->type != Token_CloseBrace && parser->token->type != Token_EndOfStream &&
+           !IsTopLevelKeyword(parser->token->type) && !parser->gave_up)
+    {
+        PushListElement(parser, (is_enum_body ? ParseEnumerator(parser) : ParseMember(parser)));
+        
+        if (parser->is_recovering)
+        {
+            Synchronize(parser, (is_enum_body ? Token_Comma : Token_Semicolon), false);
+        }
+    }
+    
+    AST_Range result = EndList(parser, list_start);
+    
+    ExpectToken(parser, Token_CloseBrace);
+    
+    return result;
+}
+
+inline Node_Index
+ParseStructOrUnion(Parser* parser)
+{
+    Node_Index result = NODE_NONE;
+    
+    U32 keyword = parser->token_index;
+    bool is_struct = (parser->token->type == Token_Struct);
+    SkipToken(parser);
+    
+    U32 name = keyword;
+    if (parser->token->type == Token_Identifier)
+    {
+        name = parser->token_index;
+        SkipToken(parser);
+    }
+    
+    if (parser->token->type == Token_Semicolon && name != keyword)
+    {
+        /// Struct or union declaration
+        result = PushNode(parser->tree, (is_struct ? ASTNode_StructDecl : ASTNode_UnionDecl), name);
+        SkipToken(parser);
+    }
+    
+    else if (EatToken(parser, Token_OpenBrace))
+    {
+        /// Named or unnamed struct or union definition
+        AST_Range members = ParseBody(parser, false);
+        
+        result = PushNode(parser->tree, (is_struct ? ASTNode_StructDef : ASTNode_UnionDef), name, members.start, members.end);
+    }
+    
+    else
+    {
+        ParserError(parser, UnexpectedTokenAfterKeyword, TokenName(parser->tokens[keyword].type), TokenName(parser->token->type));
+        result = ErrorNode(parser);
+    }
+    
+    return result;
+}
+
+inline Node_Index
+ParseEnum(Parser* parser)
+{
+    Node_Index result = NODE_NONE;
+    
+    U32 keyword = parser->token_index;
+    SkipToken(parser);
+    
+    U32 name = keyword;
+    if (parser->token->type == Token_Identifier)
+    {
+        name = parser->token_index;
+        SkipToken(parser);
+    }
+    
+    Node_Index type = NODE_NONE;
+    if (EatToken(parser, Token_Colon))
+    {
+        /// Typed enum
+        type = ParseType(parser);
+        
+        if (IsErrorNode(parser, type))
+        {
+            result = type;
+        }
+    }
+    
+    if (result == NODE_NONE)
+    {
+        if (EatToken(parser, Token_OpenBrace))
+        {
+            AST_Range enumerators = ParseBody(parser, true);
+            
+            result = PushNode(parser->tree, ASTNode_EnumDef, name, type, PushExtraData(parser->tree, enumerators));
+        }
+        
+        else
+        {
+            ParserError(parser, UnexpectedTokenAfterKeyword, TokenName(parser->tokens[keyword].type), TokenName(parser->token->type));
+            result = ErrorNode(parser);
+        }
+    }
+    
+    return result;
+}
+
+inline Node_Index
+ParseTypedef(Parser* parser)
+{
+    Node_Index result = NODE_NONE;
+    
+    SkipToken(parser);
+    
+    Node_Index type = NODE_NONE;
+    if      (parser->token->type == Token_Struct || parser->token->type == Token_Union) type = ParseStructOrUnion(parser);
+    else if (parser->token->type == Token_Enum)                                         type = ParseEnum(parser);
+    else                                                                                type = ParseType(parser);
+    
+    if (IsErrorNode(parser, type))
+    {
+        result = type;
+    }
+    
+    else if (parser->token->type == Token_Identifier)
+    {
+        result = PushNode(parser, ASTNode_Typedef, type);
+        SkipToken(parser);
+    }
+    
+    else
+    {
+        ParserError(parser, ExpectedToken, TokenName(Token_Identifier), TokenName(parser->token->type));
+        result = ErrorNode(parser);
+    }
+    
+    return result;
+}
+
+inline Node_Index
+ParseTopLevelDeclaration(Parser* parser)
+{
+    Node_Index result = NODE_NONE;
+    
+    switch (parser->token->type)
+    {
+        case Token_Struct:
+        case Token_Union:
+        {
+            result = ParseStructOrUnion(parser);
+            
+            // NOTE(soimn): Declarations consume their own semicolon
+            Enum8(AST_NODE_KIND) kind = NodeKind(parser->tree, result);
+            if (kind == ASTNode_StructDef || kind == ASTNode_UnionDef)
+            {
+                ExpectToken(parser, Token_Semicolon);
+            }
+        } break;
+        
+        case Token_Enum:
+        {
+            result = ParseEnum(parser);
+            
+            if (!IsErrorNode(parser, result)) ExpectToken(parser, Token_Semicolon);
+        } break;
+        
+        case Token_Typedef:
+        {
+            result = ParseTypedef(parser);
+            
+            if (!IsErrorNode(parser, result)) ExpectToken(parser, Token_Semicolon);
+        } break;
+        
+        default:
+        {
+            if (IsDeclarationStart(parser))
+            {
+                result = ParseDeclaration(parser, true);
+            }
+            
+            else
+            {
+                ParserError(parser, ExpectedDeclaration, TokenName(parser->token->type));
+                result = ErrorNode(parser);
+            }
+        } break;
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Parses top level declarations up to the end of the range, and pushes them to the open list
+inline void
+ParseTopLevelDeclarationList(Parser* parser)
+{
+    while (parser->token->type != Token_EndOfStream && !parser->gave_up)
+    {
+        U32 start_index = parser->token_index;
+        
+        PushListElement(parser, ParseTopLevelDeclaration(parser));
+        
+        if (parser->is_recovering)
+        {
+            Synchronize(parser, Token_Semicolon, true);
+            
+            // NOTE(soimn): Guarantees progress when the error was found at a synchronization point that is not
+            //              consumed, e.g. a stray top level keyword
+            if (parser->token_index == start_index) SkipToken(parser);
+        }
+    }
+}
+
+// NOTE(soimn): Parses top level declarations up to the end of the range, and returns the list of them
+inline AST_Range
+ParseTopLevelDeclarations(Parser* parser)
+{
+    U32 list_start = BeginList(parser);
+    
+    ParseTopLevelDeclarationList(parser);
+    
+    return EndList(parser, list_start);
+}
+
+inline Parser
+ParserState(Syntax_Tree* tree, Diagnostics_Engine* diagnostics, U32 max_errors, bool lazy_function_bodies = false)
+{
+    Parser result = {};
+    result.tree                 = tree;
+    result.diagnostics          = diagnostics;
+    result.max_errors           = max_errors;
+    result.lazy_function_bodies = lazy_function_bodies;
+    
+    result.expression_stack = DynamicArray<Expression_Frame>(PARSER_EXPRESSION_STACK_RESERVE);
+    result.scratch          = DynamicArray<Node_Index>(PARSER_SCRATCH_RESERVE);
+    
+    return result;
+}
+
+inline void
+FreeParserState(Parser* parser)
+{
+    FreeArray(&parser->expression_stack);
+    FreeArray(&parser->scratch);
+}
+
+// NOTE(soimn): The syntax tree takes ownership of the token array, which has to end with a Token_EndOfStream
+//              token, as Tokenize guarantees. With lazy_function_bodies the bodies of functions are left unparsed
+//              until ParseFunctionBody is called on them.
+inline Syntax_Tree
+ParseTokens(Dynamic_Array<Token> tokens, Diagnostics_Engine* diagnostics, U32 max_errors = PARSER_DEFAULT_MAX_ERRORS,
+            bool lazy_function_bodies = false)
+{
+    Assert(tokens.count != 0 && tokens.data[tokens.count - 1].type == Token_EndOfStream);
+    
+    Syntax_Tree tree = SyntaxTree(tokens);
+    
+    Parser parser = ParserState(&tree, diagnostics, max_errors, lazy_function_bodies);
+    BeginParsingRange(&parser, tokens.data, 0, (U32)tokens.count - 1);
+    
+    // NOTE(soimn): The translation unit is pushed first so that it gets index 0, see NODE_NONE
+    Node_Index translation_unit = PushNode(&parser, ASTNode_TranslationUnit);
+    
+    AST_Range declarations = ParseTopLevelDeclarations(&parser);
+    *NodeData(&tree, translation_unit) = {declarations.start, declarations.end};
+    
+    FreeParserState(&parser);
+    
+    return tree;
+}
+
+inline Syntax_Tree
+ParseStringStream(String_Stream stream, File_ID file, Diagnostics_Engine* diagnostics, U32 max_errors = PARSER_DEFAULT_MAX_ERRORS,
+                  bool lazy_function_bodies = false)
+{
+    return ParseTokens(Tokenize(stream, file, diagnostics), diagnostics, max_errors, lazy_function_bodies);
+}
+
+// NOTE(soimn): Returns the body of a function definition, parsing it first if it is still a lazy block. The body
+//              is parsed with the rest of the file as its range, so it parses exactly like it would have when the
+//              file was parsed, and the new nodes are appended to the tree. The parser has to be set up on the tree
+//              of the function, and is reused by callers that parse many bodies. This modifies the tree, so it must
+//              not be called on a tree that is used by another thread.
+inline Node_Index
+ParseFunctionBody(Parser* parser, Node_Index function)
+{
+    Syntax_Tree* tree = parser->tree;
+    
+    Assert(NodeKind(tree, function) == ASTNode_FunctionDef);
+    
+    Node_Index result = NodeData(tree, function)->rhs;
+    
+    if (NodeKind(tree, result) == ASTNode_LazyBlock)
+    {
+        BeginParsingRange(parser, tree->tokens.data, tree->main_tokens.data[result], (U32)tree->tokens.count - 1);
+        
+        result = ParseBlock(parser);
+        NodeData(tree, function)->rhs = result;
+    }
+    
+    return result;
+}
+
+inline Node_Index
+ParseFunctionBody(Syntax_Tree* tree, Node_Index function, Diagnostics_Engine* diagnostics,
+                  U32 max_errors = PARSER_DEFAULT_MAX_ERRORS)
+{
+    Node_Index result = NodeData(tree, function)->rhs;
+    
+    if (NodeKind(tree, result) == ASTNode_LazyBlock)
+    {
+        Parser parser = ParserState(tree, diagnostics, max_errors);
+        
+        result = ParseFunctionBody(&parser, function);
+        
+        FreeParserState(&parser);
+    }
+    
+    return result;
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+struct Token_Range
+{
+    U32 start;
+    U32 end;
+};
+
+// NOTE(soimn): Splits the tokens of a file into the ranges of its top level declarations, which can then be
+//              parsed independently of each other with BeginParsingRange. The split only matches brackets, and
+//              ends a declaration after a ';' outside of any brackets, or after the '}' of a body that follows a
+//              ')', which is a function body. A top level keyword outside of brackets also starts a new range,
+//              unless it follows typedef, so a missing ';' after a struct does not swallow the next declaration.
+//
+//              Every token before the Token_EndOfStream token ends up in exactly one range, and for well formed
+//              input the ranges parse to the same declarations as the whole file does.
+inline void
+SplitTopLevelDeclarations(Token* tokens, U32 token_count, Dynamic_Array<Token_Range>* ranges)
+{
+    Assert(token_count != 0 && tokens[token_count - 1].type == Token_EndOfStream);
+    
+    U32 end   = token_count - 1;
+    U32 start = 0;
+    U32 depth = 0;
+    
+    bool is_in_function_body = false;
+    
+    for (U32 i = 0; i < end; ++i)
+    {
+        Enum32(LEXER_TOKEN_TYPE) type = tokens[i].type;
+        
+        bool ends_declaration = false;
         
-    } while (token.type != Token_EndOfStream);
-}
\ No newline at end of file
+        if (depth == 0 && IsTopLevelKeyword(type) && i != start && tokens[i - 1].type != Token_Typedef)
+        {
+            *PushElement(ranges) = {start, i};
+            start = i;
+        }
+        
+        if (type == Token_OpenBrace || type == Token_OpenParen || type == Token_OpenBracket)
+        {
+            if (depth == 0 && type == Token_OpenBrace)
+            {
+                is_in_function_body = (i != start && tokens[i - 1].type == Token_CloseParen);
+            }
+            
+            ++depth;
+        }
+        
+        else if (type == Token_CloseBrace || type == Token_CloseParen || type == Token_CloseBracket)
+        {
+            // NOTE(soimn): Unbalanced closing brackets are ignored, the parser reports them
+            if (depth != 0)
+            {
+                --depth;
+                
+                ends_declaration = (depth == 0 && type == Token_CloseBrace && is_in_function_body);
+            }
+        }
+        
+        else if (type == Token_Semicolon)
+        {
+            ends_declaration = (depth == 0);
+        }
+        
+        if (ends_declaration)
+        {
+            *PushElement(ranges) = {start, i + 1};
+            start = i + 1;
+        }
+    }
+    
+    if (start != end)
+    {
+        *PushElement(ranges) = {start, end};
+    }
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): Incremental parsing for tools that reparse a file on every edit. The file is parsed one top level
+//              declaration at a time, in the ranges of SplitTopLevelDeclarations, and the tree remembers the range
+//              and the nodes of every declaration. On a reparse, the new tokens are split the same way, and every
+//              declaration whose tokens are identical to those of an old declaration, apart from their locations,
+//              gets a copy of the old subtrees instead of being parsed again. Only the declarations touched by the
+//              edit are parsed. Since ranges parse independently of each other, a copy is exactly what parsing
+//              the range would have produced.
+//
+//              Declarations that had errors are always parsed again, so their diagnostics are reported again, as
+//              are the diagnostics of the lexer, which runs on the whole file.
+
+struct Parsed_Declaration
+{
+    Token_Range tokens;
+    U64 hash;
+    
+    // NOTE(soimn): The nodes the declaration parsed to, as a range of the list of the translation unit
+    U32 roots_start;
+    U32 roots_end;
+    
+    bool has_errors;
+};
+
+struct Incremental_Tree
+{
+    Syntax_Tree tree;
+    Dynamic_Array<Parsed_Declaration> declarations;
+};
+
+// NOTE(soimn): Which declarations downstream passes have to look at again after a reparse, by index in the
+//              declarations of the new and the old tree. Declarations that are in neither list were reused, and
+//              have at most moved. Declarations with errors are never reused, so they are always in both lists.
+struct Reparse_Changes
+{
+    U32* changed;
+    U32 changed_count;
+    
+    U32* removed;
+    U32 removed_count;
+};
+
+// NOTE(soimn): Hashes the type and value of every token in the range, but not its location
+inline U64
+HashTokenRange(Token* tokens, Token_Range range, Memory_Arena* scratch)
+{
+    U64 result = HashU64(range.end - range.start);
+    
+    for (U32 i = range.start; i < range.end; ++i)
+    {
+        Token* token = &tokens[i];
+        
+        U64 value = 0;
+        
+        if (TokenHasString(token->type)) value = (token->string.size != 0 ? HashString(Linearize(token->string, scratch)) : 0);
+        else                             Copy(&token->num_u64, &value, sizeof(U64));
+        
+        result = HashU64(result ^ token->type);
+        result = HashU64(result ^ value);
+    }
+    
+    return result;
+}
+
+inline bool
+TokenRangesMatch(Token* tokens_a, Token_Range range_a, Token* tokens_b, Token_Range range_b, Memory_Arena* scratch)
+{
+    bool result = (range_a.end - range_a.start == range_b.end - range_b.start);
+    
+    for (U32 i = 0; result && i < range_a.end - range_a.start; ++i)
+    {
+        Token* a = &tokens_a[range_a.start + i];
+        Token* b = &tokens_b[range_b.start + i];
+        
+        result = (a->type == b->type);
+        
+        if (result)
+        {
+            if (TokenHasString(a->type)) result = StringCompare(a->string, Linearize(b->string, scratch));
+            else                         result = (a->num_u64 == b->num_u64);
+        }
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Parses the tokens into a new incremental tree, reusing the declarations of the old tree when there is
+//              one. The tree takes ownership of the token array, which has to end with a Token_EndOfStream token.
+inline Incremental_Tree
+BuildIncrementalTree(Incremental_Tree* old_tree, Dynamic_Array<Token> tokens, Diagnostics_Engine* diagnostics,
+                     U32 max_errors, bool lazy_function_bodies, Memory_Arena* arena, Reparse_Changes* changes)
+{
+    Assert(tokens.count != 0 && tokens.data[tokens.count - 1].type == Token_EndOfStream);
+    
+    Incremental_Tree result = {};
+    result.tree         = SyntaxTree(tokens);
+    result.declarations = DynamicArray<Parsed_Declaration>(tokens.count * sizeof(Parsed_Declaration));
+    
+    // NOTE(soimn): Strings that cross a block boundary are linearized into string_scratch, which is reset for every
+    //              declaration
+    Memory_Arena scratch        = {};
+    Memory_Arena string_scratch = {};
+    
+    Dynamic_Array<Token_Range> ranges = DynamicArray<Token_Range>(tokens.count * sizeof(Token_Range));
+    SplitTopLevelDeclarations(tokens.data, (U32)tokens.count, &ranges);
+    
+    U32 old_count = (old_tree ? (U32)old_tree->declarations.count : 0);
+    
+    // NOTE(soimn): Identical declarations have the same hash, so the map holds the first old declaration with a hash,
+    //              and next_with_hash chains the rest in order. Every old declaration is reused at most once, by the
+    //              first new declaration that matches it, so duplicates are matched up in order.
+    Hash_Map<U64, U32> old_declarations = HashMap<U64, U32>(&scratch, old_count);
+    U32* next_with_hash                 = PushArray(&scratch, U32, MAX(old_count, 1));
+    bool* is_reused                     = PushArray(&scratch, bool, MAX(old_count, 1));
+    
+    Node_Index* remap               = 0;
+    Node_Index* old_roots           = 0;
+    Dynamic_Array<Node_Index> stack = {};
+    
+    if (old_tree)
+    {
+        remap     = PushArray(&scratch, Node_Index, MAX(NodeCount(&old_tree->tree), 1));
+        old_roots = old_tree->tree.extra_data.data + NodeData(&old_tree->tree, NODE_NONE)->lhs;
+        stack     = DynamicArray<Node_Index>((NodeCount(&old_tree->tree) + 1) * sizeof(Node_Index));
+        
+        for (U32 i = old_count; i > 0; --i)
+        {
+            is_reused[i - 1]      = false;
+            next_with_hash[i - 1] = U32_MAX;
+            
+            Parsed_Declaration* declaration = &old_tree->declarations.data[i - 1];
+            
+            if (!declaration->has_errors)
+            {
+                U32* first = Lookup(&old_declarations, declaration->hash);
+                if (first) next_with_hash[i - 1] = *first;
+                
+                Insert(&old_declarations, declaration->hash, i - 1);
+            }
+        }
+    }
+    
+    if (changes)
+    {
+        *changes = {};
+        changes->changed = PushArray(arena, U32, MAX(ranges.count, 1));
+        changes->removed = PushArray(arena, U32, MAX(old_count, 1));
+    }
+    
+    Parser parser = ParserState(&result.tree, diagnostics, max_errors, lazy_function_bodies);
+    
+    // NOTE(soimn): The translation unit is pushed first so that it gets index 0, see NODE_NONE
+    Node_Index translation_unit = PushNode(&result.tree, ASTNode_TranslationUnit, 0);
+    
+    U32 list_start = BeginList(&parser);
+    
+    for (UMM i = 0; i < ranges.count; ++i)
+    {
+        Parsed_Declaration* declaration = PushElement(&result.declarations);
+        *declaration = {};
+        declaration->tokens      = ranges.data[i];
+        declaration->hash        = HashTokenRange(tokens.data, declaration->tokens, &string_scratch);
+        declaration->roots_start = (U32)parser.scratch.count - list_start;
+        
+        U32* first_index = Lookup(&old_declarations, declaration->hash);
+        U32 old_index    = U32_MAX;
+        
+        for (U32 j = (first_index ? *first_index : U32_MAX); j != U32_MAX; j = next_with_hash[j])
+        {
+            Parsed_Declaration* candidate = &old_tree->declarations.data[j];
+            
+            if (!is_reused[j] && TokenRangesMatch(tokens.data, declaration->tokens, old_tree->tree.tokens.data, candidate->tokens, &string_scratch))
+            {
+                old_index = j;
+                break;
+            }
+        }
+        
+        if (old_index != U32_MAX)
+        {
+            Parsed_Declaration* old_declaration = &old_tree->declarations.data[old_index];
+            
+            U32 token_shift = declaration->tokens.start - old_declaration->tokens.start;
+            
+            for (U32 j = old_declaration->roots_start; j < old_declaration->roots_end; ++j)
+            {
+                PushListElement(&parser, CopySubtree(&result.tree, &old_tree->tree, old_roots[j], token_shift, remap, &stack));
+            }
+            
+            is_reused[old_index] = true;
+        }
+        
+        else
+        {
+            BeginParsingRange(&parser, tokens.data, declaration->tokens.start, declaration->tokens.end);
+            ParseTopLevelDeclarationList(&parser);
+            
+            declaration->has_errors = (parser.error_count != 0);
+            
+            if (changes) changes->changed[changes->changed_count++] = (U32)i;
+        }
+        
+        declaration->roots_end = (U32)parser.scratch.count - list_start;
+        
+        ResetArena(&string_scratch);
+    }
+    
+    AST_Range declarations = EndList(&parser, list_start);
+    *NodeData(&result.tree, translation_unit) = {declarations.start, declarations.end};
+    
+    if (changes)
+    {
+        for (U32 i = 0; i < old_count; ++i)
+        {
+            if (!is_reused[i]) changes->removed[changes->removed_count++] = i;
+        }
+    }
+    
+    FreeParserState(&parser);
+    FreeArray(&ranges);
+    FreeArray(&stack);
+    ClearArena(&scratch);
+    ClearArena(&string_scratch);
+    
+    return result;
+}
+
+inline void
+FreeIncrementalTree(Incremental_Tree* tree)
+{
+    FreeSyntaxTree(&tree->tree);
+    FreeArray(&tree->declarations);
+}
+
+inline Incremental_Tree
+ParseIncremental(Dynamic_Array<Token> tokens, Diagnostics_Engine* diagnostics, U32 max_errors = PARSER_DEFAULT_MAX_ERRORS,
+                 bool lazy_function_bodies = false)
+{
+    return BuildIncrementalTree(0, tokens, diagnostics, max_errors, lazy_function_bodies, 0, 0);
+}
+
+// NOTE(soimn): Replaces the tree with a parse of the new tokens, and frees the old one. The lists of changes are
+//              allocated in the arena. The old tokens are compared to the new ones by their strings, so the source
+//              stream the old tokens were lexed from has to stay alive until the reparse returns.
+inline void
+ReparseIncremental(Incremental_Tree* tree, Dynamic_Array<Token> tokens, Diagnostics_Engine* diagnostics,
+                   Memory_Arena* arena, Reparse_Changes* changes, U32 max_errors = PARSER_DEFAULT_MAX_ERRORS,
+                   bool lazy_function_bodies = false)
+{
+    Incremental_Tree new_tree = BuildIncrementalTree(tree, tokens, diagnostics, max_errors, lazy_function_bodies, arena, changes);
+    
+    FreeIncrementalTree(tree);
+    
+    *tree = new_tree;
+}
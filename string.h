@@ -2,14 +2,12 @@
 
 #include "common.h"
 #include "memory.h"
-
-// TODO(soimn): Remove this dependency
-#include <stdarg.h>
+#include "float_format.h"
 
 inline bool
 IsAlpha(char c)
 {
-    return ((c >= 'A' && c <= 'Z') && (c >= 'a' && c <= 'z'));
+    return ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z'));
 }
 
 inline bool
@@ -85,11 +83,39 @@ Advance(String* string, UMM amount)
     }
 }
 
+// NOTE(soimn): The SIMD routines below never read past the end of the data they are given, except for 
+//              StringLength, which has to find the end. It only ever does aligned 16 byte loads, and those can 
+//              not cross a page boundary, so it never touches a page the string does not extend into.
+
 inline UMM
 StringLength(const char* cstring)
 {
+    UMM misalignment = (UMM)cstring & 15;
+    __m128i* scan    = (__m128i*)(cstring - misalignment);
+    
+    U32 zero_mask = (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(scan), _mm_setzero_si128()));
+    zero_mask   >>= misalignment;
+    
     UMM length = 0;
-    for (char* scan = (char*)cstring; *scan; ++scan, ++length);
+    
+    if (zero_mask)
+    {
+        length = FindFirstSetBit(zero_mask);
+    }
+    
+    else
+    {
+        for (++scan;; ++scan)
+        {
+            zero_mask = (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(scan), _mm_setzero_si128()));
+            
+            if (zero_mask)
+            {
+                length = (UMM)((char*)scan - cstring) + FindFirstSetBit(zero_mask);
+                break;
+            }
+        }
+    }
     
     return length;
 }
@@ -97,42 +123,149 @@ StringLength(const char* cstring)
 inline bool
 StringCompare(String s0, String s1)
 {
-    while (s0.size && s1.size && s0.data[0] == s1.data[0])
+    return (s0.size == s1.size && MemoryEquals(s0.data, s1.data, s0.size));
+}
+
+inline bool
+StringHasPrefix(String string, String prefix)
+{
+    return (string.size >= prefix.size && MemoryEquals(string.data, prefix.data, prefix.size));
+}
+
+// NOTE(soimn): Returns the index of the first occurrence of the byte, or string.size if there is none
+inline UMM
+FindFirstByte(String string, U8 byte)
+{
+    UMM index = 0;
+    
+    __m128i pattern = _mm_set1_epi8((char)byte);
+    
+    for (; index + 16 <= string.size; index += 16)
+    {
+        U32 match_mask = (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(string.data + index)), pattern));
+        
+        if (match_mask)
+        {
+            return index + FindFirstSetBit(match_mask);
+        }
+    }
+    
+    for (; index < string.size && string.data[index] != byte; ++index);
+    
+    return index;
+}
+
+#define FIND_FIRST_OF_MAX_SIMD_SET_SIZE 8
+
+// NOTE(soimn): Returns the index of the first byte that is in the set, or string.size if there is none. Small 
+//              sets are matched 16 bytes at a time, larger sets fall back to a byte wise bitmap lookup.
+inline UMM
+FindFirstOf(String string, String set)
+{
+    UMM index = 0;
+    
+    if (set.size <= FIND_FIRST_OF_MAX_SIMD_SET_SIZE)
+    {
+        __m128i patterns[FIND_FIRST_OF_MAX_SIMD_SET_SIZE];
+        
+        for (UMM i = 0; i < set.size; ++i)
+        {
+            patterns[i] = _mm_set1_epi8((char)set.data[i]);
+        }
+        
+        for (; index + 16 <= string.size; index += 16)
+        {
+            __m128i chunk   = _mm_loadu_si128((__m128i*)(string.data + index));
+            __m128i matches = _mm_setzero_si128();
+            
+            for (UMM i = 0; i < set.size; ++i)
+            {
+                matches = _mm_or_si128(matches, _mm_cmpeq_epi8(chunk, patterns[i]));
+            }
+            
+            U32 match_mask = (U32)_mm_movemask_epi8(matches);
+            
+            if (match_mask)
+            {
+                return index + FindFirstSetBit(match_mask);
+            }
+        }
+    }
+    
+    U64 bitmap[4] = {};
+    
+    for (UMM i = 0; i < set.size; ++i)
     {
-        Advance(&s0, 1);
-        Advance(&s1, 1);
+        bitmap[set.data[i] >> 6] |= 1ULL << (set.data[i] & 63);
     }
     
-    return (s0.size == 0 && s0.size == s1.size);
+    for (; index < string.size && !(bitmap[string.data[index] >> 6] & (1ULL << (string.data[index] & 63))); ++index);
+    
+    return index;
 }
 
 /// 
 /// 
 /// 
 
+#define STRING_STREAM_BLOCK_SIZE 512
+
+// NOTE(soimn): Output streams carry the handle they are flushed to, and are flushed automatically once more 
+//              than flush_threshold bytes are buffered. A threshold of 0 disables auto flushing, which is what 
+//              plain string streams use.
 struct String_Stream
 {
-    Bucket_Array bucket_array;
+    Bucket_Array<char, STRING_STREAM_BLOCK_SIZE> bucket_array;
+    
+    void* output_handle;
+    UMM flush_threshold;
 };
 
+inline String_Stream
+StringStream(Memory_Arena* arena)
+{
+    String_Stream result = {};
+    result.bucket_array = BUCKET_ARRAY(arena, char, STRING_STREAM_BLOCK_SIZE);
+    
+    return result;
+}
+
+inline String_Stream
+OutputStream(Memory_Arena* arena, void* output_handle, UMM flush_threshold)
+{
+    String_Stream result = StringStream(arena);
+    result.output_handle   = output_handle;
+    result.flush_threshold = flush_threshold;
+    
+    return result;
+}
+
+inline void
+AutoFlush(String_Stream* stream)
+{
+    if (stream->flush_threshold && stream->bucket_array.num_elements >= stream->flush_threshold)
+    {
+        Flush(stream);
+    }
+}
+
 inline void
 Append(String_Stream* stream, char c)
 {
     if (stream)
     {
-        *(char*)PushElement(&stream->bucket_array) = c;
+        *PushElement(&stream->bucket_array) = c;
+        AutoFlush(stream);
     }
 }
 
 inline void
 Append(String_Stream* stream, String string)
 {
-    if (stream)
+    if (stream && string.size)
     {
-        for (; string.size; Advance(&string, 1))
-        {
-            *(char*)PushElement(&stream->bucket_array) = (char)*string.data;
-        }
+        AppendElements(&stream->bucket_array, (char*)string.data, string.size);
+        AutoFlush(stream);
     }
 }
 
@@ -144,28 +277,41 @@ struct String_Stream_Interval
     UMM size;
 };
 
+// NOTE(soimn): Splits off the part of the interval that lies in its first block, and advances the interval past 
+//              it. Interval operations work on these contiguous segments instead of on single characters.
+inline String
+PopIntervalSegment(String_Stream_Interval* interval)
+{
+    UMM offset = interval->index % interval->block_size;
+    UMM length = MIN(interval->size, interval->block_size - offset);
+    
+    String result = {(U8*)(interval->first_block + 1) + offset, length};
+    
+    interval->index += length;
+    interval->size  -= length;
+    
+    if (interval->size)
+    {
+        interval->first_block = interval->first_block->next;
+    }
+    
+    return result;
+}
+
 inline bool
 StringCompare(String_Stream_Interval interval, String string)
 {
-    Bucket_Array_Block* current_block = interval.first_block;
-    U8* current = (U8*)(current + 1) + interval.index % interval.block_size;
+    bool result = (interval.size == string.size);
     
-    while (interval.size && string.size && *current == string.data[0])
+    while (result && interval.size)
     {
-        Advance(&string, 1);
-        
-        ++interval.index;
-        --interval.size;
+        String segment = PopIntervalSegment(&interval);
         
-        if (interval.index % interval.block_size == 0)
-        {
-            current_block = current_block->next;
-        }
-        
-        current = (U8*)(current + 1) + interval.index % interval.block_size;
+        result = MemoryEquals(segment.data, string.data, segment.size);
+        Advance(&string, segment.size);
     }
     
-    return (interval.size == 0 && interval.size == string.size);
+    return result;
 }
 
 inline bool
@@ -177,232 +323,406 @@ StringCompare(String string, String_Stream_Interval interval)
 inline void
 Append(String_Stream* stream, String_Stream_Interval interval)
 {
-    Bucket_Array_Block* block = interval.first_block;
-    
-    for (UMM i = interval.index % interval.block_size; i < MIN(interval.size, interval.block_size); ++i)
+    while (interval.size)
     {
-        Append(stream, *((char*)(block + 1) + i));
+        Append(stream, PopIntervalSegment(&interval));
     }
+}
+
+// NOTE(soimn): Returns the interval as a contiguous string. Intervals that lie within a single block are 
+//              returned in place without copying, so the result is only valid for as long as the stream is.
+inline String
+Linearize(String_Stream_Interval interval, Memory_Arena* arena)
+{
+    String result = {};
     
-    UMM remaining_size = interval.size - MIN(interval.size, interval.block_size);
-    
-    if (remaining_size)
+    if (interval.size)
     {
-        block = block->next;
+        if (interval.index % interval.block_size + interval.size <= interval.block_size)
+        {
+            result = PopIntervalSegment(&interval);
+        }
         
-        U32 num_blocks = (U32)(remaining_size / interval.block_size) + 1;
-        for (U32 i = 0; i < num_blocks; ++i)
+        else
         {
-            for (U32 j = 0; j < MIN(remaining_size, interval.block_size); ++j)
+            result.data = PushArray(arena, U8, interval.size);
+            
+            while (interval.size)
             {
-                Append(stream, *((char*)(block + 1) + j));
+                String segment = PopIntervalSegment(&interval);
+                
+                Copy(segment.data, result.data + result.size, segment.size);
+                result.size += segment.size;
             }
-            
-            remaining_size -= interval.block_size;
-            block = block->next;
         }
     }
+    
+    return result;
 }
 
 /// 
 /// 
 /// 
 
-inline UMM
-Print(String_Stream* stream, String message, va_list arg_list)
+global const char DigitPairs[] = 
+"00010203040506070809"
+"10111213141516171819"
+"20212223242526272829"
+"30313233343536373839"
+"40414243444546474849"
+"50515253545556575859"
+"60616263646566676869"
+"70717273747576777879"
+"80818283848586878889"
+"90919293949596979899";
+
+global const U64 PowersOfTen[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 
+    1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 
+    1000000000000000000ULL, 10000000000000000000ULL
+};
+
+// NOTE(soimn): log10(2) is approximated by 1233 / 4096, which gives the digit count from the bit count up to 
+//              an off by one that is corrected with a single table lookup
+inline U32
+DigitCount(U64 value)
 {
-    UMM required_length = 0;
+    U32 approximation = ((U32)HighestSetBit(value | 1) + 1) * 1233 >> 12;
+    
+    return approximation + 1 - ((value | 1) < PowersOfTen[approximation]);
+}
+
+// NOTE(soimn): Writes the digits of value to buffer two at a time, and returns the number of digits written. 
+//              The buffer must hold at least 20 characters.
+inline U32
+FormatU64(char* buffer, U64 value)
+{
+    U32 digit_count = DigitCount(value);
+    char* scan      = buffer + digit_count;
+    
+    while (value >= 100)
+    {
+        U32 pair_index = (U32)(value % 100) * 2;
+        value /= 100;
+        
+        *(--scan) = DigitPairs[pair_index + 1];
+        *(--scan) = DigitPairs[pair_index];
+    }
     
-    while(message.size)
+    if (value >= 10)
     {
-        if (*message.data == '%')
+        *(--scan) = DigitPairs[value * 2 + 1];
+        *(--scan) = DigitPairs[value * 2];
+    }
+    
+    else
+    {
+        *(--scan) = (char)('0' + value);
+    }
+    
+    return digit_count;
+}
+
+// NOTE(soimn): The magnitude is computed in unsigned arithmetic, since negating I64_MIN overflows
+inline U32
+FormatI64(char* buffer, I64 value)
+{
+    U32 length = 0;
+    
+    if (value < 0)
+    {
+        buffer[length++] = '-';
+    }
+    
+    U64 magnitude = (value < 0 ? ~(U64)value + 1 : (U64)value);
+    length += FormatU64(buffer + length, magnitude);
+    
+    return length;
+}
+
+/// 
+/// 
+/// 
+
+#define FORMAT_MAX_SEGMENTS 32
+#define FORMAT_MAX_ARGUMENTS 16
+
+enum FORMAT_ERROR
+{
+    FormatError_None,
+    FormatError_UnknownSpecifier,
+    FormatError_TrailingPercent,
+    FormatError_TooManySegments,
+    FormatError_TooManyArguments,
+};
+
+// NOTE(soimn): A segment is either a literal run of the format string, or an argument slot when specifier 
+//              is non zero
+struct Format_Segment
+{
+    U32 offset;
+    U32 length;
+    char specifier;
+};
+
+struct Format_Layout
+{
+    Format_Segment segments[FORMAT_MAX_SEGMENTS];
+    char argument_specifiers[FORMAT_MAX_ARGUMENTS];
+    U32 segment_count;
+    U32 argument_count;
+    Enum8(FORMAT_ERROR) error;
+};
+
+constexpr void
+PushFormatSegment(Format_Layout* layout, UMM offset, UMM length, char specifier)
+{
+    if (layout->segment_count == FORMAT_MAX_SEGMENTS)
+    {
+        layout->error = FormatError_TooManySegments;
+    }
+    
+    else
+    {
+        layout->segments[layout->segment_count++] = {(U32)offset, (U32)length, specifier};
+    }
+}
+
+// NOTE(soimn): Supported specifiers:
+//              %u U32, %i I32, %U U64, %I I64, %S String, %s C string, %b bool, 
+//              %f %g F32, %F %G F64 (see float_format.h) and %% for a literal percent sign
+constexpr Format_Layout
+ParseFormat(const char* format, UMM length)
+{
+    Format_Layout layout = {};
+    
+    UMM run_start = 0;
+    UMM index     = 0;
+    
+    while (index < length && layout.error == FormatError_None)
+    {
+        if (format[index] != '%')
         {
-            Advance(&message, 1);
+            ++index;
+        }
+        
+        else if (index + 1 == length)
+        {
+            layout.error = FormatError_TrailingPercent;
+        }
+        
+        else
+        {
+            char specifier = format[index + 1];
+            
+            if (specifier == '%')
+            {
+                // NOTE(soimn): The literal run is extended to include the first percent sign, and the second 
+                //              is skipped
+                PushFormatSegment(&layout, run_start, index + 1 - run_start, 0);
+            }
             
-            if (message.size)
+            else if (specifier == 'u' || specifier == 'i' || specifier == 'U' || specifier == 'I' || 
+                     specifier == 'S' || specifier == 's' || specifier == 'b' || 
+                     specifier == 'f' || specifier == 'F' || specifier == 'g' || specifier == 'G')
             {
-                char c = (char)*message.data;
-                Advance(&message, 1);
+                if (index != run_start)
+                {
+                    PushFormatSegment(&layout, run_start, index - run_start, 0);
+                }
+                
+                PushFormatSegment(&layout, 0, 0, specifier);
+                
+                if (layout.argument_count == FORMAT_MAX_ARGUMENTS)
+                {
+                    layout.error = FormatError_TooManyArguments;
+                }
                 
-                switch (c)
+                else
                 {
-                    case '%':
-                    {
-                        Append(stream, '%');
-                        ++required_length;
-                    } break;
-                    
-                    case 'u':
-                    case 'i':
-                    case 'U':
-                    case 'I':
-                    {
-                        U64 unsigned_number = 0;
-                        I64 signed_number   = 0;
-                        
-                        bool is_signed = false;
-                        
-                        if (c == 'u')
-                        {
-                            unsigned_number = va_arg(arg_list, U32);
-                        }
-                        
-                        else if (c == 'i')
-                        {
-                            signed_number = va_arg(arg_list, I32);
-                            is_signed = true;
-                        }
-                        
-                        else if (c == 'U')
-                        {
-                            unsigned_number = va_arg(arg_list, U64);
-                        }
-                        
-                        else
-                        {
-                            signed_number = va_arg(arg_list, I64);
-                            is_signed = true;
-                        }
-                        
-                        U32 index = 0;
-                        char buffer[20] = {};
-                        
-                        if (!unsigned_number && !signed_number)
-                        {
-                            index = 1;
-                            buffer[0] = '0';
-                        }
-                        
-                        else if (is_signed)
-                        {
-                            if (signed_number < 0)
-                            {
-                                Append(stream, '-');
-                                signed_number *= -1;
-                                
-                                ++required_length;
-                            }
-                            
-                            for (;;)
-                            {
-                                buffer[index] = signed_number % 10 + '0';
-                                if (signed_number == 0) break;
-                                
-                                signed_number  /= 10;
-                                
-                                ++index;
-                                ++required_length;
-                            }
-                        }
-                        
-                        else
-                        {
-                            for (;;)
-                            {
-                                buffer[index] = (char)(unsigned_number % 10) + '0';
-                                if (unsigned_number == 0) break;
-                                
-                                unsigned_number /= 10;
-                                
-                                ++index;
-                                ++required_length;
-                                
-                            }
-                        }
-                        
-                        for (U32 i = index - 1; ; --i)
-                        {
-                            Append(stream, buffer[i]);
-                            if (i == 0) break;
-                        }
-                    } break;
-                    
-                    case 'S':
-                    {
-                        String string = va_arg(arg_list, String);
-                        Append(stream, string);
-                        required_length += string.size;
-                    } break;
-                    
-                    case 's':
-                    {
-                        const char* cstring = va_arg(arg_list, const char*);
-                        
-                        for (char* scan = (char*)cstring; *scan; ++scan)
-                        {
-                            Append(stream, *scan);
-                            ++required_length;
-                        }
-                    } break;
-                    
-                    case 'b':
-                    {
-                        bool value = va_arg(arg_list, bool);
-                        String true_string  = CONST_STRING("true");
-                        String false_string = CONST_STRING("false");
-                        
-                        if (value)
-                        {
-                            Append(stream, true_string);
-                            required_length += true_string.size;
-                        }
-                        
-                        else
-                        {
-                            Append(stream, false_string);
-                            required_length += false_string.size;
-                        }
-                    } break;
-                    
-                    default:
-                    {
-                        Append(stream, '%');
-                        Append(stream, c);
-                        required_length += 2;
-                    } break;
+                    layout.argument_specifiers[layout.argument_count++] = specifier;
                 }
             }
             
             else
             {
-                Append(stream, '%');
-                ++required_length;
+                layout.error = FormatError_UnknownSpecifier;
             }
-        }
-        
-        else
-        {
-            Append(stream, (char)*message.data);
-            Advance(&message, 1);
-            ++required_length;
+            
+            index    += 2;
+            run_start = index;
         }
     }
     
-    return required_length;
+    if (run_start != length && layout.error == FormatError_None)
+    {
+        PushFormatSegment(&layout, run_start, length - run_start, 0);
+    }
+    
+    return layout;
+}
+
+// NOTE(soimn): Lists the specifiers each argument type is accepted by
+template<typename T> struct Format_Type        { static constexpr const char* specifiers = ""; };
+template<> struct Format_Type<U8>              { static constexpr const char* specifiers = "uU"; };
+template<> struct Format_Type<U16>             { static constexpr const char* specifiers = "uU"; };
+template<> struct Format_Type<U32>             { static constexpr const char* specifiers = "uU"; };
+template<> struct Format_Type<U64>             { static constexpr const char* specifiers = "U"; };
+template<> struct Format_Type<I8>              { static constexpr const char* specifiers = "iI"; };
+template<> struct Format_Type<I16>             { static constexpr const char* specifiers = "iI"; };
+template<> struct Format_Type<I32>             { static constexpr const char* specifiers = "iI"; };
+template<> struct Format_Type<I64>             { static constexpr const char* specifiers = "I"; };
+template<> struct Format_Type<bool>            { static constexpr const char* specifiers = "b"; };
+template<> struct Format_Type<F32>             { static constexpr const char* specifiers = "fg"; };
+template<> struct Format_Type<F64>             { static constexpr const char* specifiers = "FG"; };
+template<> struct Format_Type<String>          { static constexpr const char* specifiers = "S"; };
+template<> struct Format_Type<char*>           { static constexpr const char* specifiers = "s"; };
+template<> struct Format_Type<const char*>     { static constexpr const char* specifiers = "s"; };
+template<UMM N> struct Format_Type<char[N]>    { static constexpr const char* specifiers = "s"; };
+
+constexpr bool
+FormatSpecifierAccepts(const char* accepted_specifiers, char specifier)
+{
+    bool result = false;
+    
+    for (const char* scan = accepted_specifiers; *scan && !result; ++scan)
+    {
+        result = (*scan == specifier);
+    }
+    
+    return result;
 }
 
+template<typename... Args>
+constexpr bool
+FormatArgumentsMatch(const Format_Layout& layout)
+{
+    const char* accepted_specifiers[] = {Format_Type<Args>::specifiers..., ""};
+    
+    bool result = true;
+    
+    for (U32 i = 0; i < layout.argument_count && i < sizeof...(Args); ++i)
+    {
+        result = result && FormatSpecifierAccepts(accepted_specifiers[i], layout.argument_specifiers[i]);
+    }
+    
+    return result;
+}
+
+union Format_Argument
+{
+    U64 u64;
+    I64 i64;
+    F64 f64;
+    bool b8;
+    String string;
+};
+
+inline Format_Argument FormatArgument(U8 value)          { Format_Argument result = {}; result.u64 = value; return result; }
+inline Format_Argument FormatArgument(U16 value)         { Format_Argument result = {}; result.u64 = value; return result; }
+inline Format_Argument FormatArgument(U32 value)         { Format_Argument result = {}; result.u64 = value; return result; }
+inline Format_Argument FormatArgument(U64 value)         { Format_Argument result = {}; result.u64 = value; return result; }
+inline Format_Argument FormatArgument(I8 value)          { Format_Argument result = {}; result.i64 = value; return result; }
+inline Format_Argument FormatArgument(I16 value)         { Format_Argument result = {}; result.i64 = value; return result; }
+inline Format_Argument FormatArgument(I32 value)         { Format_Argument result = {}; result.i64 = value; return result; }
+inline Format_Argument FormatArgument(I64 value)         { Format_Argument result = {}; result.i64 = value; return result; }
+inline Format_Argument FormatArgument(bool value)        { Format_Argument result = {}; result.b8 = value; return result; }
+inline Format_Argument FormatArgument(F32 value)         { Format_Argument result = {}; result.f64 = value; return result; }
+inline Format_Argument FormatArgument(F64 value)         { Format_Argument result = {}; result.f64 = value; return result; }
+inline Format_Argument FormatArgument(String value)      { Format_Argument result = {}; result.string = value; return result; }
+inline Format_Argument FormatArgument(const char* value) { Format_Argument result = {}; result.string = {(U8*)value, StringLength(value)}; return result; }
+
 inline UMM
-Print(String_Stream* stream, String message, ...)
+PrintSegments(String_Stream* stream, const char* format, const Format_Segment* segments, U32 segment_count, const Format_Argument* arguments)
 {
-    UMM resulting_length = 0;
+    UMM required_length = 0;
     
-    va_list arg_list;
-    va_start(arg_list, message);
-    Print(stream, message, arg_list);
-    va_end(arg_list);
+    const Format_Argument* argument = arguments;
     
-    return resulting_length;
+    for (U32 i = 0; i < segment_count; ++i)
+    {
+        const Format_Segment* segment = &segments[i];
+        
+        switch (segment->specifier)
+        {
+            case 0:
+            {
+                Append(stream, String{(U8*)format + segment->offset, segment->length});
+                required_length += segment->length;
+            } break;
+            
+            case 'u':
+            case 'U':
+            case 'i':
+            case 'I':
+            {
+                // NOTE(soimn): 20 digits for U64_MAX, or 19 digits and a sign for I64_MIN
+                char buffer[24];
+                U32 length = 0;
+                
+                if (segment->specifier == 'u' || segment->specifier == 'U') length = FormatU64(buffer, argument->u64);
+                else                                                        length = FormatI64(buffer, argument->i64);
+                
+                Append(stream, String{(U8*)buffer, length});
+                required_length += length;
+            } break;
+            
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+            {
+                char buffer[FLOAT_FORMAT_MAX_LENGTH];
+                
+                bool allow_scientific = (segment->specifier == 'g' || segment->specifier == 'G');
+                
+                U32 length = 0;
+                if (segment->specifier == 'f' || segment->specifier == 'g') length = FormatF32(buffer, (F32)argument->f64, allow_scientific);
+                else                                                        length = FormatF64(buffer, argument->f64, allow_scientific);
+                
+                Append(stream, String{(U8*)buffer, length});
+                required_length += length;
+            } break;
+            
+            case 'S':
+            case 's':
+            {
+                Append(stream, argument->string);
+                required_length += argument->string.size;
+            } break;
+            
+            case 'b':
+            {
+                String string = (argument->b8 ? String CONST_STRING("true") : String CONST_STRING("false"));
+                
+                Append(stream, string);
+                required_length += string.size;
+            } break;
+            
+            INVALID_DEFAULT_CASE;
+        }
+        
+        argument += (segment->specifier != 0);
+    }
+    
+    return required_length;
 }
 
+template<typename Format_Holder, typename... Args>
 inline UMM
-Print(String_Stream* stream, const char* message, ...)
+PrintFormat(String_Stream* stream, const Args&... args)
 {
-    UMM resulting_length = 0;
+    static constexpr Format_Layout layout = ParseFormat(Format_Holder::Format(), Format_Holder::Length());
+    
+    static_assert(layout.error != FormatError_UnknownSpecifier, "Unknown format specifier");
+    static_assert(layout.error != FormatError_TrailingPercent, "Format string ends with an unterminated '%'");
+    static_assert(layout.error != FormatError_TooManySegments, "Format string has too many segments, increase FORMAT_MAX_SEGMENTS");
+    static_assert(layout.error != FormatError_TooManyArguments, "Format string has too many arguments, increase FORMAT_MAX_ARGUMENTS");
+    static_assert(layout.argument_count == sizeof...(Args), "Number of arguments does not match the format string");
+    static_assert(FormatArgumentsMatch<Args...>(layout), "Argument type does not match its format specifier");
     
-    va_list arg_list;
-    va_start(arg_list, message);
-    Print(stream, {(U8*)message, StringLength(message)}, arg_list);
-    va_end(arg_list);
+    Format_Argument arguments[sizeof...(Args) + 1] = {FormatArgument(args)...};
     
-    return resulting_length;
-}
\ No newline at end of file
+    return PrintSegments(stream, Format_Holder::Format(), layout.segments, layout.segment_count, arguments);
+}
@@ -0,0 +1,464 @@
+#pragma once
+
+#include "common.h"
+#include "atomics.h"
+#include "memory.h"
+#include "string.h"
+#include "hash_map.h"
+#include "ast.h"
+
+// NOTE(soimn): Names are interned into atoms, so the rest of the compiler compares and hashes names as U32s. The
+//              atom table is shared between threads, and is locked, since names are interned while files are
+//              processed in parallel. Atom 0 is reserved as ATOM_NONE, and every other atom indexes the string it
+//              was interned from.
+//
+//              Passes that intern every name they come across, on every worker, go through an Atom_Cache per
+//              worker instead, which remembers the atoms the worker has already seen. A name then only takes the
+//              lock the first time a worker sees it, and the lock stays out of the loops of the parallel passes.
+
+typedef U32 Atom;
+
+#define ATOM_NONE 0
+#define ATOM_TABLE_MAX_ATOMS (1 << 24)
+
+struct Atom_Table
+{
+    Memory_Arena arena;
+    Spin_Lock lock;
+    
+    Hash_Map<String, Atom> atoms;
+    Dynamic_Array<String> strings;
+};
+
+inline Atom_Table
+AtomTable()
+{
+    Atom_Table result = {};
+    result.strings = DynamicArray<String>(ATOM_TABLE_MAX_ATOMS * sizeof(String));
+    
+    *PushElement(&result.strings) = {};
+    
+    return result;
+}
+
+inline void
+FreeAtomTable(Atom_Table* table)
+{
+    FreeArray(&table->strings);
+    ClearArena(&table->arena);
+    
+    *table = {};
+}
+
+inline Atom
+Intern(Atom_Table* table, String string)
+{
+    Atom result = ATOM_NONE;
+    
+    LockSpinLock(&table->lock);
+    
+    // NOTE(soimn): The hash map keeps a pointer to the arena, so it is set up on first use rather than in
+    //              AtomTable, see InitDiagnosticsStorage
+    if (!table->atoms.arena) table->atoms = HashMap<String, Atom>(&table->arena);
+    
+    Atom* atom = Lookup(&table->atoms, string);
+    
+    if (atom)
+    {
+        result = *atom;
+    }
+    
+    else
+    {
+        // NOTE(soimn): The string is copied, so atoms outlive the source text they were interned from
+        String copy = {(U8*)PushSize(&table->arena, MAX(string.size, 1)), string.size};
+        if (string.size != 0) Copy(string.data, copy.data, string.size);
+        
+        result = (Atom)table->strings.count;
+        *PushElement(&table->strings) = copy;
+        
+        Insert(&table->atoms, copy, result);
+    }
+    
+    UnlockSpinLock(&table->lock);
+    
+    return result;
+}
+
+inline Atom
+Intern(Atom_Table* table, String_Stream_Interval interval)
+{
+    Memory_Arena scratch = {};
+    
+    Atom result = Intern(table, Linearize(interval, &scratch));
+    
+    ClearArena(&scratch);
+    
+    return result;
+}
+
+// NOTE(soimn): Strings are never moved once interned, and the array is only appended to, so this does not lock
+inline String
+AtomString(Atom_Table* table, Atom atom)
+{
+    return table->strings.data[atom];
+}
+
+// NOTE(soimn): The atoms one thread has interned, in front of a shared atom table. The keys are the strings of the
+//              table, which live as long as it does.
+struct Atom_Cache
+{
+    Atom_Table* table;
+    
+    Memory_Arena arena;
+    Hash_Map<String, Atom> atoms;
+};
+
+inline Atom_Cache
+AtomCache(Atom_Table* table)
+{
+    Atom_Cache result = {};
+    result.table = table;
+    
+    return result;
+}
+
+inline void
+FreeAtomCache(Atom_Cache* cache)
+{
+    ClearArena(&cache->arena);
+    
+    *cache = {};
+}
+
+inline Atom
+Intern(Atom_Cache* cache, String string)
+{
+    Atom result = ATOM_NONE;
+    
+    // NOTE(soimn): Set up on first use, since the hash map keeps a pointer to the arena
+    if (!cache->atoms.arena) cache->atoms = HashMap<String, Atom>(&cache->arena);
+    
+    Atom* atom = Lookup(&cache->atoms, string);
+    
+    if (atom)
+    {
+        result = *atom;
+    }
+    
+    else
+    {
+        result = Intern(cache->table, string);
+        Insert(&cache->atoms, AtomString(cache->table, result), result);
+    }
+    
+    return result;
+}
+
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+/// /////////////////////////////////////////////
+
+// NOTE(soimn): The symbol table resolves names to declarations while a file is walked in source order. Global
+//              declarations live in a hash map, since a file can declare any number of them. Local scopes are
+//              usually small, so they live on a single stack of flat arrays, one per open scope, innermost last.
+//
+//              Every local scope keeps a 64 bit mask of the low 6 bits of the atoms declared in it, so a lookup
+//              skips every scope that cannot contain the name with a single test, and only scans the scopes that
+//              may. Lookups walk the scopes from the innermost outward, and end in the global scope.
+//
+//              A scope that grows past SYMBOL_SCOPE_INDEX_THRESHOLD names, like the body of a generated function,
+//              also gets a hashed index of its entries, since the mask of a large scope has every bit set and a
+//              scan would be linear in its size. The indices live on a stack of their own, which is in the same
+//              order as the scopes, and the index of a scope is rebuilt twice as large when it is half full. A
+//              lookup therefore takes at most SYMBOL_SCOPE_INDEX_THRESHOLD comparisons, or one probe sequence, per
+//              scope level.
+//
+//              The symbol table belongs to a single thread.
+
+#define SYMBOL_NONE 0
+#define SYMBOL_TABLE_MAX_SYMBOLS (1 << 24)
+
+// NOTE(soimn): Scanning this many entries costs about as much as a probe of the index of the scope
+#define SYMBOL_SCOPE_INDEX_THRESHOLD 32
+
+enum SYMBOL_KIND
+{
+    Symbol_Variable,
+    Symbol_Parameter,
+    Symbol_Function,
+    Symbol_Type,
+    Symbol_Enumerator,
+};
+
+struct Symbol
+{
+    Atom name;
+    Node_Index declaration;
+    Enum8(SYMBOL_KIND) kind;
+};
+
+struct Scope_Entry
+{
+    Atom name;
+    U32 symbol;
+};
+
+// NOTE(soimn): The index of a scope is index_capacity slots starting at index_start, and is only there when
+//              index_capacity is not 0. A slot holds the index of an entry plus one, or 0 when it is empty.
+struct Scope
+{
+    U32 entries_start;
+    U32 index_start;
+    U32 index_capacity;
+    U64 mask;
+};
+
+struct Symbol_Table
+{
+    Memory_Arena arena;
+    
+    // NOTE(soimn): Symbol 0 is a placeholder, so SYMBOL_NONE can be told apart from a symbol
+    Dynamic_Array<Symbol> symbols;
+    
+    Hash_Map<Atom, U32> globals;
+    
+    Dynamic_Array<Scope_Entry> entries;
+    Dynamic_Array<Scope> scopes;
+    Dynamic_Array<U32> index_slots;
+};
+
+inline Symbol_Table
+SymbolTable()
+{
+    Symbol_Table result = {};
+    result.symbols = DynamicArray<Symbol>(SYMBOL_TABLE_MAX_SYMBOLS * sizeof(Symbol));
+    result.entries = DynamicArray<Scope_Entry>(SYMBOL_TABLE_MAX_SYMBOLS * sizeof(Scope_Entry));
+    result.scopes  = DynamicArray<Scope>(SYMBOL_TABLE_MAX_SYMBOLS * sizeof(Scope));
+    
+    // NOTE(soimn): An index is at most four times the size of its scope
+    result.index_slots = DynamicArray<U32>(4 * SYMBOL_TABLE_MAX_SYMBOLS * sizeof(U32));
+    
+    *PushElement(&result.symbols) = {};
+    
+    return result;
+}
+
+inline void
+FreeSymbolTable(Symbol_Table* table)
+{
+    FreeArray(&table->symbols);
+    FreeArray(&table->entries);
+    FreeArray(&table->scopes);
+    FreeArray(&table->index_slots);
+    ClearArena(&table->arena);
+    
+    *table = {};
+}
+
+// NOTE(soimn): Forgets every symbol, so a table can be reused for the locals of the next function without the
+//              symbols of the previous ones piling up
+inline void
+ResetSymbolTable(Symbol_Table* table)
+{
+    PopElements(&table->symbols, table->symbols.count - 1);
+    ResetArray(&table->entries);
+    ResetArray(&table->scopes);
+    ResetArray(&table->index_slots);
+    
+    table->globals = {};
+    ResetArena(&table->arena);
+}
+
+inline Symbol*
+SymbolAt(Symbol_Table* table, U32 symbol)
+{
+    return &table->symbols.data[symbol];
+}
+
+inline U64
+ScopeMaskBit(Atom name)
+{
+    return 1ULL << (name & 63);
+}
+
+inline void
+PushScope(Symbol_Table* table)
+{
+    *PushElement(&table->scopes) = {(U32)table->entries.count, (U32)table->index_slots.count, 0, 0};
+}
+
+// NOTE(soimn): The symbols of the scope are kept, so nodes resolved to them stay valid after the scope closes
+inline void
+PopScope(Symbol_Table* table)
+{
+    Assert(table->scopes.count != 0);
+    
+    Scope* scope = &table->scopes.data[table->scopes.count - 1];
+    
+    PopElements(&table->entries, table->entries.count - scope->entries_start);
+    PopElements(&table->index_slots, table->index_slots.count - scope->index_start);
+    PopElements(&table->scopes, 1);
+}
+
+inline void
+InsertIntoScopeIndex(Symbol_Table* table, Scope* scope, U32 entry)
+{
+    U32* slots = table->index_slots.data + scope->index_start;
+    U32 mask   = scope->index_capacity - 1;
+    
+    U32 i = (U32)HashKey(table->entries.data[entry].name) & mask;
+    while (slots[i] != 0) i = (i + 1) & mask;
+    
+    slots[i] = entry + 1;
+}
+
+// NOTE(soimn): Replaces the index of the innermost scope with one of the given capacity, which is a power of two
+inline void
+RebuildScopeIndex(Symbol_Table* table, U32 capacity)
+{
+    Scope* scope = &table->scopes.data[table->scopes.count - 1];
+    
+    PopElements(&table->index_slots, table->index_slots.count - scope->index_start);
+    
+    scope->index_capacity = capacity;
+    ZeroArray(PushElements(&table->index_slots, capacity), capacity);
+    
+    for (U32 i = scope->entries_start; i < table->entries.count; ++i)
+    {
+        InsertIntoScopeIndex(table, scope, i);
+    }
+}
+
+// NOTE(soimn): Returns the symbol the name is bound to in the scope, whose entries end before end, or SYMBOL_NONE
+inline U32
+LookupInScope(Symbol_Table* table, Scope* scope, UMM end, Atom name)
+{
+    U32 result = SYMBOL_NONE;
+    
+    if (scope->mask & ScopeMaskBit(name))
+    {
+        if (scope->index_capacity != 0)
+        {
+            U32* slots = table->index_slots.data + scope->index_start;
+            U32 mask   = scope->index_capacity - 1;
+            
+            for (U32 i = (U32)HashKey(name) & mask; slots[i] != 0; i = (i + 1) & mask)
+            {
+                if (table->entries.data[slots[i] - 1].name == name)
+                {
+                    result = table->entries.data[slots[i] - 1].symbol;
+                    break;
+                }
+            }
+        }
+        
+        else
+        {
+            for (UMM i = end; i > scope->entries_start; --i)
+            {
+                if (table->entries.data[i - 1].name == name)
+                {
+                    result = table->entries.data[i - 1].symbol;
+                    break;
+                }
+            }
+        }
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Returns the symbol the name is bound to in the innermost scope, or SYMBOL_NONE
+inline U32
+LookupInCurrentScope(Symbol_Table* table, Atom name)
+{
+    U32 result = SYMBOL_NONE;
+    
+    if (table->scopes.count != 0)
+    {
+        result = LookupInScope(table, &table->scopes.data[table->scopes.count - 1], table->entries.count, name);
+    }
+    
+    else if (table->globals.count != 0)
+    {
+        U32* symbol = Lookup(&table->globals, name);
+        if (symbol) result = *symbol;
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Declares the symbol in the innermost scope, or the global scope when no scope is open, and returns
+//              its index. When the name is already declared in that scope, nothing is declared and the index of
+//              the existing symbol is returned instead, which callers tell apart by its declaration.
+inline U32
+DeclareSymbol(Symbol_Table* table, Symbol symbol)
+{
+    U32 result = LookupInCurrentScope(table, symbol.name);
+    
+    if (result == SYMBOL_NONE)
+    {
+        result = (U32)table->symbols.count;
+        *PushElement(&table->symbols) = symbol;
+        
+        if (table->scopes.count != 0)
+        {
+            Scope* scope = &table->scopes.data[table->scopes.count - 1];
+            scope->mask |= ScopeMaskBit(symbol.name);
+            
+            *PushElement(&table->entries) = {symbol.name, result};
+            
+            U32 count = (U32)table->entries.count - scope->entries_start;
+            
+            if (count > SYMBOL_SCOPE_INDEX_THRESHOLD)
+            {
+                if (2 * count > scope->index_capacity)
+                {
+                    RebuildScopeIndex(table, MAX(2 * scope->index_capacity, 4 * SYMBOL_SCOPE_INDEX_THRESHOLD));
+                }
+                
+                else
+                {
+                    InsertIntoScopeIndex(table, scope, (U32)table->entries.count - 1);
+                }
+            }
+        }
+        
+        else
+        {
+            // NOTE(soimn): Set up on first use, since the hash map keeps a pointer to the arena
+            if (!table->globals.arena) table->globals = HashMap<Atom, U32>(&table->arena);
+            
+            Insert(&table->globals, symbol.name, result);
+        }
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): Returns the symbol the name refers to from the innermost scope, or SYMBOL_NONE
+inline U32
+LookupSymbol(Symbol_Table* table, Atom name)
+{
+    U32 result = SYMBOL_NONE;
+    
+    UMM end = table->entries.count;
+    
+    for (UMM i = table->scopes.count; i > 0 && result == SYMBOL_NONE; --i)
+    {
+        Scope* scope = &table->scopes.data[i - 1];
+        
+        result = LookupInScope(table, scope, end, name);
+        
+        end = scope->entries_start;
+    }
+    
+    if (result == SYMBOL_NONE && table->globals.count != 0)
+    {
+        U32* symbol = Lookup(&table->globals, name);
+        if (symbol) result = *symbol;
+    }
+    
+    return result;
+}
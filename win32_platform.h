@@ -0,0 +1,328 @@
+#pragma once
+
+// NOTE(soimn): The Win32 implementation of the platform functions the rest of the compiler declares. It is
+//              included after every other header, by both the compiler and the test driver.
+
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#undef WIN32_LEAN_AND_MEAN
+#undef NOMINMAX
+#undef near
+#undef far
+
+inline Memory_Block*
+AllocateMemoryBlock(UMM block_size)
+{
+    Memory_Block* new_block = 0;
+    
+    UMM total_size = MEMORY_BLOCK_HEADER_SIZE + block_size;
+    
+    void* memory = VirtualAlloc(0, total_size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    
+    Assert(memory, "Failed to allocate memory block");
+    
+    new_block = (Memory_Block*) Align(memory, alignof(Memory_Block));
+    
+    *new_block = {};
+    new_block->push_ptr = Align(new_block + 1, 8);
+    new_block->space    = total_size - (new_block->push_ptr - (U8*) new_block);
+    
+    return new_block;
+}
+
+inline void
+FreeMemoryBlock(Memory_Block* block)
+{
+    // NOTE(soimn): MEM_RELEASE requires the size to be 0 and cannot be combined with MEM_DECOMMIT. The block 
+    //              header is placed at the start of the allocation, since VirtualAlloc returns page aligned memory
+    VirtualFree((void*) block, 0, MEM_RELEASE);
+}
+
+inline void*
+ReserveMemory(UMM size)
+{
+    void* memory = VirtualAlloc(0, size, MEM_RESERVE, PAGE_READWRITE);
+    
+    Assert(memory, "Failed to reserve memory");
+    
+    return memory;
+}
+
+inline void
+CommitMemory(void* ptr, UMM size)
+{
+    void* memory = VirtualAlloc(ptr, size, MEM_COMMIT, PAGE_READWRITE);
+    
+    Assert(memory, "Failed to commit memory");
+}
+
+inline void
+ReleaseMemory(void* ptr)
+{
+    VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+// NOTE(soimn): The view keeps the mapping alive, so both handles are closed once the view is mapped
+inline void*
+MapFile(const char* path, UMM* size)
+{
+    void* result = 0;
+    
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    
+    if (handle != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER file_size = {};
+        
+        // NOTE(soimn): Empty files cannot be mapped
+        if (GetFileSizeEx(handle, &file_size) && file_size.QuadPart != 0)
+        {
+            HANDLE mapping = CreateFileMappingA(handle, 0, PAGE_READONLY, 0, 0, 0);
+            
+            if (mapping)
+            {
+                result = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                *size  = (UMM)file_size.QuadPart;
+                
+                CloseHandle(mapping);
+            }
+        }
+        
+        CloseHandle(handle);
+    }
+    
+    return result;
+}
+
+inline void
+UnmapFile(void* view)
+{
+    UnmapViewOfFile(view);
+}
+
+// NOTE(soimn): Win32 has no gather write that works on consoles and pipes, so multi block streams are coalesced 
+//              into a staging buffer and written with as few WriteFile calls as possible. Single block streams, 
+//              which is the common case for small flushes, are written directly.
+global U8 FlushStagingBuffer[KILOBYTES(64)];
+
+inline void
+WriteToHandle(HANDLE output_handle, void* data, UMM size)
+{
+    while (size)
+    {
+        DWORD bytes_written = 0;
+        DWORD chunk_size    = (DWORD)MIN(size, U32_MAX);
+        
+        if (!WriteFile(output_handle, data, chunk_size, &bytes_written, 0) || !bytes_written)
+        {
+            break;
+        }
+        
+        data  = (U8*)data + bytes_written;
+        size -= bytes_written;
+    }
+}
+
+inline void
+Flush(String_Stream* stream)
+{
+    HANDLE output_handle = (stream->output_handle ? (HANDLE)stream->output_handle : GetStdHandle(STD_ERROR_HANDLE));
+    
+    Bucket_Array<char, STRING_STREAM_BLOCK_SIZE>* bucket_array = &stream->bucket_array;
+    
+    if (bucket_array->num_elements <= STRING_STREAM_BLOCK_SIZE)
+    {
+        if (bucket_array->num_elements)
+        {
+            WriteToHandle(output_handle, bucket_array->first_block + 1, bucket_array->num_elements);
+        }
+    }
+    
+    else
+    {
+        UMM staged_size = 0;
+        
+        for (Bucket_Array_Block* scan = bucket_array->first_block; scan; scan = scan->next)
+        {
+            U32 size = (scan == bucket_array->current_block ? scan->offset : STRING_STREAM_BLOCK_SIZE);
+            
+            if (staged_size + size > sizeof(FlushStagingBuffer))
+            {
+                WriteToHandle(output_handle, FlushStagingBuffer, staged_size);
+                staged_size = 0;
+            }
+            
+            if (size)
+            {
+                Copy(scan + 1, FlushStagingBuffer + staged_size, size);
+                staged_size += size;
+            }
+            
+            if (scan == bucket_array->current_block) break;
+        }
+        
+        if (staged_size)
+        {
+            WriteToHandle(output_handle, FlushStagingBuffer, staged_size);
+        }
+    }
+    
+    ResetArray(&stream->bucket_array);
+}
+
+inline void*
+OpenOutputFile(const char* path)
+{
+    HANDLE handle = CreateFileA(path, GENERIC_WRITE, FILE_SHARE_READ, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+    
+    return (handle != INVALID_HANDLE_VALUE ? (void*)handle : 0);
+}
+
+inline void
+CloseOutputFile(void* handle)
+{
+    CloseHandle((HANDLE)handle);
+}
+
+struct Win32_Thread_Start
+{
+    Thread_Proc proc;
+    void* data;
+};
+
+DWORD WINAPI
+Win32ThreadEntry(LPVOID parameter)
+{
+    Win32_Thread_Start start = *(Win32_Thread_Start*)parameter;
+    HeapFree(GetProcessHeap(), 0, parameter);
+    
+    start.proc(start.data);
+    
+    return 0;
+}
+
+// NOTE(soimn): The start record is heap allocated, since the thread may not have read it before StartThread
+//              returns, and is freed by the thread itself
+inline void*
+StartThread(Thread_Proc proc, void* data)
+{
+    Win32_Thread_Start* start = (Win32_Thread_Start*)HeapAlloc(GetProcessHeap(), 0, sizeof(Win32_Thread_Start));
+    Assert(start, "Failed to allocate thread start record");
+    
+    start->proc = proc;
+    start->data = data;
+    
+    HANDLE handle = CreateThread(0, 0, Win32ThreadEntry, start, 0, 0);
+    Assert(handle, "Failed to create thread");
+    
+    return (void*)handle;
+}
+
+inline void
+JoinThread(void* thread)
+{
+    WaitForSingleObject((HANDLE)thread, INFINITE);
+    CloseHandle((HANDLE)thread);
+}
+
+inline U32
+ProcessorCount()
+{
+    SYSTEM_INFO system_info = {};
+    GetSystemInfo(&system_info);
+    
+    return (U32)MAX(system_info.dwNumberOfProcessors, 1);
+}
+
+inline void*
+NewSemaphore(U32 initial_count)
+{
+    HANDLE handle = CreateSemaphoreA(0, (LONG)initial_count, MAXLONG, 0);
+    Assert(handle, "Failed to create semaphore");
+    
+    return (void*)handle;
+}
+
+inline void
+SignalSemaphore(void* semaphore, U32 count)
+{
+    ReleaseSemaphore((HANDLE)semaphore, (LONG)count, 0);
+}
+
+inline void
+WaitForSemaphore(void* semaphore)
+{
+    WaitForSingleObject((HANDLE)semaphore, INFINITE);
+}
+
+inline void
+FreeSemaphore(void* semaphore)
+{
+    CloseHandle((HANDLE)semaphore);
+}
+
+inline bool
+ReadEntireFile(const char* path, Memory_Arena* arena, String* contents)
+{
+    bool result = false;
+    
+    HANDLE handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    
+    if (handle != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER file_size = {};
+        
+        // NOTE(soimn): ReadFile takes a 32 bit size, so larger files are rejected
+        if (GetFileSizeEx(handle, &file_size) && (U64)file_size.QuadPart < U32_MAX)
+        {
+            DWORD size       = (DWORD)file_size.QuadPart;
+            DWORD bytes_read = 0;
+            
+            contents->data = (U8*)PushSize(arena, MAX(size, 1));
+            contents->size = size;
+            
+            result = (size == 0 || (ReadFile(handle, contents->data, size, &bytes_read, 0) && bytes_read == size));
+        }
+        
+        CloseHandle(handle);
+    }
+    
+    return result;
+}
+
+// NOTE(soimn): The file is written to a temporary file next to it and moved in place, so a reader never sees a
+//              partially written file. The temporary file is opened exclusively, so a concurrent writer of the same
+//              file fails instead of interleaving with it, and replacing a file that is mapped by another process
+//              fails as well, which leaves the old file in place.
+inline bool
+WriteEntireFile(const char* path, void* data, UMM size)
+{
+    bool result = false;
+    
+    char temporary_path[MAX_PATH];
+    
+    UMM path_length = StringLength(path);
+    
+    if (path_length + sizeof(".tmp") <= MAX_PATH && size < U32_MAX)
+    {
+        Copy((void*)path, temporary_path, MAX(path_length, 1));
+        Copy((void*)".tmp", temporary_path + path_length, sizeof(".tmp"));
+        
+        HANDLE handle = CreateFileA(temporary_path, GENERIC_WRITE, 0, 0, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+        
+        if (handle != INVALID_HANDLE_VALUE)
+        {
+            DWORD bytes_written = 0;
+            bool is_written = (WriteFile(handle, data, (DWORD)size, &bytes_written, 0) && bytes_written == size);
+            
+            CloseHandle(handle);
+            
+            result = (is_written && MoveFileExA(temporary_path, path, MOVEFILE_REPLACE_EXISTING));
+            
+            if (!result) DeleteFileA(temporary_path);
+        }
+    }
+    
+    return result;
+}